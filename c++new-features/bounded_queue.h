@@ -0,0 +1,5 @@
+#pragma once
+
+// `MPMCBoundedQueue` and `BlockingQueue` live with the rtp simulator, which is
+// also built on its own as a catkin package; the demos here share its copy
+#include "../rtp/BoundedQueue.h"
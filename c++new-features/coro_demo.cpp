@@ -0,0 +1,134 @@
+// thousands of coroutine flows on a few threads, see `coro_runtime.h`
+//
+// usage: coro_demo [threads] [flows]
+//
+// pipeline: a producer feeds `flows` workers through a channel of 16, every
+// worker "does I/O" by sleeping 1 ms per item and forwards its result
+// through a second channel of 16 to a summing sink; the full channels hold
+// the producer back.
+//
+// echo: `flows` clients each connect to an echo server on the loopback and
+// send 100 messages, the server runs a coroutine per connection.
+
+#include <iostream>
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <string>
+#include "coro_runtime.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t ITEMS_PER_FLOW = 20;
+constexpr size_t MESSAGES = 100;
+
+Task<void> produce(Channel<size_t>& in, size_t items)
+{
+    for (size_t i = 1; i <= items; ++i)
+        co_await in.send(i);
+    in.close();
+}
+
+Task<void> work(Executor& ex, Channel<size_t>& in, Channel<size_t>& out, std::atomic<size_t>& running)
+{
+    while (auto item = co_await in.receive()) {
+        co_await ex.sleepFor(std::chrono::milliseconds(1));
+        co_await out.send(*item * 2);
+    }
+    if (--running == 0)
+        out.close();
+}
+
+Task<size_t> sink(Channel<size_t>& out)
+{
+    size_t sum = 0;
+    while (auto v = co_await out.receive())
+        sum += *v;
+    co_return sum;
+}
+
+void pipeline(Executor& ex, size_t flows)
+{
+    Channel<size_t> in(ex, 16), out(ex, 16);
+    std::atomic<size_t> running{flows};
+    size_t items = flows * ITEMS_PER_FLOW;
+
+    auto t0 = Clock::now();
+    ex.spawn(produce(in, items));
+    for (size_t i = 0; i < flows; ++i)
+        ex.spawn(work(ex, in, out, running));
+    size_t sum = ex.blockOn(sink(out));
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::cout << "pipeline: " << items << " items through " << flows << " flows on "
+              << ex.threads() << " threads in " << secs << " s (" << items * 1e-3 / secs
+              << " s of sleeping per second)" << (sum == items * (items + 1) ? "" : "  WRONG SUM")
+              << std::endl;
+}
+
+Task<void> echo(Socket s)
+{
+    char buf[512];
+    for (ssize_t n; (n = co_await s.read(buf, sizeof(buf))) > 0; )
+        if (co_await s.write(buf, n) < 0)
+            break;
+}
+
+Task<void> serve(Executor& ex, Socket& server, size_t connections)
+{
+    for (size_t i = 0; i < connections; ++i)
+        ex.spawn(echo(co_await server.accept()));
+}
+
+Task<void> client(Executor& ex, uint16_t port, std::atomic<size_t>& ok, std::atomic<size_t>& left)
+{
+    Socket s = co_await Socket::connect(ex, port);
+    bool good = true;
+    for (size_t i = 0; i < MESSAGES && good; ++i) {
+        std::string msg = "message " + std::to_string(i) + "\n";
+        std::string back(msg.size(), '\0');
+        good = co_await s.write(msg.data(), msg.size()) == ssize_t(msg.size());
+        for (size_t got = 0; good && got < back.size(); ) {
+            ssize_t n = co_await s.read(&back[got], back.size() - got);
+            good = n > 0;
+            got += good ? n : 0;
+        }
+        good = good && back == msg;
+    }
+    ok += good;
+    --left;
+}
+
+Task<void> waitFor(Executor& ex, std::atomic<size_t>& left)
+{
+    while (left.load() != 0)
+        co_await ex.sleepFor(std::chrono::milliseconds(1));
+}
+
+void echoTest(Executor& ex, size_t flows)
+{
+    Socket server = Socket::listen(ex, 0, 4096);
+    std::atomic<size_t> ok{0}, left{flows};
+
+    auto t0 = Clock::now();
+    ex.spawn(serve(ex, server, flows));
+    for (size_t i = 0; i < flows; ++i)
+        ex.spawn(client(ex, server.port(), ok, left));
+    ex.blockOn(waitFor(ex, left));
+    double secs = std::chrono::duration<double>(Clock::now() - t0).count();
+
+    std::cout << "echo: " << flows << " connections x " << MESSAGES << " round trips on "
+              << ex.threads() << " threads in " << secs << " s, " << ok << " ok" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t threads = argc > 1 ? std::atoi(argv[1]) : 4;
+    size_t flows   = argc > 2 ? std::atoi(argv[2]) : 1000;
+
+    Executor ex(threads);
+    pipeline(ex, flows);
+    echoTest(ex, flows);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,757 @@
+#pragma once
+
+// C++20 coroutines on top of `ThreadPool`, `TimerWheel` and epoll
+//
+// a flow that would block a thread (a socket read, a full queue, a sleep)
+// suspends instead and is resumed on the pool when it can go on, so
+// thousands of flows share a handful of threads:
+//
+//   Task<void> echo(Socket s)
+//   {
+//     char buf[512];
+//     for (ssize_t n; (n = co_await s.read(buf, sizeof(buf))) > 0; )
+//       co_await s.write(buf, n);
+//   }
+//
+//   Task<void> serve(Executor& ex, Socket server)
+//   {
+//     for (;;)
+//       ex.spawn(echo(co_await server.accept()));
+//   }
+//
+//   Executor ex(4);
+//   ex.spawn(serve(ex, Socket::listen(ex, 7000)));
+//
+// a coroutine lambda must not capture: the lambda object is gone by the
+// time the coroutine runs, pass what it needs as parameters instead.
+// Destroy the executor only after the flows using it are done.
+
+#include <coroutine>
+#include <deque>
+#include <exception>
+#include <future>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <system_error>
+#include <utility>
+#include <variant>
+#include <vector>
+#include <cerrno>
+#include <cstring>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include "thread_pool.h"
+#include "timer_wheel.h"
+
+template <typename T = void>
+class Task;
+
+namespace detail
+{
+  /// resumes whoever awaited the finished task, by symmetric transfer
+  struct FinalAwaiter
+  {
+    bool await_ready() noexcept { return false; }
+
+    template <typename Promise>
+    std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> h) noexcept
+    {
+      auto next = h.promise().continuation;
+      return next ? next : std::noop_coroutine();
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  struct PromiseBase
+  {
+    std::suspend_always initial_suspend() noexcept { return {}; }
+    FinalAwaiter final_suspend() noexcept { return {}; }
+
+    std::coroutine_handle<> continuation;
+  };
+
+  template <typename T>
+  struct Promise : PromiseBase
+  {
+    Task<T> get_return_object() noexcept;
+
+    template <typename U>
+    void return_value(U&& v) { result.template emplace<1>(std::forward<U>(v)); }
+
+    void unhandled_exception() noexcept { result.template emplace<2>(std::current_exception()); }
+
+    T get()
+    {
+      if (result.index() == 2)
+        std::rethrow_exception(std::get<2>(result));
+      return std::move(std::get<1>(result));
+    }
+
+    std::variant<std::monostate, T, std::exception_ptr> result;
+  };
+
+  template <>
+  struct Promise<void> : PromiseBase
+  {
+    Task<void> get_return_object() noexcept;
+
+    void return_void() noexcept {}
+
+    void unhandled_exception() noexcept { error = std::current_exception(); }
+
+    void get()
+    {
+      if (error)
+        std::rethrow_exception(error);
+    }
+
+    std::exception_ptr error;
+  };
+
+  /// fire and forget: frees itself when done, an escaping exception terminates
+  struct Detached
+  {
+    struct promise_type
+    {
+      Detached get_return_object() noexcept
+      {
+        return { std::coroutine_handle<promise_type>::from_promise(*this) };
+      }
+      std::suspend_always initial_suspend() noexcept { return {}; }
+      std::suspend_never final_suspend() noexcept { return {}; }
+      void return_void() noexcept {}
+      void unhandled_exception() noexcept { std::terminate(); }
+    };
+
+    std::coroutine_handle<promise_type> handle;
+  };
+}
+
+/// lazily started coroutine with a result; `co_await` starts it and
+/// resumes the awaiting coroutine when it is done, exceptions included
+template <typename T>
+class Task
+{
+public:
+
+  using promise_type = detail::Promise<T>;
+  using Handle = std::coroutine_handle<promise_type>;
+
+  Task() = default;
+
+  explicit Task(Handle h) : handle_(h) {}
+
+  Task(Task&& other) noexcept : handle_(std::exchange(other.handle_, nullptr)) {}
+
+  Task& operator=(Task&& other) noexcept
+  {
+    if (this != &other)
+    {
+      if (handle_)
+        handle_.destroy();
+      handle_ = std::exchange(other.handle_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Task()
+  {
+    if (handle_)
+      handle_.destroy();
+  }
+
+  auto operator co_await() && noexcept
+  {
+    struct Awaiter
+    {
+      Handle handle;
+
+      bool await_ready() noexcept { return false; }
+
+      std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+      {
+        handle.promise().continuation = awaiting;
+        return handle;
+      }
+
+      T await_resume() { return handle.promise().get(); }
+    };
+    return Awaiter { handle_ };
+  }
+
+  auto operator co_await() & noexcept { return std::move(*this).operator co_await(); }
+
+private:
+
+  Handle handle_;
+};
+
+namespace detail
+{
+  template <typename T>
+  Task<T> Promise<T>::get_return_object() noexcept
+  {
+    return Task<T>(std::coroutine_handle<Promise<T>>::from_promise(*this));
+  }
+
+  inline Task<void> Promise<void>::get_return_object() noexcept
+  {
+    return Task<void>(std::coroutine_handle<Promise<void>>::from_promise(*this));
+  }
+}
+
+/// the pool coroutines run on, plus the timer wheel and the epoll thread
+/// that resume them
+class Executor
+{
+public:
+
+  explicit Executor(size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+    : pool_(threads),
+      timers_(std::chrono::milliseconds(1), 0),
+      epoll_(::epoll_create1(EPOLL_CLOEXEC)),
+      wakeup_(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+  {
+    if (epoll_ < 0 || wakeup_ < 0)
+      throw std::system_error(errno, std::generic_category(), "epoll");
+    epoll_event ev {};
+    ev.events = EPOLLIN;
+    ev.data.ptr = nullptr;
+    ::epoll_ctl(epoll_, EPOLL_CTL_ADD, wakeup_, &ev);
+    reactor_ = joining_thread(&Executor::react, this);
+  }
+
+  /// flows still suspended are abandoned, not resumed
+  ///
+  /// the pool runs what is queued before `epoll_`, `wakeup_` and
+  /// `retired_` go, as those resumes may still close sockets
+  ~Executor()
+  {
+    stop_ = true;
+    uint64_t one = 1;
+    (void)!::write(wakeup_, &one, sizeof(one));
+    reactor_.join();
+    pool_.shutdown();
+    ::close(wakeup_);
+    ::close(epoll_);
+    for (auto s : retired_)
+      delete s;
+  }
+
+  Executor(const Executor&) = delete;
+  Executor& operator=(const Executor&) = delete;
+
+  void post(std::coroutine_handle<> h)
+  {
+    try
+    {
+      pool_.post([h] { h.resume(); });
+    }
+    catch (const std::runtime_error&)
+    {
+      // a timer firing while the executor shuts down, the flow is abandoned
+    }
+  }
+
+  /// starts `task` on the pool and forgets it
+  void spawn(Task<void> task)
+  {
+    auto d = [](Task<void> t) -> detail::Detached { co_await std::move(t); }(std::move(task));
+    post(d.handle);
+  }
+
+  /// runs `task` on the pool and waits for it, for `main` and tests
+  template <typename T>
+  T blockOn(Task<T> task)
+  {
+    std::promise<T> promise;
+    auto future = promise.get_future();
+    spawn([](Task<T> t, std::promise<T>& p) -> Task<void> {
+      try
+      {
+        if constexpr (std::is_void_v<T>)
+        {
+          co_await std::move(t);
+          p.set_value();
+        }
+        else
+        {
+          p.set_value(co_await std::move(t));
+        }
+      }
+      catch (...)
+      {
+        p.set_exception(std::current_exception());
+      }
+    }(std::move(task), promise));
+    return future.get();
+  }
+
+  /// `co_await ex.schedule()` continues on a pool thread
+  auto schedule()
+  {
+    struct Awaiter
+    {
+      Executor& ex;
+      bool await_ready() noexcept { return false; }
+      void await_suspend(std::coroutine_handle<> h) { ex.post(h); }
+      void await_resume() noexcept {}
+    };
+    return Awaiter { *this };
+  }
+
+  /// `co_await ex.sleepFor(d)` suspends for at least `d`, in 1 ms ticks
+  auto sleepFor(TimerWheel::Clock::duration d)
+  {
+    struct Awaiter
+    {
+      Executor& ex;
+      TimerWheel::Clock::duration d;
+      bool await_ready() noexcept { return d <= TimerWheel::Clock::duration::zero(); }
+      void await_suspend(std::coroutine_handle<> h) { ex.timers_.schedule(d, [ex = &ex, h] { ex->post(h); }); }
+      void await_resume() noexcept {}
+    };
+    return Awaiter { *this, d };
+  }
+
+  size_t threads() const { return pool_.size(); }
+
+private:
+
+  friend class Socket;
+
+  /// what the epoll thread knows of a socket; freed only by that thread
+  struct IoState
+  {
+    std::mutex mu;
+    std::coroutine_handle<> reader, writer;
+    bool readable = false, writable = false;    // an edge nobody waited for
+  };
+
+  void watch(int fd, IoState* state)
+  {
+    epoll_event ev {};
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = state;
+    if (::epoll_ctl(epoll_, EPOLL_CTL_ADD, fd, &ev) < 0)
+      throw std::system_error(errno, std::generic_category(), "epoll_ctl");
+  }
+
+  /// the epoll thread may still hold `state` from the current batch of
+  /// events, so it is freed before the next `epoll_wait`
+  void unwatch(int fd, IoState* state)
+  {
+    ::epoll_ctl(epoll_, EPOLL_CTL_DEL, fd, nullptr);
+    std::lock_guard<std::mutex> locker(retired_mu_);
+    retired_.push_back(state);
+  }
+
+  void react()
+  {
+    epoll_event events[256];
+    std::vector<IoState*> retired;
+    while (!stop_)
+    {
+      {
+        std::lock_guard<std::mutex> locker(retired_mu_);
+        retired.swap(retired_);
+      }
+      for (auto s : retired)
+        delete s;
+      retired.clear();
+
+      int n = ::epoll_wait(epoll_, events, 256, -1);
+      for (int i = 0; i < n; ++i)
+      {
+        auto s = static_cast<IoState*>(events[i].data.ptr);
+        if (!s)
+          continue;
+        uint32_t e = events[i].events;
+        std::coroutine_handle<> r, w;
+        {
+          std::lock_guard<std::mutex> locker(s->mu);
+          if (e & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+          {
+            r = std::exchange(s->reader, nullptr);
+            s->readable = !r;
+          }
+          if (e & (EPOLLOUT | EPOLLHUP | EPOLLERR))
+          {
+            w = std::exchange(s->writer, nullptr);
+            s->writable = !w;
+          }
+        }
+        if (r)
+          post(r);
+        if (w)
+          post(w);
+      }
+    }
+  }
+
+// data members
+private:
+
+  ThreadPool pool_;
+  TimerWheel timers_;       // callbacks only post, so they run on the timer thread
+
+  int epoll_, wakeup_;
+  std::atomic<bool> stop_{false};
+  std::mutex retired_mu_;
+  std::vector<IoState*> retired_;
+  joining_thread reactor_;
+};
+
+/// nonblocking TCP socket whose reads and writes suspend the calling coroutine
+///
+/// one reader and one writer may wait at a time. Errors come back as
+/// negative errno values from `read` and `write`, as `std::system_error`
+/// from `listen`, `accept` and `connect`.
+class Socket
+{
+public:
+
+  Socket() = default;
+
+  /// takes ownership of `fd`
+  Socket(Executor& ex, int fd)
+    : ex_(&ex), fd_(fd), state_(new Executor::IoState)
+  {
+    ::fcntl(fd_, F_SETFL, ::fcntl(fd_, F_GETFL) | O_NONBLOCK);
+    try
+    {
+      ex_->watch(fd_, state_);
+    }
+    catch (...)
+    {
+      ::close(fd_);
+      delete state_;
+      throw;
+    }
+  }
+
+  Socket(Socket&& other) noexcept
+    : ex_(other.ex_), fd_(std::exchange(other.fd_, -1)), state_(std::exchange(other.state_, nullptr))
+  {}
+
+  Socket& operator=(Socket&& other) noexcept
+  {
+    if (this != &other)
+    {
+      close();
+      ex_ = other.ex_;
+      fd_ = std::exchange(other.fd_, -1);
+      state_ = std::exchange(other.state_, nullptr);
+    }
+    return *this;
+  }
+
+  ~Socket() { close(); }
+
+  void close()
+  {
+    if (fd_ < 0)
+      return;
+    ex_->unwatch(fd_, state_);
+    ::close(fd_);
+    fd_ = -1;
+    state_ = nullptr;
+  }
+
+  int fd() const { return fd_; }
+
+  /// a listening socket on 127.0.0.1:`port`, 0 picks a free port
+  static Socket listen(Executor& ex, uint16_t port, int backlog = SOMAXCONN)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "socket");
+    int on = 1;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = loopback(port);
+    if (::bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || ::listen(fd, backlog) < 0)
+    {
+      int err = errno;
+      ::close(fd);
+      throw std::system_error(err, std::generic_category(), "listen");
+    }
+    return Socket(ex, fd);
+  }
+
+  uint16_t port() const
+  {
+    sockaddr_in addr {};
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len);
+    return ntohs(addr.sin_port);
+  }
+
+  Task<Socket> accept()
+  {
+    for (;;)
+    {
+      int fd = ::accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd >= 0)
+      {
+        int on = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        co_return Socket(*ex_, fd);
+      }
+      if (errno != EAGAIN && errno != EINTR)
+        throw std::system_error(errno, std::generic_category(), "accept");
+      co_await readable();
+    }
+  }
+
+  /// connects to 127.0.0.1:`port`
+  static Task<Socket> connect(Executor& ex, uint16_t port)
+  {
+    int fd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+      throw std::system_error(errno, std::generic_category(), "socket");
+    int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    Socket s(ex, fd);
+    sockaddr_in addr = loopback(port);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+    {
+      if (errno != EINPROGRESS)
+        throw std::system_error(errno, std::generic_category(), "connect");
+      co_await s.writable();
+      int err = 0;
+      socklen_t len = sizeof(err);
+      ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+      if (err)
+        throw std::system_error(err, std::generic_category(), "connect");
+    }
+    co_return std::move(s);
+  }
+
+  /// @return the bytes read, 0 at end of stream, -errno on error
+  Task<ssize_t> read(void* buf, size_t size)
+  {
+    for (;;)
+    {
+      ssize_t n = ::read(fd_, buf, size);
+      if (n >= 0)
+        co_return n;
+      if (errno != EAGAIN && errno != EINTR)
+        co_return -errno;
+      co_await readable();
+    }
+  }
+
+  /// writes all of `buf`, waiting while the socket buffer is full
+  /// @return `size`, or -errno on error
+  Task<ssize_t> write(const void* buf, size_t size)
+  {
+    auto p = static_cast<const char*>(buf);
+    size_t done = 0;
+    while (done < size)
+    {
+      ssize_t n = ::send(fd_, p + done, size - done, MSG_NOSIGNAL);
+      if (n >= 0)
+        done += n;
+      else if (errno == EAGAIN)
+        co_await writable();
+      else if (errno != EINTR)
+        co_return -errno;
+    }
+    co_return ssize_t(size);
+  }
+
+private:
+
+  static sockaddr_in loopback(uint16_t port)
+  {
+    sockaddr_in addr {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+  }
+
+  /// suspends until epoll reports the socket ready; an edge that came
+  /// while nobody waited is consumed instead of suspending
+  struct ReadyAwaiter
+  {
+    Executor::IoState* s;
+    bool write;
+
+    bool await_ready() noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      std::lock_guard<std::mutex> locker(s->mu);
+      bool& ready = write ? s->writable : s->readable;
+      if (ready)
+      {
+        ready = false;
+        return false;
+      }
+      (write ? s->writer : s->reader) = h;
+      return true;
+    }
+
+    void await_resume() noexcept {}
+  };
+
+  ReadyAwaiter readable() { return { state_, false }; }
+  ReadyAwaiter writable() { return { state_, true }; }
+
+// data members
+private:
+
+  Executor* ex_ = nullptr;
+  int fd_ = -1;
+  Executor::IoState* state_ = nullptr;
+};
+
+/// bounded multi-producer/multi-consumer channel between coroutines
+///
+/// `send` suspends while the channel is full and `receive` while it is
+/// empty, which is the backpressure; capacity 0 makes every send wait for a
+/// receiver. After `close` sends fail and receives drain what is buffered,
+/// then return an empty optional.
+template <typename T>
+class Channel
+{
+public:
+
+  Channel(Executor& ex, size_t capacity)
+    : ex_(ex), capacity_(capacity)
+  {}
+
+  Channel(const Channel&) = delete;
+  Channel& operator=(const Channel&) = delete;
+
+  /// `co_await ch.send(v)` is false if the channel was closed
+  auto send(T value) { return SendAwaiter { *this, std::move(value) }; }
+
+  /// `co_await ch.receive()` is empty once the channel is closed and drained
+  auto receive() { return ReceiveAwaiter { *this }; }
+
+  void close()
+  {
+    std::vector<std::coroutine_handle<>> wake;
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      closed_ = true;
+      for (auto s : senders_)
+      {
+        s->ok = false;
+        wake.push_back(s->handle);
+      }
+      for (auto r : receivers_)
+        wake.push_back(r->handle);
+      senders_.clear();
+      receivers_.clear();
+    }
+    for (auto h : wake)
+      ex_.post(h);
+  }
+
+private:
+
+  struct SendAwaiter
+  {
+    Channel& ch;
+    T value;
+    bool ok = true;
+    std::coroutine_handle<> handle {};
+
+    bool await_ready() noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      std::unique_lock<std::mutex> locker(ch.mu_);
+      if (ch.closed_)
+      {
+        ok = false;
+        return false;
+      }
+      if (!ch.receivers_.empty())
+      {
+        auto r = ch.receivers_.front();
+        ch.receivers_.pop_front();
+        r->value.emplace(std::move(value));
+        locker.unlock();
+        ch.ex_.post(r->handle);
+        return false;
+      }
+      if (ch.buffer_.size() < ch.capacity_)
+      {
+        ch.buffer_.push_back(std::move(value));
+        return false;
+      }
+      handle = h;
+      ch.senders_.push_back(this);
+      return true;
+    }
+
+    bool await_resume() noexcept { return ok; }
+  };
+
+  struct ReceiveAwaiter
+  {
+    Channel& ch;
+    std::optional<T> value {};
+    std::coroutine_handle<> handle {};
+
+    bool await_ready() noexcept { return false; }
+
+    bool await_suspend(std::coroutine_handle<> h)
+    {
+      std::unique_lock<std::mutex> locker(ch.mu_);
+      SendAwaiter* s = nullptr;
+      if (!ch.senders_.empty())
+      {
+        s = ch.senders_.front();
+        ch.senders_.pop_front();
+      }
+      if (!ch.buffer_.empty())
+      {
+        value.emplace(std::move(ch.buffer_.front()));
+        ch.buffer_.pop_front();
+        if (s)
+          ch.buffer_.push_back(std::move(s->value));
+      }
+      else if (s)
+      {
+        value.emplace(std::move(s->value));
+      }
+      else if (!ch.closed_)
+      {
+        handle = h;
+        ch.receivers_.push_back(this);
+        return true;
+      }
+      locker.unlock();
+      if (s)
+        ch.ex_.post(s->handle);
+      return false;
+    }
+
+    std::optional<T> await_resume() { return std::move(value); }
+  };
+
+// data members
+private:
+
+  Executor& ex_;
+  const size_t capacity_;
+
+  std::mutex mu_;
+  bool closed_ = false;
+  std::deque<T> buffer_;
+  std::deque<SendAwaiter*> senders_;
+  std::deque<ReceiveAwaiter*> receivers_;
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <ostream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+
+/// compile-time list of the payload types a `Message` may carry;
+/// the position of a type in the list is its id, no RTTI involved
+template <typename... Types>
+struct MessageTypes
+{
+  constexpr static size_t count = sizeof...(Types);
+
+  /// position of `T` in the list, a compile error if it is not there
+  template <typename T>
+  constexpr static size_t indexOf()
+  {
+    constexpr bool found[] = { std::is_same<T, Types>::value..., false };
+    for (size_t i = 0; i < count; ++i)
+      if (found[i])
+        return i;
+    return count;
+  }
+
+  template <typename T>
+  constexpr static bool contains() { return indexOf<T>() < count; }
+};
+
+template <typename Registry, size_t Capacity = 48>
+class Message;
+
+/// move-only message holding one payload out of a `MessageTypes` list
+///
+/// payloads up to `Capacity` bytes that move without throwing live inside
+/// the message, so making, queueing and dropping one never allocates;
+/// larger payloads go to the heap. Moves and destruction dispatch through
+/// per-type function tables indexed by the payload id, `visit` the same way.
+///
+/// the id is the payload's `getSequence()` if it has one, -1 otherwise,
+/// as with the `SetId` helper of `partial_specialization.cpp`.
+///
+///   using Msg = Message<MessageTypes<TaskMessage, DigitalMessage>>;
+///   Msg m(DigitalMessage(42, 3));
+///   m.visit([](auto& payload) { ... });
+///   DigitalMessage d;
+///   if (m.to(d)) ...
+template <size_t Capacity, typename... Types>
+class Message<MessageTypes<Types...>, Capacity>
+{
+public:
+
+  using Registry = MessageTypes<Types...>;
+
+  static_assert(Registry::count < 255, "payload ids are bytes");
+
+  /// true if `T` is stored in the message rather than on the heap
+  template <typename T>
+  constexpr static bool storedInline()
+  {
+    return sizeof(T) <= Capacity && alignof(T) <= alignof(std::max_align_t)
+        && std::is_nothrow_move_constructible<T>::value;
+  }
+
+  Message() = default;
+
+  template <typename T, typename = std::enable_if_t<Registry::template contains<std::decay_t<T>>()>>
+  Message(T&& payload)
+  {
+    from(std::forward<T>(payload));
+  }
+
+  Message(Message&& other) noexcept
+  {
+    moveFrom(other);
+  }
+
+  Message& operator=(Message&& other) noexcept
+  {
+    if (this != &other)
+    {
+      reset();
+      moveFrom(other);
+    }
+    return *this;
+  }
+
+  Message(const Message&) = delete;
+  Message& operator=(const Message&) = delete;
+
+  ~Message() { reset(); }
+
+  /// replaces the payload
+  template <typename T>
+  bool from(T&& payload)
+  {
+    using U = std::decay_t<T>;
+    static_assert(Registry::template contains<U>(), "the payload type is not registered");
+    reset();
+    setId(sequenceOf(payload, 0));
+    if constexpr (storedInline<U>())
+      new (&storage_) U(std::forward<T>(payload));
+    else
+      new (&storage_) U*(new U(std::forward<T>(payload)));
+    type_ = uint8_t(Registry::template indexOf<U>() + 1);
+    return true;
+  }
+
+  /// moves the payload out if it is a `T`
+  template <typename T>
+  bool to(T& payload)
+  {
+    if (!is<T>())
+      return false;
+    payload = std::move(get<T>());
+    reset();
+    return true;
+  }
+
+  template <typename T>
+  bool is() const
+  {
+    return type_ == Registry::template indexOf<T>() + 1;
+  }
+
+  /// @throw std::logic_error if the payload is not a `T`
+  template <typename T>
+  T& get()
+  {
+    if (!is<T>())
+      throw std::logic_error("message payload has another type");
+    return *ptr<T>();
+  }
+
+  template <typename T>
+  const T& get() const
+  {
+    return const_cast<Message*>(this)->get<T>();
+  }
+
+  /// `f(payload)`, with the payload as its own type
+  /// @throw std::logic_error on an empty message
+  template <typename F>
+  decltype(auto) visit(F&& f)
+  {
+    using R = decltype(f(std::declval<FirstType&>()));
+    using Thunk = R (*)(F&, Message&);
+    constexpr static Thunk thunks[] = { &Message::template call<Types, F, R>... };
+    if (empty())
+      throw std::logic_error("visit of an empty message");
+    return thunks[type_ - 1](f, *this);
+  }
+
+  bool empty() const { return type_ == 0; }
+
+  /// payload id, the position of its type in the registry; -1 if empty
+  int typeIndex() const { return int(type_) - 1; }
+
+  int32_t getId() const { return id_; }
+
+  void setId(int32_t id) { id_ = id; }
+
+  void print(std::ostream& strm) const
+  {
+    strm << "Message with id: " << getId() << "\n";
+  }
+
+  void reset() noexcept
+  {
+    if (type_ != 0)
+      ops_[type_ - 1].destroy(&storage_);
+    type_ = 0;
+  }
+
+private:
+
+  using FirstType = std::tuple_element_t<0, std::tuple<Types...>>;
+
+  struct Ops
+  {
+    void (*move)(void* dst, void* src) noexcept;    // leaves `src` destroyed
+    void (*destroy)(void* p) noexcept;
+  };
+
+  template <typename T>
+  static void moveImpl(void* dst, void* src) noexcept
+  {
+    if constexpr (storedInline<T>())
+    {
+      T* s = static_cast<T*>(src);
+      new (dst) T(std::move(*s));
+      s->~T();
+    }
+    else
+    {
+      new (dst) T*(*static_cast<T**>(src));
+    }
+  }
+
+  template <typename T>
+  static void destroyImpl(void* p) noexcept
+  {
+    if constexpr (storedInline<T>())
+      static_cast<T*>(p)->~T();
+    else
+      delete *static_cast<T**>(p);
+  }
+
+  constexpr static Ops ops_[] = { { &moveImpl<Types>, &destroyImpl<Types> }... };
+
+  template <typename T, typename F, typename R>
+  static R call(F& f, Message& m)
+  {
+    return f(*m.ptr<T>());
+  }
+
+  template <typename T>
+  T* ptr()
+  {
+    if constexpr (storedInline<T>())
+      return reinterpret_cast<T*>(&storage_);
+    else
+      return *reinterpret_cast<T**>(&storage_);
+  }
+
+  void moveFrom(Message& other) noexcept
+  {
+    if (other.type_ != 0)
+      ops_[other.type_ - 1].move(&storage_, &other.storage_);
+    type_ = std::exchange(other.type_, 0);
+    id_ = other.id_;
+  }
+
+  template <typename T>
+  static auto sequenceOf(const T& payload, int) -> decltype(int32_t(payload.getSequence()))
+  {
+    return payload.getSequence();
+  }
+
+  template <typename T>
+  static int32_t sequenceOf(const T&, long) { return -1; }
+
+// data members
+private:
+
+  std::aligned_storage_t<std::max(Capacity, sizeof(void*)), alignof(std::max_align_t)> storage_;
+  uint8_t type_ = 0;
+  int32_t id_ = -1;
+};
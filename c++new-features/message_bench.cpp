@@ -0,0 +1,201 @@
+// messages/s through a `BlockingQueue`: the small-buffer `Message` of
+// `message.h` against the pImpl message of `partial_specialization.cpp`,
+// whose payload lives behind a `std::unique_ptr`
+//
+// usage: message_bench [messages] [producers] [consumers]
+//
+// the payloads are those of `partial_specialization.cpp` and a joint
+// position message; heap allocations are counted by a replaced
+// `operator new`.
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <cstdlib>
+#include <new>
+#include "bounded_queue.h"
+#include "message.h"
+
+static std::atomic<size_t> allocations{0};
+
+void* operator new(size_t size)
+{
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept { std::free(p); }
+void operator delete(void* p, size_t) noexcept { std::free(p); }
+
+class TypedMessage
+{
+};
+
+class TaskMessage: public TypedMessage
+{
+};
+
+class OperationMessage: public TypedMessage
+{
+public:
+
+  OperationMessage(int32_t id = 0) : seq_id_(id) {}
+
+  int32_t getSequence() const { return seq_id_; }
+
+private:
+  int32_t seq_id_;
+};
+
+class DigitalMessage: public OperationMessage
+{
+public:
+  DigitalMessage(int32_t id = 0, int32_t out = 0) : OperationMessage(id), digital_out_(out) {}
+
+  int32_t out() const { return digital_out_; }
+
+private:
+  int32_t digital_out_;
+};
+
+class JointMessage: public OperationMessage
+{
+public:
+  JointMessage(int32_t id = 0, float base = 0) : OperationMessage(id)
+  {
+    for (int i = 0; i < 6; ++i)
+      joints_[i] = base + i;
+  }
+
+  float joint(int i) const { return joints_[i]; }
+
+private:
+  float joints_[6];
+};
+
+using Msg = Message<MessageTypes<TaskMessage, DigitalMessage, JointMessage>>;
+
+// the pImpl message, with the payload type erased behind a virtual call
+class PimplMessage
+{
+public:
+
+  PimplMessage() = default;
+
+  template <typename T>
+  PimplMessage(T msg) : pImpl_(new Model<T>(std::move(msg))) {}
+
+  int64_t value() const { return pImpl_->value(); }
+
+  bool empty() const { return !pImpl_; }
+
+private:
+
+  struct Impl
+  {
+    virtual ~Impl() = default;
+    virtual int64_t value() const = 0;
+  };
+
+  template <typename T>
+  struct Model : Impl
+  {
+    explicit Model(T m) : msg(std::move(m)) {}
+    int64_t value() const override { return valueOf(msg); }
+    T msg;
+  };
+
+  std::unique_ptr<Impl> pImpl_;
+
+public:
+
+  static int64_t valueOf(const TaskMessage&) { return 1; }
+  static int64_t valueOf(const DigitalMessage& m) { return m.getSequence() + m.out(); }
+  static int64_t valueOf(const JointMessage& m) { return m.getSequence() + int64_t(m.joint(5)); }
+};
+
+struct ValueOf
+{
+  template <typename T>
+  int64_t operator()(const T& m) const { return PimplMessage::valueOf(m); }
+};
+
+template <typename M>
+M make(size_t i)
+{
+    switch (i % 3) {
+    case 0:  return M(TaskMessage());
+    case 1:  return M(DigitalMessage(int32_t(i), 3));
+    default: return M(JointMessage(int32_t(i), 1.f));
+    }
+}
+
+int64_t valueOf(PimplMessage& m) { return m.value(); }
+int64_t valueOf(Msg& m) { return m.visit(ValueOf()); }
+
+template <typename M>
+void run(const std::string& name, size_t n, size_t producers, size_t consumers)
+{
+    BlockingQueue<M> queue(1024);
+    std::atomic<int64_t> checksum{0};
+    std::vector<std::thread> threads;
+
+    size_t allocs0 = allocations.load();
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (size_t i = p; i < n; i += producers)
+                queue.push(make<M>(i));
+        });
+
+    // an empty message stops a consumer
+    for (size_t c = 0; c < consumers; ++c)
+        threads.emplace_back([&] {
+            int64_t local = 0;
+            for (;;) {
+                M m = queue.pop();
+                if (m.empty())
+                    break;
+                local += valueOf(m);
+            }
+            checksum.fetch_add(local);
+        });
+
+    for (size_t p = 0; p < producers; ++p)
+        threads[p].join();
+    for (size_t c = 0; c < consumers; ++c)
+        queue.push(M());
+    for (size_t c = 0; c < consumers; ++c)
+        threads[producers + c].join();
+
+    double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    size_t allocs = allocations.load() - allocs0;
+
+    std::cout << std::left << std::setw(14) << name << std::right << std::fixed
+              << " Mmsgs/s: " << std::setprecision(3) << std::setw(8) << n / secs / 1e6
+              << "  allocations/msg: " << std::setprecision(2) << double(allocs) / n
+              << "  checksum: " << checksum.load() << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t n         = argc > 1 ? std::atol(argv[1]) : 2'000'000;
+    size_t producers = argc > 2 ? std::atol(argv[2]) : 1;
+    size_t consumers = argc > 3 ? std::atol(argv[3]) : 1;
+
+    static_assert(Msg::storedInline<JointMessage>(), "the payloads should fit the message");
+    std::cout << "sizeof(Message) " << sizeof(Msg) << ", sizeof(PimplMessage) " << sizeof(PimplMessage) << std::endl;
+
+    run<PimplMessage>("pImpl", n, producers, consumers);
+    run<Msg>("Message", n, producers, consumers);
+
+    return EXIT_SUCCESS;
+}
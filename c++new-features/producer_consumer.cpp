@@ -1,15 +1,16 @@
 // see [A multi-threaded Producer Consumer with C++11](http://codereview.stackexchange.com/questions/84109/a-multi-threaded-producer-consumer-with-c11)
 // note that `lock_guard` is recommended instead of `unique_lock` as it releases lock automatically follow RAII leaving the lock scope.
 // see also [](http://www.boost.org/doc/libs/1_54_0/doc/html/lockfree/examples.html) for atomics instead of locks.
+// the mutex + `notify_all` based `Buffer` has been replaced by a lock-free `BlockingQueue`,
+// see `queue_contention.cpp` for the comparison.
 //
 
 #include <iostream>
 #include <thread>
 #include <vector> // for creating an equivalent to `boost::thread_group`
 #include <mutex>
-#include <condition_variable>
-#include <deque>
 #include <random>
+#include "bounded_queue.h"
 
 template<class T>
 auto operator<<(std::ostream& os, const T& t) -> decltype(t.print(os), os)
@@ -18,46 +19,6 @@ auto operator<<(std::ostream& os, const T& t) -> decltype(t.print(os), os)
   return os;
 }
 
-// to store robot commands
-template <typename T>
-class Buffer
-{
-public:
-    void add(T&& item)
-    {
-      std::unique_lock<std::mutex> locker(mu_);
-      cond_.wait(locker, [this] { return buffer_.size() < size_; } );
-      std::cout << "add(): pushed " << item << "\n";
-      buffer_.emplace_back(std::move(item));
-      cond_.notify_all();
-    }
-
-    T remove()
-    {
-      std::unique_lock<std::mutex> locker(mu_);
-      cond_.wait(locker, [this] { return !buffer_.empty(); } );
-      auto front = std::move(buffer_.front());
-      buffer_.pop_front();
-      std::cout << "remove(): popped " << front << "\n";
-      cond_.notify_all();
-      return front;
-    }
-
-    bool empty() const
-    {
-      return buffer_.empty();
-    }
-
-    Buffer() {}
-
-private:
-    std::mutex mu_;
-    std::condition_variable cond_;
-
-    std::deque<T> buffer_;
-    const unsigned size_ = 128;
-};
-
 struct RobotCommand
 {
   int task_id, sequence_id, command_type;
@@ -89,13 +50,19 @@ main()
 
     const int producer_thread_count = 12;
     const int consumer_thread_count = 12;
-    Buffer<int> buffer;
+    BlockingQueue<int> buffer(128);
     for (int i = 0; i < producer_thread_count; i++) {
         int num = dist(engine);
-        producer_grp.emplace_back(&Buffer<int>::add, &buffer, num);
+        producer_grp.emplace_back(&BlockingQueue<int>::push, &buffer, num);
     }
     for (int i = 0; i < consumer_thread_count; i++) {
-        consumer_grp.emplace_back(&Buffer<int>::remove, &buffer);
+        consumer_grp.emplace_back([&buffer] {
+            int num = buffer.pop();
+            // printing does not belong inside the queue any more
+            static std::mutex cout_mu;
+            std::lock_guard<std::mutex> locker(cout_mu);
+            std::cout << "popped " << num << "\n";
+        });
     }
 
     join_all(producer_grp);
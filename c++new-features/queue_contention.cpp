@@ -0,0 +1,136 @@
+// contention benchmark: the mutex + condition_variable `Buffer` from `producer_consumer.cpp`
+// against the lock-free `MPMCBoundedQueue` and its `BlockingQueue` facade.
+//
+// usage: queue_contention [producers] [consumers] [items per producer]
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <chrono>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+#include "bounded_queue.h"
+
+// the former `Buffer` verbatim except that it does not print under the lock,
+// otherwise we would measure `std::cout`
+template <typename T>
+class Buffer
+{
+public:
+    void add(T&& item)
+    {
+      std::unique_lock<std::mutex> locker(mu_);
+      cond_.wait(locker, [this] { return buffer_.size() < size_; } );
+      buffer_.emplace_back(std::move(item));
+      cond_.notify_all();
+    }
+
+    T remove()
+    {
+      std::unique_lock<std::mutex> locker(mu_);
+      cond_.wait(locker, [this] { return !buffer_.empty(); } );
+      auto front = std::move(buffer_.front());
+      buffer_.pop_front();
+      cond_.notify_all();
+      return front;
+    }
+
+private:
+    std::mutex mu_;
+    std::condition_variable cond_;
+
+    std::deque<T> buffer_;
+    const unsigned size_ = 128;
+};
+
+// uniform push/pop interface for the measurement loop
+struct BufferAdapter
+{
+    Buffer<size_t> q;
+    void push(size_t v) { q.add(std::move(v)); }
+    size_t pop() { return q.remove(); }
+};
+
+struct BlockingAdapter
+{
+    BlockingQueue<size_t> q{128};
+    void push(size_t v) { q.push(v); }
+    size_t pop() { return q.pop(); }
+};
+
+// lock-free both ways, spins with `yield` instead of sleeping
+struct SpinAdapter
+{
+    MPMCBoundedQueue<size_t> q{128};
+    void push(size_t v) { while (!q.tryPush(v)) std::this_thread::yield(); }
+    size_t pop() { size_t v; while (!q.tryPop(v)) std::this_thread::yield(); return v; }
+};
+
+template <typename Queue>
+void run(const std::string& name, size_t producers, size_t consumers, size_t items)
+{
+    Queue queue;
+    const size_t total = producers * items;
+    std::atomic<size_t> consumed{0};
+    std::atomic<size_t> checksum{0};
+    std::vector<std::thread> threads;
+
+    auto start = std::chrono::steady_clock::now();
+
+    for (size_t p = 0; p < producers; ++p) {
+        threads.emplace_back([&, p] {
+            for (size_t i = 0; i < items; ++i)
+                queue.push(p * items + i + 1);
+        });
+    }
+
+    // whoever consumes the last item sends a poison pill (zero) to every consumer
+    for (size_t c = 0; c < consumers; ++c) {
+        threads.emplace_back([&] {
+            size_t local = 0;
+            for (;;) {
+                size_t v = queue.pop();
+                if (v == 0)
+                    break;
+                local += v;
+                if (consumed.fetch_add(1) + 1 == total) {
+                    for (size_t k = 0; k < consumers; ++k)
+                        queue.push(0);
+                }
+            }
+            checksum.fetch_add(local);
+        });
+    }
+
+    for (auto& t : threads)
+        t.join();
+
+    auto stop = std::chrono::steady_clock::now();
+    double secs = std::chrono::duration<double>(stop - start).count();
+
+    bool ok = checksum.load() == total * (total + 1) / 2;
+    std::cout << std::left << std::setw(18) << name
+              << " producers: " << producers
+              << " consumers: " << consumers
+              << std::fixed << std::setprecision(3)
+              << " Mops/s: " << total / secs / 1e6
+              << (ok ? "" : "  CHECKSUM MISMATCH") << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+    size_t producers = argc > 1 ? std::atoi(argv[1]) : 4;
+    size_t consumers = argc > 2 ? std::atoi(argv[2]) : 4;
+    size_t items     = argc > 3 ? std::atoi(argv[3]) : 1'000'000;
+
+    run<BufferAdapter>  ("Buffer",           producers, consumers, items);
+    run<BlockingAdapter>("BlockingQueue",    producers, consumers, items);
+    run<SpinAdapter>    ("MPMCBoundedQueue", producers, consumers, items);
+
+    return EXIT_SUCCESS;
+}
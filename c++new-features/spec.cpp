@@ -26,7 +26,8 @@
 #include <vector>
 #include <set>
 #include <functional>
-#include <boost/range/algorithm.hpp>
+#include <iterator>
+#include <type_traits>
 
 template <typename T>
 struct Inserter
@@ -62,39 +63,214 @@ size_t dist(const T& cont, typename Inserter<T>::OutputIterator it)
     return Inserter<T>().dist(cont, it);
 }
 
+// compare-exchange without branches for arithmetic types
+template <typename T>
+void compareExchange(T& a, T& b)
+{
+    T lo = std::min(a, b), hi = std::max(a, b);
+    a = lo;
+    b = hi;
+}
+
+constexpr size_t SMALL_SET = 8;
+
+// sorts the first `n` elements of `v` with a sorting network of 4 or 8
+// inputs, the tail padded with the largest of them
+template <typename T>
+void sortSmall(std::array<T, SMALL_SET>& v, size_t n)
+{
+    if (n < 2)
+        return;
+    T top = v[0];
+    for (size_t i = 1; i < n; ++i)
+        top = std::max(top, v[i]);
+    size_t width = n <= 4 ? 4 : SMALL_SET;
+    for (size_t i = n; i < width; ++i)
+        v[i] = top;
+
+    constexpr static std::pair<int, int> network4[] = {
+        {0, 1}, {2, 3}, {0, 2}, {1, 3}, {1, 2}
+    };
+    constexpr static std::pair<int, int> network8[] = {
+        {0, 2}, {1, 3}, {4, 6}, {5, 7}, {0, 4}, {1, 5}, {2, 6}, {3, 7},
+        {0, 1}, {2, 3}, {4, 5}, {6, 7}, {2, 4}, {3, 5}, {1, 4}, {3, 6},
+        {1, 2}, {3, 4}, {5, 6}
+    };
+    if (width == 4)
+        for (auto [i, j] : network4)
+            compareExchange(v[i], v[j]);
+    else
+        for (auto [i, j] : network8)
+            compareExchange(v[i], v[j]);
+}
+
+// first position in the sorted [first, last) not less than `value`, given
+// `*first < value`; probes 1, 2, 4, ... ahead before the binary search, so
+// skipping k elements costs O(log k) comparisons
+template <typename Iterator, typename T>
+Iterator gallop(Iterator first, Iterator last, const T& value)
+{
+    typename std::iterator_traits<Iterator>::difference_type step = 1, size = last - first;
+    while (step < size && first[step] < value)
+    {
+        first += step;
+        size -= step;
+        step *= 2;
+    }
+    return std::lower_bound(first, first + std::min(step, size), value);
+}
+
+// the set operations, with multiset semantics as `std::set_difference`
+// and `std::set_intersection`:
+// `keep(rank, inB)` tells whether the `rank`-th copy of a value of A is
+// in the result when B holds `inB` copies of it,
+// `merge` runs over two sorted random access ranges
+struct SetDifference
+{
+    static bool keep(unsigned rank, unsigned inB) { return rank >= inB; }
+
+    template <typename AIterator, typename BIterator, typename OutputIterator>
+    static OutputIterator merge(AIterator a, AIterator aend,
+                                BIterator b, BIterator bend, OutputIterator out)
+    {
+        while (a != aend && b != bend)
+        {
+            if (*a < *b)
+            {
+                auto next = gallop(a, aend, *b);
+                out = std::copy(a, next, out);
+                a = next;
+            }
+            else if (*b < *a)
+                b = gallop(b, bend, *a);
+            else
+                ++a, ++b;
+        }
+        return std::copy(a, aend, out);
+    }
+};
+
+struct SetIntersection
+{
+    static bool keep(unsigned rank, unsigned inB) { return rank < inB; }
+
+    template <typename AIterator, typename BIterator, typename OutputIterator>
+    static OutputIterator merge(AIterator a, AIterator aend,
+                                BIterator b, BIterator bend, OutputIterator out)
+    {
+        while (a != aend && b != bend)
+        {
+            if (*a < *b)
+                a = gallop(a, aend, *b);
+            else if (*b < *a)
+                b = gallop(b, bend, *a);
+            else
+                *out++ = *a, ++a, ++b;
+        }
+        return out;
+    }
+};
+
+// calls `f(first, last)` on the sorted range: the range itself if it is
+// random access and already sorted, a sorted copy otherwise
+template <typename Iterator, typename F>
+auto withSorted(Iterator first, Iterator last, F f)
+{
+    using Category = typename std::iterator_traits<Iterator>::iterator_category;
+    if constexpr (std::is_base_of<std::random_access_iterator_tag, Category>::value)
+        if (std::is_sorted(first, last))
+            return f(first, last);
+    std::vector<typename std::iterator_traits<Iterator>::value_type> copy(first, last);
+    std::sort(copy.begin(), copy.end());
+    return f(copy.begin(), copy.end());
+}
+
+// reads up to SMALL_SET elements into `v`, returns how many or
+// SMALL_SET + 1 if there are more
+template <typename T, typename Iterator>
+size_t readSmall(std::array<T, SMALL_SET>& v, Iterator first, Iterator last)
+{
+    size_t n = 0;
+    for (; first != last; ++first, ++n)
+        if (n == SMALL_SET)
+            return SMALL_SET + 1;
+        else
+            v[n] = *first;
+    return n;
+}
+
+// inputs of up to SMALL_SET indices, the face index lists of the mesh code,
+// never touch the heap: A is sorted by a network on the stack and every
+// element of it is compared with all of B, unsorted, into a bitmask of the
+// elements kept. Larger inputs go through a galloping merge, which copies
+// and sorts only an input that is not sorted already. Both inputs are read
+// twice, so a single pass input is copied first.
 template <typename RetCont, typename AIterator, typename BIterator, typename SetOp>
 int setOpIndices(RetCont& result,
                  AIterator contAbegin, AIterator contAend,
                  BIterator contBbegin, BIterator contBend,
                  SetOp setOp)
 {
-    RetCont contAcopy, contBcopy;
-    std::copy(contAbegin, contAend, append(contAcopy));
-    std::copy(contBbegin, contBend, append(contBcopy));
-    boost::sort(contAcopy);
-    boost::sort(contBcopy);
-    auto pos = setOp(contAcopy, contBcopy, append(result));
-    return dist(result, pos);
+    using ACategory = typename std::iterator_traits<AIterator>::iterator_category;
+    using BCategory = typename std::iterator_traits<BIterator>::iterator_category;
+    if constexpr (!std::is_base_of<std::forward_iterator_tag, ACategory>::value)
+    {
+        std::vector<typename std::iterator_traits<AIterator>::value_type> copy(contAbegin, contAend);
+        return setOpIndices(result, copy.begin(), copy.end(), contBbegin, contBend, setOp);
+    }
+    else if constexpr (!std::is_base_of<std::forward_iterator_tag, BCategory>::value)
+    {
+        std::vector<typename std::iterator_traits<BIterator>::value_type> copy(contBbegin, contBend);
+        return setOpIndices(result, contAbegin, contAend, copy.begin(), copy.end(), setOp);
+    }
+
+    std::array<typename std::iterator_traits<AIterator>::value_type, SMALL_SET> a{};
+    std::array<typename std::iterator_traits<BIterator>::value_type, SMALL_SET> b{};
+    size_t na = readSmall(a, contAbegin, contAend);
+    size_t nb = readSmall(b, contBbegin, contBend);
+    auto out = append(result);
+
+    if (na > SMALL_SET || nb > SMALL_SET)
+    {
+        out = withSorted(contAbegin, contAend, [&](auto a0, auto a1) {
+            return withSorted(contBbegin, contBend, [&](auto b0, auto b1) {
+                return setOp.merge(a0, a1, b0, b1, out);
+            });
+        });
+        return dist(result, out);
+    }
+
+    sortSmall(a, na);
+    unsigned mask = 0, rank = 0;
+    for (size_t i = 0; i < SMALL_SET; ++i)
+    {
+        unsigned inB = 0;
+        for (size_t j = 0; j < SMALL_SET; ++j)
+            inB += (j < nb) & (b[j] == a[i]);
+        // copies of a value before this one, 0 at i == 0 where a[0] == a[0]
+        rank = (rank + 1) * (i > 0) * (a[i - (i > 0)] == a[i]);
+        mask |= unsigned((i < na) & setOp.keep(rank, inB)) << i;
+    }
+    for (size_t i = 0; i < na; ++i)
+        if (mask & (1u << i))
+            *out++ = a[i];
+    return dist(result, out);
 }
 
-template <typename RetCont, typename AIterator, typename BIterator,
-          typename OutputIterator = typename RetCont::iterator>
+template <typename RetCont, typename AIterator, typename BIterator>
 int diffIndices(RetCont& result,
                 AIterator contAbegin, AIterator contAend,
                 BIterator contBbegin, BIterator contBend)
 {
-    return setOpIndices(result, contAbegin, contAend, contBbegin, contBend,
-      boost::set_difference<RetCont, RetCont, OutputIterator>);
+    return setOpIndices(result, contAbegin, contAend, contBbegin, contBend, SetDifference());
 }
 
-template <typename RetCont, typename AIterator, typename BIterator,
-          typename OutputIterator = typename RetCont::iterator>
+template <typename RetCont, typename AIterator, typename BIterator>
 int intersectIndices(RetCont& result,
                      AIterator contAbegin, AIterator contAend,
                      BIterator contBbegin, BIterator contBend)
 {
-    return setOpIndices(result, contAbegin, contAend, contBbegin, contBend,
-      boost::set_intersection<RetCont, RetCont, OutputIterator>);
+    return setOpIndices(result, contAbegin, contAend, contBbegin, contBend, SetIntersection());
 }
 
 // range-based syntax sugar BEWARE uses std::back_inserter 
@@ -102,24 +278,18 @@ template <typename RetCont, typename ARange, typename BRange>
 int diffIndicesRange(RetCont& result, const ARange& acont, const BRange& bcont)
 {
     result.clear();
-    return diffIndices<RetCont,
-                       typename ARange::const_iterator,
-                       typename BRange::const_iterator,
-                       std::back_insert_iterator<RetCont>>
-      (result, begin(acont), end(acont), begin(bcont), end(bcont));
+    return diffIndices(result, begin(acont), end(acont), begin(bcont), end(bcont));
 }
 
 template <typename RetCont, typename ARange, typename BRange>
 int intersectIndicesRange(RetCont& result, const ARange& acont, const BRange& bcont)
 {
     result.clear();
-    return intersectIndices<RetCont,
-                            typename ARange::const_iterator,
-                            typename BRange::const_iterator,
-                            std::back_insert_iterator<RetCont>>
-      (result, begin(acont), end(acont), begin(bcont), end(bcont));
+    return intersectIndices(result, begin(acont), end(acont), begin(bcont), end(bcont));
 }
 
+#include <random>
+#include <sstream>
 #include <gtest/gtest.h>
 
 TEST(SetOps, FixedSizeContainer)
@@ -146,6 +316,81 @@ TEST(SetOps, VariableSizeContainer)
     ASSERT_EQ(c[0], 3);
 }
 
+TEST(SetOps, UnsortedSmallInputs)
+{
+    std::array<int, 5> a{9, 2, 7, 4, 1}, b{7, 3, 9, 8, 0};
+    std::vector<int> c;
+    size_t size = diffIndices(c, begin(a), end(a), begin(b), end(b));
+    ASSERT_EQ(c, (std::vector<int>{1, 2, 4}));
+    ASSERT_EQ(size, 3);
+    size = intersectIndicesRange(c, a, b);
+    ASSERT_EQ(c, (std::vector<int>{7, 9}));
+    ASSERT_EQ(size, 2);
+    size = diffIndicesRange(c, std::vector<int>{}, b);
+    ASSERT_EQ(size, 0);
+}
+
+TEST(SetOps, SortedLargeInputs)
+{
+    std::vector<int> a(10000), b, c;
+    for (int i = 0; i < 10000; ++i)
+        a[i] = i;
+    for (int i = 0; i < 10000; i += 1000)
+        b.push_back(i);
+    size_t size = diffIndicesRange(c, a, b);
+    ASSERT_EQ(size, 9990);
+    ASSERT_EQ(c[999], 1000 + 1);
+    size = intersectIndicesRange(c, a, b);
+    ASSERT_EQ(c, b);
+}
+
+// both paths, sorted or not, with duplicates, against the standard algorithms
+TEST(SetOps, MatchStandardAlgorithms)
+{
+    std::mt19937 gen(7);
+    for (int test = 0; test < 2000; ++test)
+    {
+        std::vector<int> a(gen() % 20), b(gen() % 20), c, expected;
+        for (auto& x : a) x = gen() % 12;
+        for (auto& x : b) x = gen() % 12;
+        if (test % 3 == 0)
+            std::sort(a.begin(), a.end()), std::sort(b.begin(), b.end());
+        std::vector<int> as(a), bs(b);
+        std::sort(as.begin(), as.end());
+        std::sort(bs.begin(), bs.end());
+
+        std::set_difference(as.begin(), as.end(), bs.begin(), bs.end(), std::back_inserter(expected));
+        ASSERT_EQ(diffIndicesRange(c, a, b), int(expected.size()));
+        ASSERT_EQ(c, expected);
+
+        expected.clear();
+        std::set_intersection(as.begin(), as.end(), bs.begin(), bs.end(), std::back_inserter(expected));
+        ASSERT_EQ(intersectIndicesRange(c, a, b), int(expected.size()));
+        ASSERT_EQ(c, expected);
+    }
+}
+
+// single pass inputs, small and large, are read once
+TEST(SetOps, InputIterators)
+{
+    std::vector<int> c;
+    std::istringstream a("1 2 3 4"), b("3 4 5");
+    size_t size = diffIndices(c, std::istream_iterator<int>(a), std::istream_iterator<int>(),
+                              std::istream_iterator<int>(b), std::istream_iterator<int>());
+    ASSERT_EQ(c, (std::vector<int>{1, 2}));
+    ASSERT_EQ(size, 2);
+
+    std::ostringstream large;
+    for (int i = 0; i < 100; ++i)
+        large << i << ' ';
+    std::istringstream a2(large.str()), b2("50 99");
+    c.clear();
+    size = intersectIndices(c, std::istream_iterator<int>(a2), std::istream_iterator<int>(),
+                            std::istream_iterator<int>(b2), std::istream_iterator<int>());
+    ASSERT_EQ(c, (std::vector<int>{50, 99}));
+    ASSERT_EQ(size, 2);
+}
+
 int main(int argc, char **argv)
 {
     testing::InitGoogleTest(&argc, argv);
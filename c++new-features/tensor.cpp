@@ -1,83 +1,127 @@
-// stolen from  https://gist.github.com/huhlig/8b21850b54a75254be4b093551f8c2cb
-// the root is [](https://github.com/rust-lang/rust/issues/44580)
-// TODO play with it for some useful example
+// examples of `tensor.h`, and a look at what the expression templates and
+// the unrolled kernels buy against plain loops
+//
+// usage: tensor [repetitions]
 
 #include <iostream>
-#include <utility>
-#include <initializer_list>
-#include <iterator>
-#include <array>
+#include <chrono>
+#include <cstdlib>
+#include <cmath>
 #include <algorithm>
+#include "tensor.h"
 
-namespace linAlg {
-  template<typename T, unsigned ...dims> class Tensor {
-  private:
-    template<unsigned N, typename TT, unsigned ...dims1> struct Type;
+using namespace linAlg;
 
-    template<unsigned N, unsigned dim, unsigned ...dims1, unsigned ...dims2> struct Type<N, std::integer_sequence<unsigned, dim, dims1...>, dims2...> {
-      using type = typename Type<N-1, std::integer_sequence<unsigned, dims1...>, dims2..., dim>::type;
-    };
-
-    template<unsigned dim, unsigned ...dims1, unsigned ...dims2> struct Type<0, std::integer_sequence<unsigned, dim, dims1...>, dims2...> {
-      using type = Tensor<Tensor<T, dim, dims1...>, dims2...>;
-    };
-
-    template<unsigned N, typename dims1> struct getDim;
-
-    template<unsigned N, unsigned dim, unsigned ...dims1> struct getDim<N, std::integer_sequence<unsigned, dim, dims1...>> {
-      static const unsigned value = getDim<N-1, std::integer_sequence<unsigned, dims1...>>::value;
-    };
-
-    template<unsigned dim, unsigned ...dims1> struct getDim<0, std::integer_sequence<unsigned, dim, dims1...>> {
-      static const unsigned value = dim;
-    };
-
-  public:
-    std::array<T, (dims*...)> scalar;
-
-    Tensor() = default;
-
-    Tensor(const Tensor<T, dims...>& tensorIn) {
-      for (unsigned i = 0; i < (dims*...); i++)
-        scalar[i] = tensorIn.scalar[i];
-    }
-
-    Tensor(Tensor<T, dims...>&& tensorIn) {
-      for (unsigned i = 0; i < (dims*...); i++)
-        scalar[i] = std::move(tensorIn.scalar[i]);
-    }
-
-    template<typename ...TT> Tensor(const TT&... args)
-    : scalar{args...} {}
-
-    Tensor(std::initializer_list<T> list) {
-      std::copy(list.begin(), list.end(), std::inserter(scalar, scalar.begin()));
-    }
-
-    template<unsigned ...dims1> Tensor(Tensor<T, dims1...> tensorIn) {
-      // TODO: constructor from higher and lower dimensional tensor
-    }
-
-    static constexpr unsigned getOrder() {
-      return sizeof...(dims);
-    }
+template<typename F> double nsPer(unsigned reps, F f) {
+  auto t0 = std::chrono::steady_clock::now();
+  for (unsigned r = 0; r < reps; r++)
+    f(r);
+  return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - t0).count() / reps;
+}
 
-    template<unsigned N> static constexpr unsigned getNthDim() {
-      return getDim<N, std::integer_sequence<unsigned, dims...>>::value;
-    }
+// keeps the optimizer from dropping a result
+template<typename T> void use(const T& x) {
+  asm volatile("" : : "g"(&x) : "memory");
+}
 
-    template<unsigned dimInt> auto getLower() {
-      return typename Type<dimInt, std::integer_sequence<unsigned, dims...>>::type(*this);
+template<typename T, unsigned M, unsigned K, unsigned N>
+void naiveMatmul(const T (&a)[M][K], const T (&b)[K][N], T (&c)[M][N]) {
+  for (unsigned i = 0; i < M; i++)
+    for (unsigned j = 0; j < N; j++) {
+      c[i][j] = 0;
+      for (unsigned k = 0; k < K; k++)
+        c[i][j] += a[i][k] * b[k][j];
     }
-
-    using type = T;
-  };
-
-  template<typename T, unsigned dim1> using Vector = Tensor<T, dim1>;
-  template<typename T, unsigned dim1, unsigned dim2> using Matrix = Tensor<T, dim1, dim2>;
 }
 
-int main() {
-  std::cout << linAlg::Tensor<float, 1, 2, 3, 4, 5, 6, 7, 8>().getLower<5>().scalar.at(0).getOrder() << std::endl;
+int main(int argc, char** argv) {
+  unsigned reps = argc > 1 ? std::max(std::atoi(argv[1]), 1) : 1'000'000;
+
+  // the original example: the first five axes outside, the other three inside
+  std::cout << Tensor<float, 1, 2, 3, 4, 5, 6, 7, 8>().getLower<5>().scalar.at(0).getOrder() << std::endl;
+
+  Matrix<float, 2, 3> a { 1.f, 2.f, 3.f, 4.f, 5.f, 6.f };
+  Matrix<float, 3, 2> b(a);                 // same elements, other shape
+  Matrix<float, 2, 2> ab = matmul(a, b);
+  Vector<float, 3> v { 1.f, 0.f, -1.f };
+  Vector<float, 2> av = matmul(a, v);
+  Matrix<float, 3, 3> aTa = matmul(transpose(a), a);
+  std::cout << "a*b = [" << ab(0, 0) << " " << ab(0, 1) << "; " << ab(1, 0) << " " << ab(1, 1) << "]"
+            << ", a*v = [" << av(0) << " " << av(1) << "]"
+            << ", trace a'a = " << aTa(0, 0) + aTa(1, 1) + aTa(2, 2) << std::endl;
+
+  Tensor<double, 2, 3, 4> t;
+  for (unsigned i = 0; i < t.size(); i++)
+    t[i] = i;
+  auto flat = reshape<24>(t);
+  flat = flat * 2.0 + 1.0;                  // writes through to t
+  Tensor<double, 4, 5> w;
+  for (unsigned i = 0; i < w.size(); i++)
+    w[i] = 1.0 / (i + 1);
+  Tensor<double, 2, 3, 5> tw = tensordot<1>(t, w);
+  std::cout << "t(1,2,3) = " << t(1, 2, 3) << " (stride " << t.getStride<0>() << ")"
+            << ", (t.w)(1,2,4) = " << tw(1, 2, 4)
+            << ", sum = " << sum(tw) << ", |t| = " << std::sqrt(dot(t, t)) << std::endl;
+
+  // elementwise: one pass without temporaries against one loop per operator
+  {
+    constexpr unsigned N = 1024;
+    Tensor<float, N> x, y, z, r;
+    float xs[N], ys[N], zs[N], t1[N], t2[N], rs[N];
+    for (unsigned i = 0; i < N; i++)
+      xs[i] = x[i] = i * 0.5f, ys[i] = y[i] = 1.f + i, zs[i] = z[i] = 3.f - i * 0.25f;
+
+    double lazy = nsPer(std::max(reps / 100, 1u), [&](unsigned) { r = 2.f * x + y * z - x / y; use(r); });
+    double eager = nsPer(std::max(reps / 100, 1u), [&](unsigned) {
+      for (unsigned i = 0; i < N; i++) t1[i] = 2.f * xs[i];
+      for (unsigned i = 0; i < N; i++) t2[i] = ys[i] * zs[i];
+      for (unsigned i = 0; i < N; i++) t1[i] = t1[i] + t2[i];
+      for (unsigned i = 0; i < N; i++) t2[i] = xs[i] / ys[i];
+      for (unsigned i = 0; i < N; i++) rs[i] = t1[i] - t2[i];
+      use(rs);
+    });
+    bool same = true;
+    for (unsigned i = 0; i < N; i++)
+      same = same && r[i] == rs[i];
+    std::cout << "2x + yz - x/y over " << N << " floats: expression " << lazy << " ns, "
+              << "a loop per operator " << eager << " ns" << (same ? "" : "  RESULTS DIFFER") << std::endl;
+  }
+
+  // small products: unrolled at compile time against the triple loop
+  {
+    Matrix<float, 4, 4> m, n, p;
+    float ms[4][4], ns[4][4], ps[4][4];
+    for (unsigned i = 0; i < 16; i++)
+      ms[i / 4][i % 4] = m[i] = 0.1f * i, ns[i / 4][i % 4] = n[i] = 1.f - 0.05f * i;
+
+    double unrolled = nsPer(reps, [&](unsigned r) { m[0] = float(r); p = matmul(m, n); use(p); });
+    double loops = nsPer(reps, [&](unsigned r) { ms[0][0] = float(r); naiveMatmul(ms, ns, ps); use(ps); });
+    std::cout << "4x4 matmul: unrolled " << unrolled << " ns, triple loop " << loops << " ns" << std::endl;
+
+    Matrix<double, 3, 3> q, s;
+    for (unsigned i = 0; i < 9; i++)
+      q[i] = i + 1.0;
+    double q3 = nsPer(reps, [&](unsigned r) { q[0] = r; s = matmul(q, q); use(s); });
+    std::cout << "3x3 matmul: unrolled " << q3 << " ns" << std::endl;
+  }
+
+  // a larger product goes through the vectorized row kernel
+  {
+    Matrix<float, 64, 64> m, n;
+    for (unsigned i = 0; i < m.size(); i++)
+      m[i] = (i % 7) * 0.5f, n[i] = (i % 5) - 2.f;
+    static float ms[64][64], ns[64][64], ps[64][64];
+    std::copy(m.begin(), m.end(), &ms[0][0]);
+    std::copy(n.begin(), n.end(), &ns[0][0]);
+    Matrix<float, 64, 64> p;
+    double simd = nsPer(std::max(reps / 1000, 1u), [&](unsigned) { p = matmul(m, n); use(p); });
+    double loops = nsPer(std::max(reps / 1000, 1u), [&](unsigned) { naiveMatmul(ms, ns, ps); use(ps); });
+    float err = 0;
+    for (unsigned i = 0; i < 64 * 64; i++)
+      err = std::max(err, std::abs(p[i] - ps[i / 64][i % 64]));
+    std::cout << "64x64 matmul: packets " << simd / 1e3 << " us, triple loop " << loops / 1e3
+              << " us, max difference " << err << std::endl;
+  }
+
   return 0;
 }
@@ -0,0 +1,601 @@
+// fixed size tensors with expression templates
+//
+// the tensor started as https://gist.github.com/huhlig/8b21850b54a75254be4b093551f8c2cb
+// (the root is https://github.com/rust-lang/rust/issues/44580), with
+// - elementwise expressions, evaluated lazily in one loop without temporaries:
+//     Tensor<float, 8, 8> a, b, c;  c = 2.f * a + b / (a - 1.f);
+// - strides fixed at compile time, `reshape<...>` views of the same storage
+// - contractions: `tensordot<n>` over the last n axes of one and the first n
+//   of the other, `matmul` for matrices and matrix-vector products
+// - SIMD packets (GCC vector extensions) in the evaluation, reduction and
+//   matmul loops, and fully unrolled kernels for products up to 4x4
+
+#pragma once
+
+#include <utility>
+#include <initializer_list>
+#include <iterator>
+#include <array>
+#include <algorithm>
+#include <cstring>
+#include <type_traits>
+#include <functional>
+#include <cstdint>
+#include <stdexcept>
+
+namespace linAlg {
+
+  template<typename T, unsigned ...dims> class Tensor;
+  template<typename T, unsigned ...dims> class TensorMap;
+
+  //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−− shapes
+
+  template<unsigned ...dims> struct Shape {
+    using type = std::integer_sequence<unsigned, dims...>;
+
+    static constexpr unsigned order = sizeof...(dims);
+    static constexpr unsigned size = (1u * ... * dims);
+
+    template<unsigned N> static constexpr unsigned extent() {
+      constexpr unsigned d[] = { dims... };
+      return d[N];
+    }
+
+    // row major: the last index is contiguous
+    template<unsigned N> static constexpr unsigned stride() {
+      constexpr unsigned d[] = { dims... };
+      unsigned s = 1;
+      for (unsigned i = N + 1; i < order; i++)
+        s *= d[i];
+      return s;
+    }
+
+    template<typename ...I, unsigned ...N>
+    static constexpr unsigned offsetOf(std::integer_sequence<unsigned, N...>, I... idx) {
+      return ((unsigned(idx) * stride<N>()) + ... + 0u);
+    }
+
+    template<typename ...I> static constexpr unsigned offset(I... idx) {
+      static_assert(sizeof...(I) == order, "one index per dimension");
+      return offsetOf(std::make_integer_sequence<unsigned, order>(), idx...);
+    }
+  };
+
+  namespace detail {
+
+    // the first N of a sequence and the rest
+    template<unsigned N, typename Head, typename Tail, bool = (N == 0)> struct split;
+
+    template<unsigned N, unsigned ...h, unsigned t, unsigned ...ts>
+    struct split<N, std::integer_sequence<unsigned, h...>, std::integer_sequence<unsigned, t, ts...>, false> {
+      using next = split<N - 1, std::integer_sequence<unsigned, h..., t>, std::integer_sequence<unsigned, ts...>>;
+      using head = typename next::head;
+      using tail = typename next::tail;
+    };
+
+    template<typename Head, typename Tail> struct split<0, Head, Tail, true> {
+      using head = Head;
+      using tail = Tail;
+    };
+
+    template<unsigned N, typename Seq> using take = typename split<N, std::integer_sequence<unsigned>, Seq>::head;
+    template<unsigned N, typename Seq> using drop = typename split<N, std::integer_sequence<unsigned>, Seq>::tail;
+
+    template<typename Seq> struct product;
+    template<unsigned ...d> struct product<std::integer_sequence<unsigned, d...>> {
+      static constexpr unsigned value = (1u * ... * d);
+    };
+
+    template<typename T, typename A, typename B> struct join;
+    template<typename T, unsigned ...a, unsigned ...b>
+    struct join<T, std::integer_sequence<unsigned, a...>, std::integer_sequence<unsigned, b...>> {
+      using type = Tensor<T, a..., b...>;
+    };
+
+    //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−− SIMD packets
+
+#if defined(__AVX__)
+    constexpr unsigned VECTOR_BYTES = 32;
+#else
+    constexpr unsigned VECTOR_BYTES = 16;
+#endif
+
+    template<typename T> constexpr bool simdType =
+#if defined(__GNUC__)
+      std::is_same<T, float>::value || std::is_same<T, double>::value ||
+      std::is_same<T, int32_t>::value || std::is_same<T, int64_t>::value;
+#else
+      false;
+#endif
+
+    template<typename T, bool = simdType<T>> struct Packet {
+      static constexpr unsigned width = 1;
+      using type = T;
+    };
+
+#if defined(__GNUC__)
+    template<typename T> struct Packet<T, true> {
+      static constexpr unsigned width = VECTOR_BYTES / sizeof(T);
+      typedef T type __attribute__((vector_size(VECTOR_BYTES)));
+    };
+#endif
+
+    template<typename T> using packet_t = typename Packet<T>::type;
+
+    // unaligned, a map may point anywhere
+    template<typename T> inline packet_t<T> load(const T* p) {
+      packet_t<T> v;
+      std::memcpy(&v, p, sizeof(v));
+      return v;
+    }
+
+    template<typename T> inline void store(T* p, const packet_t<T>& v) {
+      std::memcpy(p, &v, sizeof(v));
+    }
+
+    template<typename T, unsigned ...i> inline packet_t<T> broadcast(T x, std::integer_sequence<unsigned, i...>) {
+      return packet_t<T> { (void(i), x)... };
+    }
+
+    template<typename T> inline packet_t<T> broadcast(T x) {
+      return broadcast(x, std::make_integer_sequence<unsigned, Packet<T>::width>());
+    }
+
+    template<typename T> inline T hsum(const packet_t<T>& v) {
+      T s {};
+      for (unsigned i = 0; i < Packet<T>::width; i++)
+        s += v[i];
+      return s;
+    }
+  }
+
+  //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−− expressions
+
+  // base of everything that can be evaluated elementwise; an expression `E`
+  // provides `value_type`, `shape`, `operator[](flat index)`, and when
+  // `vectorizable` `packet(flat index)`. `elementwise` says every operand is
+  // read at the flat index being written, so assigning to an operand is safe.
+  template<typename E> struct Expr {
+    const E& self() const { return static_cast<const E&>(*this); }
+  };
+
+  template<typename E> constexpr bool isExpr = std::is_base_of<Expr<E>, E>::value;
+
+  namespace detail {
+    // tensors are held by reference, the short lived expression nodes by value
+    template<typename E> struct isStorage : std::false_type {};
+    template<typename T, unsigned ...d> struct isStorage<Tensor<T, d...>> : std::true_type {};
+    template<typename T, unsigned ...d> struct isStorage<TensorMap<T, d...>> : std::true_type {};
+
+    template<typename E> using operand_t = std::conditional_t<isStorage<E>::value, const E&, E>;
+  }
+
+  template<typename T, typename S> struct Scalar : Expr<Scalar<T, S>> {
+    using value_type = T;
+    using shape = S;
+    static constexpr bool vectorizable = true;
+    static constexpr bool elementwise = true;
+
+    T value;
+
+    explicit Scalar(T v) : value(v) {}
+    T operator[](unsigned) const { return value; }
+    detail::packet_t<T> packet(unsigned) const { return detail::broadcast(value); }
+  };
+
+  template<typename Op, typename L, typename R> struct Binary : Expr<Binary<Op, L, R>> {
+    using value_type = typename L::value_type;
+    using shape = typename L::shape;
+    static_assert(std::is_same<typename L::shape::type, typename R::shape::type>::value,
+                  "elementwise operands must have the same dimensions");
+    static_assert(std::is_same<typename L::value_type, typename R::value_type>::value,
+                  "elementwise operands must have the same element type");
+    static constexpr bool vectorizable = L::vectorizable && R::vectorizable && Op::vectorizable
+                                         && detail::simdType<value_type>;
+    static constexpr bool elementwise = L::elementwise && R::elementwise;
+
+    detail::operand_t<L> l;
+    detail::operand_t<R> r;
+
+    Binary(const L& l, const R& r) : l(l), r(r) {}
+    value_type operator[](unsigned i) const { return Op::apply(l[i], r[i]); }
+    auto packet(unsigned i) const { return Op::apply(l.packet(i), r.packet(i)); }
+  };
+
+  template<typename F, typename E> struct Map : Expr<Map<F, E>> {
+    using value_type = std::decay_t<decltype(std::declval<F>()(std::declval<typename E::value_type>()))>;
+    using shape = typename E::shape;
+    static constexpr bool vectorizable = false;
+    static constexpr bool elementwise = E::elementwise;
+
+    F f;
+    detail::operand_t<E> e;
+
+    Map(F f, const E& e) : f(f), e(e) {}
+    value_type operator[](unsigned i) const { return f(e[i]); }
+  };
+
+  template<typename E> struct Negate : Expr<Negate<E>> {
+    using value_type = typename E::value_type;
+    using shape = typename E::shape;
+    static constexpr bool vectorizable = E::vectorizable;
+    static constexpr bool elementwise = E::elementwise;
+
+    detail::operand_t<E> e;
+
+    explicit Negate(const E& e) : e(e) {}
+    value_type operator[](unsigned i) const { return -e[i]; }
+    auto packet(unsigned i) const { return -e.packet(i); }
+  };
+
+  template<typename E> struct Transpose : Expr<Transpose<E>> {
+    using value_type = typename E::value_type;
+    static constexpr unsigned rows = E::shape::template extent<0>();
+    static constexpr unsigned cols = E::shape::template extent<1>();
+    using shape = Shape<cols, rows>;
+    static constexpr bool vectorizable = false;
+    static constexpr bool elementwise = false;
+
+    detail::operand_t<E> e;
+
+    explicit Transpose(const E& e) : e(e) {}
+    value_type operator[](unsigned i) const { return e[(i % rows) * cols + i / rows]; }
+  };
+
+  namespace ops {
+#define LINALG_BINARY_OP(Name, op)                                            \
+    struct Name {                                                             \
+      static constexpr bool vectorizable = true;                              \
+      template<typename A, typename B> static auto apply(const A& a, const B& b) { return a op b; } \
+    };
+    LINALG_BINARY_OP(Add, +)
+    LINALG_BINARY_OP(Sub, -)
+    LINALG_BINARY_OP(Mul, *)
+    LINALG_BINARY_OP(Div, /)
+#undef LINALG_BINARY_OP
+  }
+
+#define LINALG_OPERATOR(op, Name)                                             \
+  template<typename L, typename R>                                            \
+  auto operator op(const Expr<L>& l, const Expr<R>& r) {                      \
+    return Binary<ops::Name, L, R>(l.self(), r.self());                       \
+  }                                                                           \
+  template<typename L, typename S, typename = std::enable_if_t<std::is_arithmetic<S>::value>> \
+  auto operator op(const Expr<L>& l, S s) {                                   \
+    using Sc = Scalar<typename L::value_type, typename L::shape>;              \
+    return Binary<ops::Name, L, Sc>(l.self(), Sc(typename L::value_type(s))); \
+  }                                                                           \
+  template<typename S, typename R, typename = std::enable_if_t<std::is_arithmetic<S>::value>> \
+  auto operator op(S s, const Expr<R>& r) {                                   \
+    using Sc = Scalar<typename R::value_type, typename R::shape>;             \
+    return Binary<ops::Name, Sc, R>(Sc(typename R::value_type(s)), r.self()); \
+  }
+  LINALG_OPERATOR(+, Add)
+  LINALG_OPERATOR(-, Sub)
+  LINALG_OPERATOR(*, Mul)
+  LINALG_OPERATOR(/, Div)
+#undef LINALG_OPERATOR
+
+  template<typename E> auto operator-(const Expr<E>& e) {
+    return Negate<E>(e.self());
+  }
+
+  // f applied to every element, not vectorized
+  template<typename F, typename E> auto map(F f, const Expr<E>& e) {
+    return Map<F, E>(f, e.self());
+  }
+
+  template<typename E> auto transpose(const Expr<E>& e) {
+    static_assert(E::shape::order == 2, "transpose takes a matrix");
+    return Transpose<E>(e.self());
+  }
+
+  namespace detail {
+    template<typename T, typename E> void evaluate(T* dst, const E& e) {
+      constexpr unsigned N = E::shape::size;
+      unsigned i = 0;
+      if constexpr (E::vectorizable) {
+        constexpr unsigned W = Packet<T>::width;
+        for (; i + W <= N; i += W)
+          store(dst + i, e.packet(i));
+      }
+      for (; i < N; i++)
+        dst[i] = e[i];
+    }
+  }
+
+  template<typename E> auto sum(const Expr<E>& expr) {
+    using T = typename E::value_type;
+    const E& e = expr.self();
+    constexpr unsigned N = E::shape::size;
+    T s {};
+    unsigned i = 0;
+    if constexpr (E::vectorizable) {
+      constexpr unsigned W = detail::Packet<T>::width;
+      if constexpr (N >= W) {
+        auto acc = e.packet(0);
+        for (i = W; i + W <= N; i += W)
+          acc += e.packet(i);
+        s = detail::hsum<T>(acc);
+      }
+    }
+    for (; i < N; i++)
+      s += e[i];
+    return s;
+  }
+
+  template<typename L, typename R> auto dot(const Expr<L>& l, const Expr<R>& r) {
+    return sum(l * r);
+  }
+
+  //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−− storage
+
+  // elements of a tensor or map, shared by both through CRTP
+  template<typename D, typename T, unsigned ...dims> class Storage : public Expr<D> {
+  public:
+    using value_type = std::remove_const_t<T>;
+    using shape = Shape<dims...>;
+    static constexpr bool vectorizable = detail::simdType<value_type>;
+    static constexpr bool elementwise = true;
+
+    T* data() { return static_cast<D*>(this)->data(); }
+    const T* data() const { return static_cast<const D*>(this)->data(); }
+
+    T operator[](unsigned i) const { return data()[i]; }
+    T& operator[](unsigned i) { return data()[i]; }
+    auto packet(unsigned i) const { return detail::load(data() + i); }
+
+    template<typename ...I> T& operator()(I... idx) { return data()[shape::offset(idx...)]; }
+    template<typename ...I> const T& operator()(I... idx) const { return data()[shape::offset(idx...)]; }
+
+    static constexpr unsigned getOrder() { return shape::order; }
+    static constexpr unsigned size() { return shape::size; }
+    template<unsigned N> static constexpr unsigned getNthDim() { return shape::template extent<N>(); }
+    template<unsigned N> static constexpr unsigned getStride() { return shape::template stride<N>(); }
+
+    T* begin() { return data(); }
+    T* end() { return data() + size(); }
+    const T* begin() const { return data(); }
+    const T* end() const { return data() + size(); }
+
+  protected:
+    template<typename E> void assign(const Expr<E>& expr) {
+      static_assert(std::is_same<typename E::shape::type, typename shape::type>::value,
+                    "assigned expression must have the same dimensions");
+      if constexpr (E::elementwise) {
+        detail::evaluate(data(), expr.self());
+      } else {
+        Tensor<value_type, dims...> tmp(expr);     // it may read what is being written
+        std::copy(tmp.begin(), tmp.end(), begin());
+      }
+    }
+  };
+
+  // an unowned span of memory seen as a tensor, e.g. from `reshape`
+  template<typename T, unsigned ...dims> class TensorMap : public Storage<TensorMap<T, dims...>, T, dims...> {
+    using Base = Storage<TensorMap<T, dims...>, T, dims...>;
+  public:
+    explicit TensorMap(T* p) : p(p) {}
+
+    TensorMap& operator=(const TensorMap& other) { this->assign(other); return *this; }
+    template<typename E> TensorMap& operator=(const Expr<E>& e) { this->assign(e); return *this; }
+    template<typename E> TensorMap& operator+=(const Expr<E>& e) { this->assign(*this + e); return *this; }
+    template<typename E> TensorMap& operator-=(const Expr<E>& e) { this->assign(*this - e); return *this; }
+    TensorMap& operator*=(T s) { this->assign(*this * s); return *this; }
+
+    T* data() { return p; }
+    const T* data() const { return p; }
+
+  private:
+    T* p;
+  };
+
+  template<typename T, unsigned ...dims> class Tensor : public Storage<Tensor<T, dims...>, T, dims...> {
+  private:
+    template<unsigned N, typename TT, unsigned ...dims1> struct Type;
+
+    template<unsigned N, unsigned dim, unsigned ...dims1, unsigned ...dims2> struct Type<N, std::integer_sequence<unsigned, dim, dims1...>, dims2...> {
+      using type = typename Type<N-1, std::integer_sequence<unsigned, dims1...>, dims2..., dim>::type;
+    };
+
+    template<unsigned dim, unsigned ...dims1, unsigned ...dims2> struct Type<0, std::integer_sequence<unsigned, dim, dims1...>, dims2...> {
+      using type = Tensor<Tensor<T, dim, dims1...>, dims2...>;
+    };
+
+    static constexpr unsigned ALIGN = std::max<unsigned>(alignof(T), detail::simdType<T> ? detail::VECTOR_BYTES : 1);
+
+  public:
+    alignas(ALIGN) std::array<T, (1u * ... * dims)> scalar;
+
+    Tensor() = default;
+    Tensor(const Tensor&) = default;
+    Tensor(Tensor&&) = default;
+    Tensor& operator=(const Tensor&) = default;
+    Tensor& operator=(Tensor&&) = default;
+
+    // the elements in row major order
+    template<typename ...TT, typename = std::enable_if_t<(sizeof...(TT) > 1) && (std::is_convertible<TT, T>::value && ...)>>
+    Tensor(const TT&... args)
+    : scalar{T(args)...} {
+      static_assert(sizeof...(TT) == (1u * ... * dims), "a tensor is initialized with all of its elements");
+    }
+
+    // all the elements in row major order, no more and no fewer
+    Tensor(std::initializer_list<T> list) {
+      if (list.size() != scalar.size())
+        throw std::invalid_argument("a tensor is initialized with all of its elements");
+      std::copy(list.begin(), list.end(), scalar.begin());
+    }
+
+    // evaluates an expression in one pass
+    template<typename E> Tensor(const Expr<E>& e) {
+      static_assert(std::is_same<typename E::shape::type, typename Shape<dims...>::type>::value,
+                    "an expression makes a tensor of its own dimensions");
+      detail::evaluate(data(), e.self());
+    }
+
+    // from a tensor of another order with as many elements, row major
+    template<unsigned ...dims1, typename = std::enable_if_t<!std::is_same<Shape<dims...>, Shape<dims1...>>::value>>
+    explicit Tensor(const Tensor<T, dims1...>& tensorIn) {
+      static_assert((1u * ... * dims1) == (1u * ... * dims), "reshaping keeps the number of elements");
+      std::copy(tensorIn.scalar.begin(), tensorIn.scalar.end(), scalar.begin());
+    }
+
+    template<typename E> Tensor& operator=(const Expr<E>& e) { this->assign(e); return *this; }
+    template<typename E> Tensor& operator+=(const Expr<E>& e) { this->assign(*this + e); return *this; }
+    template<typename E> Tensor& operator-=(const Expr<E>& e) { this->assign(*this - e); return *this; }
+    Tensor& operator*=(T s) { this->assign(*this * s); return *this; }
+
+    T* data() { return scalar.data(); }
+    const T* data() const { return scalar.data(); }
+
+    // a tensor of its first `dimInt` axes whose elements are tensors of the rest
+    template<unsigned dimInt> auto getLower() const {
+      using Lower = typename Type<dimInt, std::integer_sequence<unsigned, dims...>>::type;
+      using Inner = typename Lower::type;
+      Lower lower;
+      for (unsigned o = 0; o < Lower::size(); o++)
+        std::copy_n(scalar.begin() + o * Inner::size(), Inner::size(), lower.scalar[o].scalar.begin());
+      return lower;
+    }
+
+    using type = T;
+  };
+
+  template<typename T, unsigned dim1> using Vector = Tensor<T, dim1>;
+  template<typename T, unsigned dim1, unsigned dim2> using Matrix = Tensor<T, dim1, dim2>;
+
+  // the same elements with other dimensions, no copy
+  template<unsigned ...dims1, typename T, unsigned ...dims>
+  TensorMap<T, dims1...> reshape(Tensor<T, dims...>& t) {
+    static_assert((1u * ... * dims1) == (1u * ... * dims), "reshaping keeps the number of elements");
+    return TensorMap<T, dims1...>(t.data());
+  }
+
+  template<unsigned ...dims1, typename T, unsigned ...dims>
+  TensorMap<const T, dims1...> reshape(const Tensor<T, dims...>& t) {
+    static_assert((1u * ... * dims1) == (1u * ... * dims), "reshaping keeps the number of elements");
+    return TensorMap<const T, dims1...>(t.data());
+  }
+
+  //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−− contractions
+
+  namespace detail {
+    template<unsigned K, unsigned N, typename T, unsigned ...k>
+    inline T dotUnrolled(const T* a, const T* b, std::integer_sequence<unsigned, k...>) {
+      return ((a[k] * b[k * N]) + ...);
+    }
+
+    template<unsigned K, unsigned N, typename T, unsigned ...I>
+    inline void gemmUnrolled(const T* a, const T* b, T* c, std::integer_sequence<unsigned, I...>) {
+      ((c[I] = dotUnrolled<K, N>(a + (I / N) * K, b + I % N, std::make_integer_sequence<unsigned, K>())), ...);
+    }
+
+    // rows r... of c, P packets wide; unrolled so that the sums stay in
+    // registers and each broadcast of an element of a serves P packets
+    template<unsigned K, unsigned N, unsigned P, typename T, unsigned ...r>
+    inline void gemmPanel(const T* a, const T* b, T* c, std::integer_sequence<unsigned, r...>) {
+      constexpr unsigned W = Packet<T>::width;
+      packet_t<T> acc[sizeof...(r)][P] = {};
+      for (unsigned k = 0; k < K; k++) {
+        packet_t<T> bk[P];
+        for (unsigned p = 0; p < P; p++)
+          bk[p] = load(b + k * N + p * W);
+        auto row = [&](unsigned i) {
+          auto ai = broadcast(a[i * K + k]);
+          for (unsigned p = 0; p < P; p++)
+            acc[i][p] += ai * bk[p];
+        };
+        (row(r), ...);
+      }
+      for (unsigned i = 0; i < sizeof...(r); i++)
+        for (unsigned p = 0; p < P; p++)
+          store(c + i * N + p * W, acc[i][p]);
+    }
+
+    // c[M][N] = a[M][K] * b[K][N], c does not overlap a or b
+    template<unsigned M, unsigned K, unsigned N, typename T>
+    void gemm(const T* a, const T* b, T* c) {
+      if constexpr (M <= 4 && K <= 4 && N <= 4) {
+        gemmUnrolled<K, N>(a, b, c, std::make_integer_sequence<unsigned, M * N>());
+      } else if constexpr (N == 1) {
+        for (unsigned i = 0; i < M; i++)
+          c[i] = sum(TensorMap<const T, K>(a + i * K) * TensorMap<const T, K>(b));
+      } else {
+        // a panel of rows times a few packets of columns stays in registers
+        // while k runs, every packet of b loaded serves all rows of the panel
+        constexpr unsigned W = Packet<T>::width;
+        constexpr unsigned ROWS = 4, P = 2;
+        unsigned j = 0;
+        if constexpr (simdType<T>) {
+          auto panels = [&](auto packets) {
+            constexpr unsigned width = decltype(packets)::value * W;
+            for (; j + width <= N; j += width) {
+              unsigned i = 0;
+              for (; i + ROWS <= M; i += ROWS)
+                gemmPanel<K, N, decltype(packets)::value>(a + i * K, b + j, c + i * N + j,
+                                                          std::make_integer_sequence<unsigned, ROWS>());
+              for (; i < M; i++)
+                gemmPanel<K, N, decltype(packets)::value>(a + i * K, b + j, c + i * N + j,
+                                                          std::integer_sequence<unsigned, 0>());
+            }
+          };
+          panels(std::integral_constant<unsigned, P>());
+          panels(std::integral_constant<unsigned, 1>());
+        }
+        for (; j < N; j++)
+          for (unsigned i = 0; i < M; i++) {
+            T s {};
+            for (unsigned k = 0; k < K; k++)
+              s += a[i * K + k] * b[k * N + j];
+            c[i * N + j] = s;
+          }
+      }
+    }
+
+    template<typename Seq, typename T> struct TensorOf;
+    template<unsigned ...d, typename T> struct TensorOf<std::integer_sequence<unsigned, d...>, T> {
+      using type = Tensor<T, d...>;
+    };
+
+    // storage as is, anything else evaluated into a tensor
+    template<typename E> auto evaluated(const Expr<E>& e) {
+      if constexpr (isStorage<E>::value)
+        return std::cref(e.self());
+      else
+        return typename TensorOf<typename E::shape::type, typename E::value_type>::type(e);
+    }
+
+    template<typename X> const X& unwrap(const X& x) { return x; }
+    template<typename X> const X& unwrap(std::reference_wrapper<const X> x) { return x.get(); }
+  }
+
+  // sums over the last n axes of `a` and the first n axes of `b`:
+  // the result has the other axes of `a` followed by the other axes of `b`
+  template<unsigned n, typename A, typename B> auto tensordot(const Expr<A>& a, const Expr<B>& b) {
+    using T = typename A::value_type;
+    using sa = typename A::shape::type;
+    using sb = typename B::shape::type;
+    static_assert(n <= A::shape::order && n <= B::shape::order, "more axes to contract than there are");
+    using contractedA = detail::drop<A::shape::order - n, sa>;
+    using contractedB = detail::take<n, sb>;
+    static_assert(std::is_same<contractedA, contractedB>::value, "contracted axes must have the same extents");
+
+    constexpr unsigned M = detail::product<detail::take<A::shape::order - n, sa>>::value;
+    constexpr unsigned K = detail::product<contractedA>::value;
+    constexpr unsigned N = detail::product<detail::drop<n, sb>>::value;
+    using Result = typename detail::join<T, detail::take<A::shape::order - n, sa>, detail::drop<n, sb>>::type;
+
+    auto ea = detail::evaluated(a);
+    auto eb = detail::evaluated(b);
+    Result c;
+    detail::gemm<M, K, N>(detail::unwrap(ea).data(), detail::unwrap(eb).data(), c.data());
+    return c;
+  }
+
+  // matrix times matrix or vector
+  template<typename A, typename B> auto matmul(const Expr<A>& a, const Expr<B>& b) {
+    static_assert(A::shape::order == 2 && (B::shape::order == 1 || B::shape::order == 2), "matmul takes matrices");
+    return tensordot<1>(a, b);
+  }
+}
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "bounded_queue.h"
+#include "joining_thread.h"
+
+/// fixed size pool of `joining_thread`s
+///
+/// every worker owns a `MPMCBoundedQueue`; a task submitted from a worker
+/// goes to that worker's queue, one from any other thread to a shared
+/// queue, and once that is full to the worker queues in turn. A worker
+/// takes from its own queue first, then from the shared one, then steals
+/// from the other workers, so workers feeding themselves never touch a
+/// common cache line. When every queue is full the submitting thread runs
+/// the task itself, which throttles producers and cannot deadlock a task
+/// waiting for its children; `inlineRuns()` counts these, a pool whose
+/// queues are too small for its load shows it there.
+///
+/// idle workers spin a little, then sleep; a submit notifies only if a
+/// worker is asleep, as `BlockingQueue` does.
+///
+///   ThreadPool pool;
+///   auto f = pool.submit([](int a) { return a * 2; }, 21);
+///   f.get();
+///   pool.shutdown();    // runs what is queued, then joins
+class ThreadPool
+{
+public:
+
+  /// @param capacity of each worker queue and of the shared queue
+  explicit ThreadPool(size_t threads = std::max(1u, std::thread::hardware_concurrency()),
+                      size_t capacity = 1024)
+    : shared_(capacity)
+  {
+    if (threads == 0)
+      throw std::invalid_argument("thread pool needs at least one thread");
+    workers_.reserve(threads);
+    for (size_t i = 0; i < threads; ++i)
+      workers_.emplace_back(new Worker(capacity));
+    for (size_t i = 0; i < threads; ++i)
+      workers_[i]->thread = joining_thread(&ThreadPool::run, this, i);
+  }
+
+  ~ThreadPool() { shutdown(); }
+
+  ThreadPool(const ThreadPool&) = delete;
+  ThreadPool& operator=(const ThreadPool&) = delete;
+
+  size_t size() const { return workers_.size(); }
+
+  /// tasks run by the submitting thread because every queue was full
+  size_t inlineRuns() const { return inline_.load(std::memory_order_relaxed); }
+
+  /// runs `f(args...)` on a worker
+  /// @return the future of its result or exception
+  /// @throw std::runtime_error after `shutdown` unless called from a task
+  template <typename F, typename... Args>
+  auto submit(F&& f, Args&&... args)
+    -> std::future<std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>>
+  {
+    using R = std::invoke_result_t<std::decay_t<F>, std::decay_t<Args>...>;
+    std::packaged_task<R()> task(std::bind(std::forward<F>(f), std::forward<Args>(args)...));
+    auto future = task.get_future();
+    enqueue(Task(std::move(task)));
+    wake(false);
+    return future;
+  }
+
+  /// runs `f()` on a worker, no future; for callers that signal completion themselves
+  template <typename F>
+  void post(F&& f)
+  {
+    enqueue(Task(std::forward<F>(f)));
+    wake(false);
+  }
+
+  /// submits every callable of [first, last) and wakes the workers once
+  /// @return their futures in order
+  template <typename Iterator>
+  auto submitAll(Iterator first, Iterator last)
+    -> std::vector<std::future<std::invoke_result_t<typename std::iterator_traits<Iterator>::value_type>>>
+  {
+    using R = std::invoke_result_t<typename std::iterator_traits<Iterator>::value_type>;
+    std::vector<std::future<R>> futures;
+    futures.reserve(std::distance(first, last));
+    for (; first != last; ++first)
+    {
+      std::packaged_task<R()> task(*first);
+      futures.push_back(task.get_future());
+      enqueue(Task(std::move(task)));
+    }
+    wake(true);
+    return futures;
+  }
+
+  /// stops taking tasks from outside, runs everything queued, joins the workers;
+  /// tasks still running may submit more and those run too
+  void shutdown()
+  {
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      if (stopping_)
+        return;
+      stopping_ = true;
+    }
+    // an outside submit that passed its check before `stopping_` is set
+    // finishes its push before the workers may stop
+    while (submitting_.load() != 0)
+      std::this_thread::yield();
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      done_ = true;
+    }
+    sleep_.notify_all();
+    for (auto& w : workers_)
+      w->thread.join();
+  }
+
+private:
+
+  /// move-only `void()` callable, `std::function` wants copyable targets
+  class Task
+  {
+  public:
+
+    Task() = default;
+
+    template <typename F>
+    explicit Task(F&& f)
+      : impl_(new Impl<typename std::decay<F>::type>(std::forward<F>(f)))
+    {}
+
+    void operator()() { impl_->call(); }
+
+  private:
+
+    struct Base
+    {
+      virtual ~Base() = default;
+      virtual void call() = 0;
+    };
+
+    template <typename F>
+    struct Impl : Base
+    {
+      explicit Impl(F&& f) : f(std::move(f)) {}
+      void call() override { f(); }
+      F f;
+    };
+
+    std::unique_ptr<Base> impl_;
+  };
+
+  struct Worker
+  {
+    explicit Worker(size_t capacity) : queue(capacity) {}
+
+    MPMCBoundedQueue<Task> queue;
+    joining_thread thread;
+  };
+
+  /// tries before a worker goes to sleep
+  constexpr static int SPIN_COUNT = 64;
+
+  /// the worker index of the calling thread in this pool, or -1
+  long self() const
+  {
+    return current().first == this ? long(current().second) : -1;
+  }
+
+  static std::pair<const ThreadPool*, size_t>& current()
+  {
+    thread_local std::pair<const ThreadPool*, size_t> c { nullptr, 0 };
+    return c;
+  }
+
+  void enqueue(Task task)
+  {
+    long i = self();
+    if (i < 0)
+    {
+      // pairs with `shutdown`: either it sees this submit in flight and
+      // waits for it, or this submit sees `stopping_`
+      submitting_.fetch_add(1);
+      if (stopping_.load())
+      {
+        submitting_.fetch_sub(1);
+        throw std::runtime_error("submit to a thread pool that was shut down");
+      }
+      bool queued = shared_.tryPush(std::move(task));
+      // round robin, so that external producers fill all the worker queues
+      size_t first = next_.fetch_add(1, std::memory_order_relaxed);
+      for (size_t k = 0; k < workers_.size() && !queued; ++k)
+        queued = workers_[(first + k) % workers_.size()]->queue.tryPush(std::move(task));
+      submitting_.fetch_sub(1);
+      if (queued)
+        return;
+    }
+    else if (workers_[i]->queue.tryPush(std::move(task)) || shared_.tryPush(std::move(task)))
+    {
+      return;
+    }
+    inline_.fetch_add(1, std::memory_order_relaxed);
+    task();         // everything is full
+  }
+
+  bool tryTake(size_t i, Task& task)
+  {
+    if (workers_[i]->queue.tryPop(task) || shared_.tryPop(task))
+      return true;
+    for (size_t k = 1; k < workers_.size(); ++k)
+      if (workers_[(i + k) % workers_.size()]->queue.tryPop(task))
+        return true;
+    return false;
+  }
+
+  bool anyWork() const
+  {
+    if (!shared_.empty())
+      return true;
+    for (auto& w : workers_)
+      if (!w->queue.empty())
+        return true;
+    return false;
+  }
+
+  /// pairs with the `fetch_add` of a worker going to sleep: either it sees
+  /// the task while evaluating its predicate or we see it asleep
+  void wake(bool all)
+  {
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) > 0)
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      if (all)
+        sleep_.notify_all();
+      else
+        sleep_.notify_one();
+    }
+  }
+
+  void run(size_t i)
+  {
+    current() = { this, i };
+    Task task;
+    for (;;)
+    {
+      bool found = false;
+      for (int n = 0; n < SPIN_COUNT && !found; ++n)
+      {
+        found = tryTake(i, task);
+        if (!found)
+          std::this_thread::yield();
+      }
+      if (found)
+      {
+        task();
+        task = Task();
+        continue;
+      }
+
+      std::unique_lock<std::mutex> locker(mu_);
+      sleeping_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      sleep_.wait(locker, [this] { return done_ || anyWork(); });
+      sleeping_.fetch_sub(1);
+      if (done_ && !anyWork())
+        return;
+    }
+  }
+
+// data members
+private:
+
+  MPMCBoundedQueue<Task> shared_;
+  std::vector<std::unique_ptr<Worker>> workers_;
+
+  std::mutex mu_;
+  std::condition_variable sleep_;
+  std::atomic<int> sleeping_{0};
+  std::atomic<bool> stopping_{false};   // outside submits are refused
+  std::atomic<size_t> submitting_{0};   // outside submits past that check
+  bool done_ = false;                   // the workers stop once idle, under `mu_`
+  std::atomic<size_t> next_{0};
+  std::atomic<size_t> inline_{0};
+};
@@ -0,0 +1,162 @@
+// task dispatch: `ThreadPool` against `std::async` and a thread per task
+//
+// usage: thread_pool_bench [threads] [tasks] [round trips]
+//
+// latency is the round trip of one empty task, submit to `future::get`,
+// measured `round trips` times in a row; throughput is `tasks` small tasks
+// submitted at once and waited for. `std::async` and a thread per task get a
+// tenth of them, in waves of `WAVE` so as not to run out of threads.
+//
+// the pool queues are sized to hold all the tasks, so that the throughput
+// measures dispatch to the workers; `inline` is the number of tasks the
+// submitting thread ran itself because every queue was full.
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <future>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <algorithm>
+#include <functional>
+#include <cstdlib>
+#include "thread_pool.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t WAVE = 1000;
+
+static std::atomic<size_t> counter{0};
+
+static void work() { counter.fetch_add(1, std::memory_order_relaxed); }
+
+void report(const std::string& what, const std::string& name, size_t n, Clock::duration d,
+            const ThreadPool* pool = nullptr)
+{
+    static size_t inlined = 0;
+    double ns = std::chrono::duration<double, std::nano>(d).count() / n;
+    std::cout << std::left << std::setw(12) << what << std::setw(20) << name << std::right
+              << std::fixed << std::setprecision(1)
+              << " ns/task: " << std::setw(10) << ns
+              << "  Mtasks/s: " << std::setw(8) << std::setprecision(3) << 1e3 / ns;
+    if (pool) {
+        std::cout << "  inline: " << pool->inlineRuns() - inlined;
+        inlined = pool->inlineRuns();
+    }
+    std::cout << std::endl;
+}
+
+void check(size_t expected)
+{
+    if (counter.exchange(0) != expected) {
+        std::cerr << "lost tasks" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void latency(ThreadPool& pool, size_t n)
+{
+    auto t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i)
+        pool.submit(work).get();
+    report("latency", "ThreadPool", n, Clock::now() - t0, &pool);
+
+    t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i)
+        std::async(std::launch::async, work).get();
+    report("latency", "std::async", n, Clock::now() - t0);
+
+    t0 = Clock::now();
+    for (size_t i = 0; i < n; ++i)
+        std::thread(work).join();
+    report("latency", "std::thread", n, Clock::now() - t0);
+
+    check(3 * n);
+}
+
+void throughput(ThreadPool& pool, size_t n)
+{
+    auto t0 = Clock::now();
+    {
+        std::vector<std::future<void>> futures;
+        futures.reserve(n);
+        for (size_t i = 0; i < n; ++i)
+            futures.push_back(pool.submit(work));
+        for (auto& f : futures)
+            f.get();
+    }
+    report("throughput", "ThreadPool submit", n, Clock::now() - t0, &pool);
+    check(n);
+
+    t0 = Clock::now();
+    {
+        std::vector<std::function<void()>> tasks(n, work);
+        for (auto& f : pool.submitAll(tasks.begin(), tasks.end()))
+            f.get();
+    }
+    report("throughput", "ThreadPool submitAll", n, Clock::now() - t0, &pool);
+    check(n);
+
+    // tasks submitting tasks stay on their worker's own queue; a worker must
+    // not block on a future of its own queue, so the main thread counts
+    t0 = Clock::now();
+    {
+        size_t fanout = pool.size() * 4;
+        for (size_t k = 0; k < fanout; ++k)
+            pool.submit([&pool, n, fanout] {
+                for (size_t i = 0; i < n / fanout; ++i)
+                    pool.submit(work);
+            });
+        n = n / fanout * fanout;
+        while (counter.load() != n)
+            std::this_thread::yield();
+    }
+    report("throughput", "ThreadPool nested", n, Clock::now() - t0, &pool);
+    check(n);
+
+    size_t m = std::max<size_t>(1, n / 10);
+    t0 = Clock::now();
+    {
+        std::vector<std::future<void>> futures;
+        for (size_t i = 0; i < m; i += WAVE) {
+            for (size_t k = i; k < std::min(m, i + WAVE); ++k)
+                futures.push_back(std::async(std::launch::async, work));
+            for (auto& f : futures)
+                f.get();
+            futures.clear();
+        }
+    }
+    report("throughput", "std::async", m, Clock::now() - t0);
+    check(m);
+
+    t0 = Clock::now();
+    {
+        std::vector<std::thread> threads;
+        for (size_t i = 0; i < m; i += WAVE) {
+            for (size_t k = i; k < std::min(m, i + WAVE); ++k)
+                threads.emplace_back(work);
+            for (auto& t : threads)
+                t.join();
+            threads.clear();
+        }
+    }
+    report("throughput", "std::thread", m, Clock::now() - t0);
+    check(m);
+}
+
+int main(int argc, char** argv)
+{
+    size_t threads = argc > 1 ? std::atoi(argv[1]) : std::max(1u, std::thread::hardware_concurrency());
+    size_t tasks   = argc > 2 ? std::atoi(argv[2]) : 1'000'000;
+    size_t trips   = argc > 3 ? std::atoi(argv[3]) : 10'000;
+
+    // the shared queue and the worker ones together hold every task
+    ThreadPool pool(threads, tasks / (threads + 1) + 1);
+    latency(pool, trips);
+    throughput(pool, tasks);
+    pool.shutdown();
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,61 @@
+// checks of `ThreadPool` that the benchmark does not make
+//
+// usage: make thread_pool_test && ./thread_pool_test
+
+#include <chrono>
+#include <future>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+#include <gtest/gtest.h>
+#include "thread_pool.h"
+
+TEST(ThreadPool, RunsSubmittedTasks)
+{
+    ThreadPool pool(2);
+    std::vector<std::future<int>> futures;
+    for (int i = 0; i < 100; ++i)
+        futures.push_back(pool.submit([](int x) { return x * x; }, i));
+    for (int i = 0; i < 100; ++i)
+        ASSERT_EQ(futures[i].get(), i * i);
+}
+
+TEST(ThreadPool, SubmitAfterShutdownThrows)
+{
+    ThreadPool pool(2);
+    pool.shutdown();
+    ASSERT_THROW(pool.submit([] {}), std::runtime_error);
+}
+
+// every submit that does not throw runs, however it interleaves with `shutdown`
+TEST(ThreadPool, SubmitRacingShutdown)
+{
+    for (int round = 0; round < 200; ++round)
+    {
+        ThreadPool pool(2);
+        std::vector<std::future<void>> futures;
+        std::promise<void> started;
+        std::thread submitter([&] {
+            started.set_value();
+            try
+            {
+                for (;;)
+                    futures.push_back(pool.submit([] {}));
+            }
+            catch (const std::runtime_error&)
+            {
+            }
+        });
+        started.get_future().wait();
+        pool.shutdown();
+        submitter.join();
+        for (auto& f : futures)
+            ASSERT_EQ(f.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
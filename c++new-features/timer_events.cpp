@@ -4,6 +4,14 @@
 #include <chrono>
 #include <future>
 #include <iostream>
+#include "timer_wheel.h"
+
+// one wheel for all asynchronous timers instead of a sleeping thread each
+inline TimerWheel& timers()
+{
+    static TimerWheel wheel;
+    return wheel;
+}
 
 class later
 {
@@ -16,10 +24,7 @@ public:
 
         if (async)
         {
-            std::thread([after, task]() {
-                std::this_thread::sleep_for(std::chrono::milliseconds(after));
-                task();
-            }).detach();
+            timers().schedule(std::chrono::milliseconds(after), [task]() { task(); });
         }
         else
         {
@@ -34,5 +39,10 @@ int main()
     later later_test1(3000, false, [](){ std::cout << "test1 called\n"; } );
     later later_test2(3000, false, [](int a){  std::cout << "test2 called a: " << a << '\n'; }, 101);
 
+    std::promise<void> done;
+    later later_test3(1000, true, [&done](){ std::cout << "test3 called\n"; done.set_value(); } );
+    std::cout << "test3 scheduled\n";
+    done.get_future().wait();
+
     return 0;
 }
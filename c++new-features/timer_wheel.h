@@ -0,0 +1,378 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+#include "bounded_queue.h"
+#include "joining_thread.h"
+
+class TimerWheel;
+
+/// names a scheduled timer; cancelling one that already fired is harmless
+class TimerHandle
+{
+public:
+
+  TimerHandle() = default;
+
+  /// @return true if the timer was pending and will not fire any more
+  bool cancel();
+
+  bool valid() const { return wheel_ != nullptr; }
+
+private:
+
+  friend class TimerWheel;
+
+  TimerHandle(TimerWheel* wheel, uint32_t index, uint32_t generation)
+    : wheel_(wheel), index_(index), generation_(generation)
+  {}
+
+  TimerWheel* wheel_ = nullptr;
+  uint32_t index_ = 0, generation_ = 0;
+};
+
+/// hierarchical timing wheel (Varghese and Lauck) behind a single thread
+///
+/// level 0 has a slot per tick for the next 256 ticks, every further level
+/// covers 256 times the span of the one below, four levels reach 2^32 ticks
+/// (49 days with 1 ms ticks) and longer delays are re-filed when they come
+/// in range. A timer sits in a doubly linked slot list, so `schedule` and
+/// `cancel` are O(1); once per 256 ticks a slot of the next level is
+/// cascaded down. Timers live in one slab indexed by the handles, a pending
+/// timer costs a node of about 64 bytes instead of a sleeping thread.
+///
+/// the timer thread collects everything due in a tick and hands it to the
+/// expiry threads in batches of `BATCH` callbacks; with no expiry thread the
+/// callbacks run on the timer thread itself and should be short. Callbacks
+/// may schedule and cancel timers, and must not throw.
+///
+///   TimerWheel wheel;
+///   auto h = wheel.schedule(std::chrono::seconds(3), [] { ... });
+///   wheel.schedule(std::chrono::milliseconds(100), [] { ... }, std::chrono::milliseconds(100));
+///   h.cancel();
+class TimerWheel
+{
+public:
+
+  using Clock = std::chrono::steady_clock;
+  using Callback = std::function<void()>;
+
+  constexpr static unsigned LEVEL_BITS = 8;
+  constexpr static unsigned LEVELS = 4;
+  constexpr static uint64_t SLOTS = uint64_t(1) << LEVEL_BITS;
+
+  /// callbacks given to an expiry thread at once
+  constexpr static size_t BATCH = 256;
+
+  explicit TimerWheel(Clock::duration tick = std::chrono::milliseconds(1), size_t expiry_threads = 1)
+    : tick_(tick),
+      start_(Clock::now()),
+      batches_(1024)
+  {
+    std::fill(std::begin(heads_), std::end(heads_), NONE);
+    for (size_t i = 0; i < expiry_threads; ++i)
+      expiry_threads_.emplace_back(&TimerWheel::expire, this);
+    timer_thread_ = joining_thread(&TimerWheel::run, this);
+  }
+
+  /// pending timers are dropped, batches already handed out still run
+  ~TimerWheel()
+  {
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      stop_ = true;
+    }
+    wakeup_.notify_one();
+    timer_thread_.join();
+    for (size_t i = 0; i < expiry_threads_.size(); ++i)
+      batches_.push(std::vector<Callback>());
+    expiry_threads_.clear();
+  }
+
+  TimerWheel(const TimerWheel&) = delete;
+  TimerWheel& operator=(const TimerWheel&) = delete;
+
+  /// runs `callback` once after `delay`, then every `period` unless that is zero;
+  /// a timer fires in the first tick at or after its deadline
+  TimerHandle schedule(Clock::duration delay, Callback callback,
+                       Clock::duration period = Clock::duration::zero())
+  {
+    uint64_t due = ticksUntil(Clock::now() + delay);
+    uint64_t every = period > Clock::duration::zero() ? std::max<uint64_t>(1, period / tick_) : 0;
+
+    std::unique_lock<std::mutex> locker(mu_);
+    if (pending_ == 0)
+      current_ = std::max(current_, elapsed());   // nothing to catch up on
+    uint32_t i = allocate();
+    Node& n = nodes_[i];
+    n.expiry = std::max(due, current_ + 1);
+    n.period = every;
+    n.callback = std::move(callback);
+    insert(i);
+    ++pending_;
+
+    TimerHandle h(this, i, n.generation);
+    bool earlier = pending_ == 1 || n.expiry < next_wake_;
+    locker.unlock();
+    if (earlier)
+      wakeup_.notify_one();
+    return h;
+  }
+
+  /// @return true if the timer was pending and will not fire any more
+  bool cancel(const TimerHandle& h)
+  {
+    std::lock_guard<std::mutex> locker(mu_);
+    if (h.wheel_ != this || h.index_ >= nodes_.size())
+      return false;
+    Node& n = nodes_[h.index_];
+    if (n.generation != h.generation_ || n.slot == FREE)
+      return false;
+    unlink(h.index_);
+    release(h.index_);
+    --pending_;
+    return true;
+  }
+
+  size_t pending() const
+  {
+    std::lock_guard<std::mutex> locker(mu_);
+    return pending_;
+  }
+
+private:
+
+  constexpr static uint32_t NONE = ~uint32_t(0);
+  constexpr static uint32_t FREE = ~uint32_t(0);      // `slot` of an unused node
+  constexpr static uint64_t RANGE = uint64_t(1) << (LEVEL_BITS * LEVELS);
+
+  struct Node
+  {
+    uint64_t expiry = 0;        // in ticks since `start_`
+    uint64_t period = 0;        // in ticks, 0 for one shot
+    uint32_t prev = NONE, next = NONE;
+    uint32_t slot = FREE;
+    uint32_t generation = 0;
+    Callback callback;
+  };
+
+  /// the first tick at or after `t`
+  uint64_t ticksUntil(Clock::time_point t) const
+  {
+    if (t <= start_)
+      return 0;
+    return uint64_t((t - start_ + tick_ - Clock::duration(1)) / tick_);
+  }
+
+  /// the last tick that has passed
+  uint64_t elapsed() const
+  {
+    return uint64_t((Clock::now() - start_) / tick_);
+  }
+
+  uint32_t allocate()
+  {
+    if (free_.empty())
+    {
+      nodes_.emplace_back();
+      return uint32_t(nodes_.size() - 1);
+    }
+    uint32_t i = free_.back();
+    free_.pop_back();
+    return i;
+  }
+
+  void release(uint32_t i)
+  {
+    Node& n = nodes_[i];
+    n.slot = FREE;
+    ++n.generation;
+    n.callback = nullptr;
+    free_.push_back(i);
+  }
+
+  /// files the node in the slot its expiry falls into, seen from `current_`
+  void insert(uint32_t i)
+  {
+    Node& n = nodes_[i];
+    uint64_t when = n.expiry;
+    uint64_t delta = when - current_;
+    if (delta >= RANGE)
+    {
+      // beyond the top level: parked in its farthest slot, re-filed on cascade
+      when = current_ + RANGE - 1;
+      delta = RANGE - 1;
+    }
+    unsigned level = 0;
+    while (level + 1 < LEVELS && delta >= (uint64_t(1) << (LEVEL_BITS * (level + 1))))
+      ++level;
+
+    uint32_t slot = uint32_t(level * SLOTS + ((when >> (LEVEL_BITS * level)) & (SLOTS - 1)));
+    n.slot = slot;
+    n.prev = NONE;
+    n.next = heads_[slot];
+    if (n.next != NONE)
+      nodes_[n.next].prev = i;
+    heads_[slot] = i;
+    if (level == 0)
+      ++level0_;
+  }
+
+  void unlink(uint32_t i)
+  {
+    Node& n = nodes_[i];
+    if (n.prev != NONE)
+      nodes_[n.prev].next = n.next;
+    else
+      heads_[n.slot] = n.next;
+    if (n.next != NONE)
+      nodes_[n.next].prev = n.prev;
+    if (n.slot < SLOTS)
+      --level0_;
+  }
+
+  /// takes the whole list of a slot out of the wheel
+  uint32_t detach(uint64_t slot)
+  {
+    uint32_t head = heads_[slot];
+    heads_[slot] = NONE;
+    if (slot < SLOTS)
+      for (uint32_t i = head; i != NONE; i = nodes_[i].next)
+        --level0_;
+    return head;
+  }
+
+  /// moves on to tick `t`, collecting the callbacks due
+  void advance(uint64_t t, std::vector<Callback>& expired)
+  {
+    current_ = t;
+
+    // when a level wraps, the next slot of the level above comes down
+    for (unsigned level = 1; level < LEVELS; ++level)
+    {
+      if (t & ((uint64_t(1) << (LEVEL_BITS * level)) - 1))
+        break;
+      uint32_t i = detach(level * SLOTS + ((t >> (LEVEL_BITS * level)) & (SLOTS - 1)));
+      while (i != NONE)
+      {
+        uint32_t next = nodes_[i].next;
+        insert(i);
+        i = next;
+      }
+    }
+
+    uint32_t i = detach(t & (SLOTS - 1));
+    while (i != NONE)
+    {
+      Node& n = nodes_[i];
+      uint32_t next = n.next;
+      if (n.period != 0)
+      {
+        expired.push_back(n.callback);
+        n.expiry = t + n.period;
+        insert(i);
+      }
+      else
+      {
+        expired.push_back(std::move(n.callback));
+        release(i);
+        --pending_;
+      }
+      i = next;
+    }
+  }
+
+  void run()
+  {
+    std::vector<Callback> expired;
+    std::unique_lock<std::mutex> locker(mu_);
+    while (!stop_)
+    {
+      uint64_t now = elapsed();
+      while (current_ < now && pending_ != 0)
+        advance(current_ + 1, expired);
+      if (pending_ == 0)
+        current_ = std::max(current_, now);
+
+      if (!expired.empty())
+      {
+        locker.unlock();
+        dispatch(expired);
+        locker.lock();
+        continue;
+      }
+
+      // with level 0 empty nothing can fire before the next cascade
+      next_wake_ = level0_ != 0 ? current_ + 1 : ((current_ >> LEVEL_BITS) + 1) << LEVEL_BITS;
+      if (pending_ == 0)
+        wakeup_.wait(locker, [this] { return stop_ || pending_ != 0; });
+      else
+        wakeup_.wait_until(locker, start_ + tick_ * next_wake_);
+    }
+  }
+
+  void dispatch(std::vector<Callback>& expired)
+  {
+    if (expiry_threads_.empty())
+    {
+      for (auto& cb : expired)
+        cb();
+    }
+    else
+    {
+      for (size_t i = 0; i < expired.size(); i += BATCH)
+      {
+        size_t end = std::min(expired.size(), i + BATCH);
+        batches_.push(std::vector<Callback>(std::make_move_iterator(expired.begin() + i),
+                                            std::make_move_iterator(expired.begin() + end)));
+      }
+    }
+    expired.clear();
+  }
+
+  /// an empty batch stops the thread
+  void expire()
+  {
+    for (;;)
+    {
+      std::vector<Callback> batch = batches_.pop();
+      if (batch.empty())
+        return;
+      for (auto& cb : batch)
+        cb();
+    }
+  }
+
+// data members
+private:
+
+  const Clock::duration tick_;
+  const Clock::time_point start_;
+
+  mutable std::mutex mu_;
+  std::condition_variable wakeup_;
+  bool stop_ = false;
+
+  uint64_t current_ = 0;          // the last tick processed
+  uint64_t next_wake_ = 0;        // the tick the timer thread sleeps until
+  size_t pending_ = 0;
+  size_t level0_ = 0;             // timers in level 0
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> free_;
+  uint32_t heads_[LEVELS * SLOTS];
+
+  BlockingQueue<std::vector<Callback>> batches_;
+  std::vector<joining_thread> expiry_threads_;
+  joining_thread timer_thread_;
+};
+
+inline bool TimerHandle::cancel()
+{
+  return wheel_ != nullptr && wheel_->cancel(*this);
+}
@@ -0,0 +1,137 @@
+// cost of pending timers: `TimerWheel` against a thread per timer as in the
+// original `later` of `timer_events.cpp`.
+//
+// usage: timer_wheel_bench [timers] [threads for thread-per-timer]
+//
+// the wheel gets all `timers` timers, due spread over the second after the
+// next, a tenth of them cancelled again; thread-per-timer gets as many as the
+// system allows without trouble and is extrapolated per timer. Memory is the growth of the
+// resident and virtual size, cpu the user + system time of the process.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <cstdlib>
+#include <sys/resource.h>
+#include "timer_wheel.h"
+
+using Clock = std::chrono::steady_clock;
+
+// VmRSS and VmSize in kB
+struct Memory
+{
+    long rss = 0, vsize = 0;
+};
+
+Memory memory()
+{
+    Memory m;
+    std::ifstream status("/proc/self/status");
+    std::string key;
+    long value;
+    while (status >> key) {
+        if (key == "VmRSS:" && status >> value)
+            m.rss = value;
+        else if (key == "VmSize:" && status >> value)
+            m.vsize = value;
+    }
+    return m;
+}
+
+double cpuSeconds()
+{
+    rusage ru;
+    getrusage(RUSAGE_SELF, &ru);
+    return ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 + ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+}
+
+void report(const std::string& name, size_t n, double scheduleSecs, Memory before, Memory peak,
+            double cpu, double lateMs)
+{
+    std::cout << std::left << std::setw(16) << name << std::right << std::fixed
+              << " timers: " << std::setw(8) << n
+              << std::setprecision(1)
+              << "  schedule ns/timer: " << std::setw(8) << scheduleSecs * 1e9 / n
+              << "  rss B/timer: " << std::setw(8) << (peak.rss - before.rss) * 1024.0 / n
+              << "  vsize B/timer: " << std::setw(10) << (peak.vsize - before.vsize) * 1024.0 / n
+              << std::setprecision(2)
+              << "  cpu us/timer: " << std::setw(7) << cpu * 1e6 / n
+              << "  mean late ms: " << lateMs << std::endl;
+}
+
+void wheel(size_t n)
+{
+    Memory before = memory();
+    double cpu0 = cpuSeconds();
+    std::atomic<size_t> fired{0};
+    std::atomic<long long> late{0};
+
+    TimerWheel timers;
+    std::vector<TimerHandle> handles(n);
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        auto delay = std::chrono::microseconds(1'000'000 + 1'000'000 * i / n);
+        auto due = Clock::now() + delay;
+        handles[i] = timers.schedule(delay, [&fired, &late, due] {
+            late += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+            ++fired;
+        });
+    }
+    double scheduleSecs = std::chrono::duration<double>(Clock::now() - start).count();
+    Memory peak = memory();
+
+    size_t cancelled = 0;
+    for (size_t i = 0; i < n; i += 10)
+        cancelled += handles[i].cancel();
+
+    while (timers.pending() != 0)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // the last batch may still be running
+    while (fired.load() + cancelled < n)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+
+    report("TimerWheel", n, scheduleSecs, before, peak, cpuSeconds() - cpu0, late / 1e3 / fired);
+    std::cout << "  cancelled " << cancelled << ", fired " << fired << std::endl;
+}
+
+void threadPerTimer(size_t n)
+{
+    Memory before = memory();
+    double cpu0 = cpuSeconds();
+    std::atomic<long long> late{0};
+    std::vector<std::thread> threads;
+    threads.reserve(n);
+
+    auto start = Clock::now();
+    for (size_t i = 0; i < n; ++i) {
+        auto delay = std::chrono::microseconds(1'000'000 + 1'000'000 * i / n);
+        auto due = Clock::now() + delay;
+        threads.emplace_back([&late, delay, due] {
+            std::this_thread::sleep_for(delay);
+            late += std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - due).count();
+        });
+    }
+    double scheduleSecs = std::chrono::duration<double>(Clock::now() - start).count();
+    Memory peak = memory();
+
+    for (auto& t : threads)
+        t.join();
+
+    report("thread/timer", n, scheduleSecs, before, peak, cpuSeconds() - cpu0, late / 1e3 / n);
+}
+
+int main(int argc, char** argv)
+{
+    size_t timers  = argc > 1 ? std::atol(argv[1]) : 1'000'000;
+    size_t threads = argc > 2 ? std::atol(argv[2]) : 2'000;
+
+    threadPerTimer(threads);
+    wheel(timers);
+
+    return EXIT_SUCCESS;
+}
@@ -24,10 +24,25 @@
 
 #include <cmath>
 #include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
 #include "math.hpp"
 #include "FastCosineTransform.hpp"
 
+#ifdef FCT_WITH_FFTW
+#include <fftw3.h>
+#endif
+
 namespace FCT
 {
 
@@ -42,133 +57,774 @@ Eigen::VectorXd grid_span(size_t nodes, double min, double max)
     return grid;
 }
 
-void cosfft1(size_t n,
-             Eigen::Ref<Eigen::VectorXd> data,
-             TransformType transform_type)
+namespace
 {
-    size_t  m;
-    size_t  mmax, istep, i1, i2, i3, i4;
-    double  wr, wi, wpr, wpi, wtemp, theta,
-            y1, y2, tempr, tempi, h1r, h1i, h2r, h2i,
-            temp, sum, first, last;
 
-    temp = data[n];
+/// widest block of vectors gathered together, eight doubles being one
+/// cache line
+constexpr size_t MAX_LANES = 8;
 
-    if (transform_type == TransformType::Inverse) {
-        first=0.5*data[0];
-        last=0.5*temp;
+/// vectors transformed together, as many as keep the temporaries
+/// of a radix-4 butterfly in registers
+constexpr size_t SIMD_LANES = 4;
+
+bool is_power_of_two(size_t n)
+{
+    return n >= 2 && (n & (n - 1)) == 0;
+}
+
+/// per thread scratch of at least `size` doubles
+double* scratch(size_t size)
+{
+    thread_local std::vector<double> buffer;
+    if (buffer.size() < size) {
+        buffer.resize(size);
     }
+    return buffer.data();
+}
 
-    sum = 0.0;
-    for (size_t j=0; j<=n; j+=2) sum += data[j];
-    for (size_t j=1; j<=n; j+=2) sum -= data[j];
-    data[n] = sum;
-
-    wtemp = std::sin(0.5*(theta=M_PI/n));
-    wpr = -2.0*wtemp*wtemp;
-    wpi = std::sin(theta); m=n >> 1;
-    wr = 1.0;
-    wi = 0.0;
-    sum = data[0];
-    for (size_t j=1; j<=m; j++) {
-        wr = (wtemp=wr)*wpr-wi*wpi+wr;
-        wi = wi*wpr+wtemp*wpi+wi;
-        y1 = 0.5*(data[j]+data[n-j]);
-        y2 = data[j]-data[n-j];
-        data[j] = y1-wi*y2;
-        data[n-j] = y1+wi*y2;
-        sum += wr*y2;
+/// runs `f(begin, end)` over `threads` contiguous chunks of `[0, count)`,
+/// the calling thread taking the first one
+template <typename F>
+void parallel_chunks(size_t count, size_t threads, F f)
+{
+    threads = std::max<size_t>(1, std::min(threads, count));
+    std::vector<std::thread> workers;
+    workers.reserve(threads - 1);
+    for (size_t t = 1; t < threads; ++t) {
+        workers.emplace_back(f, count * t / threads, count * (t + 1) / threads);
+    }
+    f(0, count / threads);
+    for (auto& w : workers) {
+        w.join();
     }
-    size_t j = 1;
-    for (size_t i=1; i<=n; i+=2) {
+}
+
+/// transforms `count` vectors, element `j` of vector `v` being
+/// `data[v*vstride + j*estride]`, by blocks of `MAX_LANES` vectors
+/// gathered into a buffer with their elements interleaved
+void transform_blocks(size_t n,
+                      double* data,
+                      size_t count,
+                      size_t vstride,
+                      size_t estride,
+                      TransformType transform_type,
+                      size_t threads)
+{
+    const size_t blocks = (count + MAX_LANES - 1) / MAX_LANES;
+    parallel_chunks(blocks, threads, [=](size_t begin, size_t end) {
+        std::vector<double> buffer((n + 1) * MAX_LANES);
+        for (size_t b=begin; b<end; ++b) {
+            double* block = data + b * MAX_LANES * vstride;
+            size_t width = std::min(MAX_LANES, count - b * MAX_LANES);
+            for (size_t j=0; j<=n; ++j) {
+                for (size_t k=0; k<width; ++k) {
+                    buffer[j*MAX_LANES + k] = block[k*vstride + j*estride];
+                }
+            }
+            transform(n, buffer.data(), MAX_LANES, width, transform_type);
+            for (size_t j=0; j<=n; ++j) {
+                for (size_t k=0; k<width; ++k) {
+                    block[k*vstride + j*estride] = buffer[j*MAX_LANES + k];
+                }
+            }
+        }
+    });
+}
+
+} // namespace
+
+/**
+ *  @brief Complex FFT of any size `n`, `X_k = sum_j x_j exp(2*pi*i*j*k/n)`.
+ *
+ *  Sizes made of the factors 2, 3, 5 and 7 go through Stockham
+ *  passes of radix 4, 2, 3, 5 and 7, that need no digit reversal;
+ *  any other size through Bluestein's chirp-z algorithm, a circular
+ *  convolution done by FFTs of a power of two size.
+ *
+ *  Like `Plan::execute` it transforms a few vectors at once:
+ *  the real parts of element `c` of the `width` vectors are the doubles
+ *  at `x + 2*c*stride`, the imaginary parts those at `x + (2*c+1)*stride`.
+ */
+class Plan::ComplexFft
+{
+public:
+    explicit ComplexFft(size_t n);
+
+    /// rows of lanes `execute` needs in `work`
+    size_t work_size() const;
+
+    template <int Width>
+    void execute(double* x, size_t stride, size_t width, double* work) const;
+
+private:
+    struct Stage
+    {
+        size_t radix, m, s;             ///< `len = radix*m` points at stride `s`
+        Eigen::ArrayXd cos_, sin_;      ///< of `2*pi*j*u/len`, at `j*radix + u`
+        Eigen::ArrayXd roots_cos_, roots_sin_;  ///< of `2*pi*k/radix`
+    };
+
+    template <typename Lanes>
+    void stockham(double* x, size_t xstride, double* y, size_t ystride, size_t width) const;
+
+    template <typename Lanes>
+    void bluestein(double* x, size_t stride, size_t width, double* work) const;
+
+    size_t n_;
+    std::vector<Stage> stages_;
+
+    // Bluestein
+    std::shared_ptr<const ComplexFft> inner_;
+    Eigen::ArrayXd chirp_cos_, chirp_sin_;  ///< of `pi*j^2/n`
+    Eigen::ArrayXd kernel_re_, kernel_im_;  ///< the FFT of the conjugate chirp, divided by its size
+};
+
+Plan::ComplexFft::ComplexFft(size_t n)
+: n_(n)
+{
+    size_t rest = n;
+    std::vector<size_t> radices;
+    for (size_t p : {4, 2, 3, 5, 7}) {
+        while (rest % p == 0) {
+            radices.push_back(p);
+            rest /= p;
+        }
+    }
+
+    if (rest == 1) {
+        size_t len = n;
+        for (size_t p : radices) {
+            Stage stage{p, len / p, n / len, {}, {}, {}, {}};
+            stage.roots_cos_.resize(p);
+            stage.roots_sin_.resize(p);
+            for (size_t k=0; k<p; ++k) {
+                stage.roots_cos_[k] = std::cos(2.0*M_PI*double(k)/p);
+                stage.roots_sin_[k] = std::sin(2.0*M_PI*double(k)/p);
+            }
+            stage.cos_.resize(len);
+            stage.sin_.resize(len);
+            for (size_t q=0; q<stage.m; ++q) {
+                for (size_t u=0; u<p; ++u) {
+                    double angle = 2.0*M_PI*double(q*u % len)/len;
+                    stage.cos_[q*p + u] = std::cos(angle);
+                    stage.sin_[q*p + u] = std::sin(angle);
+                }
+            }
+            stages_.push_back(std::move(stage));
+            len /= p;
+        }
+        return;
+    }
+
+    // `2*pi*j*k/n = pi*(j^2 + k^2 - (k-j)^2)/n`: with the chirp
+    // `c_j = exp(pi*i*j^2/n)` the transform is `X_k = c_k sum_j (x_j c_j) conj(c_{k-j})`
+    size_t m = 1;
+    while (m < 2*n - 1) {
+        m <<= 1;
+    }
+    inner_ = std::make_shared<const ComplexFft>(m);
+
+    chirp_cos_.resize(n);
+    chirp_sin_.resize(n);
+    for (size_t j=0; j<n; ++j) {
+        double angle = M_PI*double(j*j % (2*n))/n;
+        chirp_cos_[j] = std::cos(angle);
+        chirp_sin_[j] = std::sin(angle);
+    }
+
+    std::vector<double> kernel(2*m, 0.0), work(2*m*inner_->work_size());
+    for (size_t j=0; j<n; ++j) {
+        kernel[2*j] = chirp_cos_[j] / m;
+        kernel[2*j+1] = -chirp_sin_[j] / m;
+        if (j > 0) {
+            kernel[2*(m-j)] = kernel[2*j];
+            kernel[2*(m-j)+1] = kernel[2*j+1];
+        }
+    }
+    inner_->execute<1>(kernel.data(), 1, 1, work.data());
+    kernel_re_.resize(m);
+    kernel_im_.resize(m);
+    for (size_t k=0; k<m; ++k) {
+        kernel_re_[k] = kernel[2*k];
+        kernel_im_[k] = kernel[2*k+1];
+    }
+}
+
+size_t Plan::ComplexFft::work_size() const
+{
+    return inner_ ? 2*kernel_re_.size() + inner_->work_size() : 2*n_;
+}
+
+template <int Width>
+void Plan::ComplexFft::execute(double* x, size_t stride, size_t width, double* work) const
+{
+    using Lanes = Eigen::Array<double, Width, 1, Eigen::ColMajor,
+                               Width == Eigen::Dynamic ? int(SIMD_LANES) : Width, 1>;
+    if (inner_) {
+        bluestein<Lanes>(x, stride, width, work);
+    } else {
+        stockham<Lanes>(x, stride, work, width, width);
+    }
+}
+
+/// radix `p` pass `k`: `y[q + s*(p*j + u)] = w^(j*u) sum_r x[q + s*(j + r*m)] exp(2*pi*i*r*u/p)`,
+/// `w = exp(2*pi*i/len)`; the passes alternate between `x` and `y`
+/// and the result is copied back to `x` after an odd number of them
+template <typename Lanes>
+void Plan::ComplexFft::stockham(double* x, size_t xstride, double* y, size_t ystride, size_t width) const
+{
+    constexpr size_t MAX_RADIX = 7;
+    Lanes ar[MAX_RADIX], ai[MAX_RADIX], br[MAX_RADIX], bi[MAX_RADIX];
+    Lanes t0r(width), t0i(width), t1r(width), t1i(width), t2r(width), t2i(width), t3r(width), t3i(width);
+
+    double* from = x;
+    double* to = y;
+    size_t from_stride = xstride, to_stride = ystride;
+
+    for (const Stage& stage : stages_) {
+        const size_t p = stage.radix, m = stage.m, s = stage.s;
+        auto re = [width](double* base, size_t stride, size_t e) { return Eigen::Map<Lanes>(base + 2*e*stride, width); };
+        auto im = [width](double* base, size_t stride, size_t e) { return Eigen::Map<Lanes>(base + (2*e+1)*stride, width); };
+
+        for (size_t j=0; j<m; ++j) {
+            for (size_t q=0; q<s; ++q) {
+                for (size_t r=0; r<p; ++r) {
+                    ar[r] = re(from, from_stride, q + s*(j + r*m));
+                    ai[r] = im(from, from_stride, q + s*(j + r*m));
+                }
+                if (p == 2) {
+                    br[0] = ar[0]+ar[1];
+                    bi[0] = ai[0]+ai[1];
+                    br[1] = ar[0]-ar[1];
+                    bi[1] = ai[0]-ai[1];
+                } else if (p == 4) {
+                    t0r = ar[0]+ar[2]; t0i = ai[0]+ai[2];
+                    t1r = ar[0]-ar[2]; t1i = ai[0]-ai[2];
+                    t2r = ar[1]+ar[3]; t2i = ai[1]+ai[3];
+                    t3r = ar[1]-ar[3]; t3i = ai[1]-ai[3];
+                    br[0] = t0r+t2r; bi[0] = t0i+t2i;
+                    br[2] = t0r-t2r; bi[2] = t0i-t2i;
+                    br[1] = t1r-t3i; bi[1] = t1i+t3r;       // t1 + i*t3
+                    br[3] = t1r+t3i; bi[3] = t1i-t3r;       // t1 - i*t3
+                } else {
+                    for (size_t u=0; u<p; ++u) {
+                        br[u] = ar[0];
+                        bi[u] = ai[0];
+                        for (size_t r=1; r<p; ++r) {
+                            const size_t k = r*u % p;
+                            const double c = stage.roots_cos_[k], sn = stage.roots_sin_[k];
+                            br[u] += c*ar[r] - sn*ai[r];
+                            bi[u] += c*ai[r] + sn*ar[r];
+                        }
+                    }
+                }
+                for (size_t u=0; u<p; ++u) {
+                    const size_t e = q + s*(p*j + u);
+                    if (u == 0 || j == 0) {
+                        re(to, to_stride, e) = br[u];
+                        im(to, to_stride, e) = bi[u];
+                    } else {
+                        const double c = stage.cos_[j*p + u], sn = stage.sin_[j*p + u];
+                        re(to, to_stride, e) = c*br[u] - sn*bi[u];
+                        im(to, to_stride, e) = c*bi[u] + sn*br[u];
+                    }
+                }
+            }
+        }
+        std::swap(from, to);
+        std::swap(from_stride, to_stride);
+    }
+
+    if (from != x) {
+        for (size_t e=0; e<2*n_; ++e) {
+            Eigen::Map<Lanes>(x + e*xstride, width) = Eigen::Map<Lanes>(from + e*from_stride, width);
+        }
+    }
+}
+
+template <typename Lanes>
+void Plan::ComplexFft::bluestein(double* x, size_t stride, size_t width, double* work) const
+{
+    const size_t m = kernel_re_.size();
+    Lanes tr(width), ti(width);
+
+    // `a_j = x_j c_j`, padded with zeros to `m`
+    auto are = [work, width](size_t e) { return Eigen::Map<Lanes>(work + 2*e*width, width); };
+    auto aim = [work, width](size_t e) { return Eigen::Map<Lanes>(work + (2*e+1)*width, width); };
+    auto xre = [x, stride, width](size_t e) { return Eigen::Map<Lanes>(x + 2*e*stride, width); };
+    auto xim = [x, stride, width](size_t e) { return Eigen::Map<Lanes>(x + (2*e+1)*stride, width); };
+
+    for (size_t j=0; j<n_; ++j) {
+        are(j) = chirp_cos_[j]*xre(j) - chirp_sin_[j]*xim(j);
+        aim(j) = chirp_cos_[j]*xim(j) + chirp_sin_[j]*xre(j);
+    }
+    for (size_t j=n_; j<m; ++j) {
+        are(j).setZero();
+        aim(j).setZero();
+    }
+
+    // the convolution with the conjugate chirp, its inverse FFT
+    // taken as the conjugate of the FFT of the conjugate
+    double* inner_work = work + 2*m*width;
+    inner_->stockham<Lanes>(work, width, inner_work, width, width);
+    for (size_t k=0; k<m; ++k) {
+        tr = kernel_re_[k]*are(k) - kernel_im_[k]*aim(k);
+        ti = kernel_re_[k]*aim(k) + kernel_im_[k]*are(k);
+        are(k) = tr;
+        aim(k) = -ti;
+    }
+    inner_->stockham<Lanes>(work, width, inner_work, width, width);
+
+    for (size_t k=0; k<n_; ++k) {
+        tr = are(k);
+        ti = -aim(k);
+        xre(k) = chirp_cos_[k]*tr - chirp_sin_[k]*ti;
+        xim(k) = chirp_cos_[k]*ti + chirp_sin_[k]*tr;
+    }
+}
+
+Plan::Plan(size_t n)
+: n_(n)
+{
+    if (n == 0) {
+        throw std::invalid_argument("FCT::Plan: size 0");
+    }
+
+    if (n % 2 == 1) {
+        fft_ = std::make_shared<const ComplexFft>(2*n);
+        return;
+    }
+
+    cos_.resize(n/2 + 1);
+    sin_.resize(n/2 + 1);
+    for (size_t j=0; j<=n/2; ++j) {
+        cos_[j] = std::cos(M_PI*j/n);
+        sin_[j] = std::sin(M_PI*j/n);
+    }
+
+    if (!is_power_of_two(n)) {
+        fft_ = std::make_shared<const ComplexFft>(n/2);
+        return;
+    }
+
+    // the same permutation as the bit reversal loop of `four1`
+    const size_t nn = n >> 1;   // complex points
+    for (size_t i=0, j=0; i<nn; ++i) {
         if (j > i) {
-            std::swap(data[j-1],data[i-1]);
-            std::swap(data[j],data[i]);
+            swaps_.emplace_back(i, j);
         }
-        m=n >> 1;
-        while (m >= 2 && j > m) {
+        size_t m = nn >> 1;
+        while (m >= 1 && j >= m) {
             j -= m;
             m >>= 1;
         }
         j += m;
     }
-    mmax = 2;
-    while (n > mmax) {
-        istep = mmax << 1;
-        theta = 2.0*M_PI/mmax;
-        wtemp = std::sin(0.5*theta);
-        wpr = -2.0*wtemp*wtemp;
-        wpi = std::sin(theta);
-        wr = 1.0; wi = 0.0;
-        for (size_t m=1; m<=mmax; m+=2) {
-            for (size_t i=m;i<=n;i+=istep) {
-                j = i+mmax;
-                tempr = wr*data[j-1]-wi*data[j];
-                tempi = wr*data[j]+wi*data[j-1];
-                data[j-1] = data[i-1]-tempr;
-                data[j] = data[i]-tempi;
-                data[i-1] += tempr;
-                data[i] += tempi;
+
+    // a radix-4 pass does the radix-2 stages of spans `h` and `2h`,
+    // with `v = exp(i*pi*k/(2h))`, `k = 0 .. h-1`
+    size_t stages = 0;
+    while ((size_t(1) << stages) < nn) {
+        ++stages;
+    }
+    radix2_ = stages % 2 == 1;
+    std::vector<double> twiddles;
+    for (size_t h = radix2_ ? 2 : 1; 4*h <= nn; h *= 4) {
+        for (size_t k=0; k<h; ++k) {
+            for (size_t p=1; p<=3; ++p) {
+                double angle = M_PI*p*k/(2.0*h);
+                twiddles.push_back(std::cos(angle));
+                twiddles.push_back(std::sin(angle));
+            }
+        }
+    }
+    twiddles_ = Eigen::Map<Eigen::ArrayXd>(twiddles.data(), twiddles.size());
+}
+
+void Plan::execute(double* data,
+                   size_t stride,
+                   size_t width,
+                   TransformType transform_type) const
+{
+    for (size_t l=0; l<width; l+=SIMD_LANES) {
+        size_t lanes = std::min(SIMD_LANES, width - l);
+        if (lanes == 1) {
+            execute_lanes<1>(data + l, stride, lanes, transform_type);
+        } else if (lanes == SIMD_LANES) {
+            execute_lanes<int(SIMD_LANES)>(data + l, stride, lanes, transform_type);
+        } else {
+            execute_lanes<Eigen::Dynamic>(data + l, stride, lanes, transform_type);
+        }
+    }
+}
+
+/// every step of the algorithm runs over the `width` contiguous doubles
+/// of an element as one Eigen array, that is with SIMD across the vectors.
+/// `Width` is the number of vectors if known at compile time,
+/// `Eigen::Dynamic` for up to `SIMD_LANES` of them
+template <int Width>
+void Plan::execute_lanes(double* data,
+                         size_t stride,
+                         size_t width,
+                         TransformType transform_type) const
+{
+    using Lanes = Eigen::Array<double, Width, 1, Eigen::ColMajor,
+                               Width == Eigen::Dynamic ? int(SIMD_LANES) : Width, 1>;
+
+    const size_t n = n_;
+    const size_t nn = n >> 1;
+    size_t  i1, i2, i3, i4;
+    double  wr, wi;
+    Lanes   y1(width), y2(width), tempr(width), tempi(width),
+            h1r(width), h1i(width), h2r(width), h2i(width),
+            temp(width), sum(width), first(width), last(width);
+
+    auto at = [data, stride, width](size_t j) { return Eigen::Map<Lanes>(data + j*stride, width); };
+
+    if (n % 2 == 1) {
+        execute_odd<Width>(data, stride, width, transform_type);
+        return;
+    }
+
+    temp = at(n);
+
+    if (transform_type == TransformType::Inverse) {
+        first=0.5*at(0);
+        last=0.5*temp;
+    }
+
+    sum.setZero();
+    for (size_t j=0; j<=n; j+=2) sum += at(j);
+    for (size_t j=1; j<=n; j+=2) sum -= at(j);
+    at(n) = sum;
+
+    sum = at(0);
+    for (size_t j=1; j<=nn; j++) {
+        wr = cos_[j];
+        wi = sin_[j];
+        y1 = 0.5*(at(j)+at(n-j));
+        y2 = at(j)-at(n-j);
+        at(j) = y1-wi*y2;
+        at(n-j) = y1+wi*y2;
+        sum += wr*y2;
+    }
+
+    // FFT of the `nn` complex points `at(2c) + i*at(2c+1)`
+    if (fft_) {
+        fft_->execute<Width>(data, stride, width, scratch(fft_->work_size()*width));
+    } else {
+        for (const auto& [a, b] : swaps_) {
+            at(2*a).swap(at(2*b));
+            at(2*a+1).swap(at(2*b+1));
+        }
+
+        size_t h = 1;
+        if (radix2_) {
+            // an odd number of stages, the first one of span 1 has no twiddles
+            for (size_t c=0; c<nn; c+=2) {
+                tempr = at(2*c+2);
+                tempi = at(2*c+3);
+                at(2*c+2) = at(2*c)-tempr;
+                at(2*c+3) = at(2*c+1)-tempi;
+                at(2*c) += tempr;
+                at(2*c+1) += tempi;
+            }
+            h = 2;
+        }
+        Lanes m1r(width), m1i(width), m2r(width), m2i(width), m3r(width), m3i(width);
+        for (const double* w = twiddles_.data(); 4*h <= nn; h *= 4) {
+            for (size_t k=0; k<h; ++k, w+=6) {
+                const double v1r = w[0], v1i = w[1], v2r = w[2], v2i = w[3], v3r = w[4], v3i = w[5];
+                for (size_t c=k; c<nn; c+=4*h) {
+                    const size_t c0 = 2*c, c1 = 2*(c+h), c2 = 2*(c+2*h), c3 = 2*(c+3*h);
+                    m1r = v2r*at(c1)-v2i*at(c1+1);
+                    m1i = v2r*at(c1+1)+v2i*at(c1);
+                    m2r = v1r*at(c2)-v1i*at(c2+1);
+                    m2i = v1r*at(c2+1)+v1i*at(c2);
+                    m3r = v3r*at(c3)-v3i*at(c3+1);
+                    m3i = v3r*at(c3+1)+v3i*at(c3);
+                    tempr = at(c0)-m1r;                 // t1
+                    tempi = at(c0+1)-m1i;
+                    y1 = m2r-m3r;                       // t3
+                    y2 = m2i-m3i;
+                    m1r += at(c0);                      // t0
+                    m1i += at(c0+1);
+                    m2r += m3r;                         // t2
+                    m2i += m3i;
+                    at(c0) = m1r+m2r;
+                    at(c0+1) = m1i+m2i;
+                    at(c2) = m1r-m2r;
+                    at(c2+1) = m1i-m2i;
+                    at(c1) = tempr-y2;                  // t1 + i*t3
+                    at(c1+1) = tempi+y1;
+                    at(c3) = tempr+y2;                  // t1 - i*t3
+                    at(c3+1) = tempi-y1;
+                }
             }
-            wr = (wtemp=wr)*wpr-wi*wpi+wr;
-            wi = wi*wpr+wtemp*wpi+wi;
         }
-        mmax = istep;
     }
-    theta = M_PI/(n >> 1);
-    wtemp = std::sin(0.5*theta);
-    wpr = -2.0*wtemp*wtemp; wi=wpi=sin(theta); wr=wpr+1;
 
-    data[0] += data[1];
-    m=n >> 2;
+    at(0) += at(1);
 
-    for (size_t i=1; i<=m; i++) {
+    for (size_t i=1; i<=n/4; i++) {
+        wr = cos_[2*i];
+        wi = sin_[2*i];
         i2=(i1=i << 1)+1; i4=(i3=n-i2+1)+1;
-        h1r=0.5*(data[i1]+data[i3]);
-        h1i=0.5*(data[i2]-data[i4]);
-        h2r=0.5*(data[i2]+data[i4]);
-        h2i=0.5*(data[i3]-data[i1]);
-        data[i1]=h1r+wr*h2r-wi*h2i;
-        data[i2]=h1i+wr*h2i+wi*h2r;
-        data[i3]=h1r-wr*h2r+wi*h2i;
-        data[i4] = -h1i+wr*h2i+wi*h2r;
-        wr=(wtemp=wr)*wpr-wi*wpi+wr;
-        wi=wi*wpr+wtemp*wpi+wi;
-    }
-    data[1] = sum;
+        h1r=0.5*(at(i1)+at(i3));
+        h1i=0.5*(at(i2)-at(i4));
+        h2r=0.5*(at(i2)+at(i4));
+        h2i=0.5*(at(i3)-at(i1));
+        at(i1)=h1r+wr*h2r-wi*h2i;
+        at(i2)=h1i+wr*h2i+wi*h2r;
+        at(i3)=h1r-wr*h2r+wi*h2i;
+        at(i4) = -h1i+wr*h2i+wi*h2r;
+    }
+    at(1) = sum;
     for (size_t j=3; j<=n; j+=2) {
-        sum += data[j];
-        data[j] = sum;
+        sum += at(j);
+        at(j) = sum;
     }
 
     for (size_t j=0; j<n; j+=2) {
-        data[j    ] += temp;
-        data[j + 1] -= temp;
+        at(j    ) += temp;
+        at(j + 1) -= temp;
     }
 
     if (transform_type == TransformType::Inverse) {
         for (size_t j=0;j<n;j+=2) {
-            data[j    ] = (data[j    ]-(first+last))*2.0/n;
-            data[j + 1] = (data[j + 1]-(first-last))*2.0/n;
+            at(j    ) = (at(j    )-(first+last))*2.0/double(n);
+            at(j + 1) = (at(j + 1)-(first-last))*2.0/double(n);
         }
-        data[n] = (data[n]-(first+last))*2.0/n;
-        data[0] *= 0.5;
-        data[n] *= 0.5;
+        at(n) = (at(n)-(first+last))*2.0/double(n);
+        at(0) *= 0.5;
+        at(n) *= 0.5;
     }
 }
 
+/// odd `n`: the real part of the FFT of the even extension
+/// `x_0 .. x_n, x_{n-1} .. x_1` of length `2n`,
+/// `Re X_k = x_0 + (-1)^k x_n + 2 sum_{j=1}^{n-1} x_j cos(pi*j*k/n)`
+template <int Width>
+void Plan::execute_odd(double* data,
+                       size_t stride,
+                       size_t width,
+                       TransformType transform_type) const
+{
+    using Lanes = Eigen::Array<double, Width, 1, Eigen::ColMajor,
+                               Width == Eigen::Dynamic ? int(SIMD_LANES) : Width, 1>;
+
+    const size_t n = n_;
+    double* work = scratch((4*n + fft_->work_size())*width);
+    Lanes first(width), last(width);
+
+    auto at = [data, stride, width](size_t j) { return Eigen::Map<Lanes>(data + j*stride, width); };
+    auto re = [work, width](size_t e) { return Eigen::Map<Lanes>(work + 2*e*width, width); };
+    auto im = [work, width](size_t e) { return Eigen::Map<Lanes>(work + (2*e+1)*width, width); };
+
+    for (size_t j=0; j<=n; ++j) {
+        re(j) = at(j);
+        im(j).setZero();
+    }
+    for (size_t j=n+1; j<2*n; ++j) {
+        re(j) = at(2*n-j);
+        im(j).setZero();
+    }
+    fft_->execute<Width>(work, width, width, work + 4*n*width);
+
+    first = 0.5*at(0);
+    last = 0.5*at(n);
+    for (size_t k=0; k<=n; k+=2) at(k) = 0.5*re(k) + first + last;
+    for (size_t k=1; k<=n; k+=2) at(k) = 0.5*re(k) + first - last;
+
+    if (transform_type == TransformType::Inverse) {
+        for (size_t j=0; j<=n; j+=2) at(j) = (at(j)-(first+last))*2.0/double(n);
+        for (size_t j=1; j<=n; j+=2) at(j) = (at(j)-(first-last))*2.0/double(n);
+        at(0) *= 0.5;
+        at(n) *= 0.5;
+    }
+}
+
+const Plan& plan(size_t n)
+{
+    static std::mutex mutex;
+    static std::map<size_t, std::unique_ptr<const Plan>> plans;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto& p = plans[n];
+    if (!p) {
+        p = std::make_unique<const Plan>(n);
+    }
+    return *p;
+}
+
+namespace
+{
+
+#ifdef FCT_WITH_FFTW
+
+/// the in-place `REDFT00` of `n + 1` points; the FFTW planner is not
+/// thread safe, its plans are and are kept for the lifetime of the program
+fftw_plan fftw_redft00(size_t n)
+{
+    using Owner = std::unique_ptr<std::remove_pointer_t<fftw_plan>, decltype(&fftw_destroy_plan)>;
+    static std::mutex mutex;
+    static std::map<size_t, Owner> plans;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = plans.find(n);
+    if (it == plans.end()) {
+        double* x = fftw_alloc_real(n + 1);
+        Owner p(fftw_plan_r2r_1d(int(n + 1), x, x, FFTW_REDFT00, FFTW_ESTIMATE), &fftw_destroy_plan);
+        fftw_free(x);
+        it = plans.emplace(n, std::move(p)).first;
+    }
+    return it->second.get();
+}
+
+/// per thread scratch of at least `size` doubles, aligned as FFTW's plans expect
+double* fftw_scratch(size_t size)
+{
+    struct Buffer
+    {
+        double* data = nullptr;
+        size_t size = 0;
+        ~Buffer() { fftw_free(data); }
+    };
+    thread_local Buffer buffer;
+    if (buffer.size < size) {
+        fftw_free(buffer.data);
+        buffer.data = fftw_alloc_real(size);
+        buffer.size = size;
+    }
+    return buffer.data;
+}
+
+/// `REDFT00` is `Y_k = x_0 + (-1)^k x_n + 2 sum_{j=1}^{n-1} x_j cos(pi*j*k/n)`,
+/// twice the interior of the forward transform; every vector goes through
+/// the same contiguous plan, whatever `stride` and `width`, so `cft2` and
+/// `cft2_parallel` agree bit for bit here too
+void transform_fftw(size_t n,
+                    double* data,
+                    size_t stride,
+                    size_t width,
+                    TransformType transform_type)
+{
+    fftw_plan p = fftw_redft00(n);
+    double* x = fftw_scratch(n + 1);
+
+    for (size_t k=0; k<width; ++k) {
+        for (size_t j=0; j<=n; ++j) {
+            x[j] = data[j*stride + k];
+        }
+        const double first = 0.5*x[0], last = 0.5*x[n];
+        fftw_execute_r2r(p, x, x);
+
+        if (transform_type == TransformType::Inverse) {
+            for (size_t j=0; j<=n; ++j) {
+                data[j*stride + k] = x[j]/double(n);
+            }
+            data[k] *= 0.5;
+            data[n*stride + k] *= 0.5;
+        } else {
+            for (size_t j=0; j<=n; j+=2) data[j*stride + k] = 0.5*x[j] + first + last;
+            for (size_t j=1; j<=n; j+=2) data[j*stride + k] = 0.5*x[j] + first - last;
+        }
+    }
+}
+
+#endif
+
+Backend default_backend()
+{
+    const char* name = std::getenv("FCT_BACKEND");
+    if (name && std::strcmp(name, backend_name(Backend::Fftw)) == 0 && backend_available(Backend::Fftw)) {
+        return Backend::Fftw;
+    }
+    return Backend::Builtin;
+}
+
+std::atomic<Backend>& selected_backend()
+{
+    static std::atomic<Backend> selected{default_backend()};
+    return selected;
+}
+
+} // namespace
+
+bool backend_available(Backend backend)
+{
+#ifdef FCT_WITH_FFTW
+    return backend == Backend::Builtin || backend == Backend::Fftw;
+#else
+    return backend == Backend::Builtin;
+#endif
+}
+
+Backend backend()
+{
+    return selected_backend().load(std::memory_order_relaxed);
+}
+
+void set_backend(Backend backend)
+{
+    if (!backend_available(backend)) {
+        throw std::invalid_argument(std::string("FCT: backend ") + backend_name(backend) + " is not compiled in");
+    }
+    selected_backend().store(backend, std::memory_order_relaxed);
+}
+
+const char* backend_name(Backend backend)
+{
+    switch (backend) {
+    case Backend::Builtin: return "builtin";
+    case Backend::Fftw:    return "fftw";
+    }
+    return "unknown";
+}
+
+void transform(size_t n,
+               double* data,
+               size_t stride,
+               size_t width,
+               TransformType transform_type)
+{
+#ifdef FCT_WITH_FFTW
+    if (backend() == Backend::Fftw) {
+        if (n == 0) {
+            throw std::invalid_argument("FCT::transform: size 0");
+        }
+        transform_fftw(n, data, stride, width, transform_type);
+        return;
+    }
+#endif
+    // skips the lock of `plan` for the rows or columns of one size in a row
+    thread_local const Plan* last = nullptr;
+    if (!last || last->size() != n) {
+        last = &plan(n);
+    }
+    last->execute(data, stride, width, transform_type);
+}
+
+void cosfft1(size_t n,
+             Eigen::Ref<Eigen::VectorXd> data,
+             TransformType transform_type)
+{
+    transform(n, data.data(), 1, 1, transform_type);
+}
+
 void cft2(size_t m, size_t n,
           Eigen::Ref<RowMatrixXd> data,
           TransformType transform_type)
 {
     // `data` is (M+1)x(N+1) matrix
     for (size_t i=0; i<=m; ++i) {
-        cosfft1(n, data.row(i), transform_type);
+        transform(n, data.row(i).data(), 1, 1, transform_type);
     }
 
     for (size_t i=0; i<=n; ++i) {
         Eigen::VectorXd col{data.col(i)};
-        cosfft1(m, col, transform_type);
+        transform(m, col.data(), 1, 1, transform_type);
         data.col(i) = col;
     }
 }
@@ -182,7 +838,7 @@ void cft2_with_transpose(size_t m, size_t n,
 {
     // `data` is (M+1)x(N+1) matrix
     for (size_t i=0; i<=m; ++i) {
-        cosfft1(n, data.row(i), transform_type);
+        transform(n, data.row(i).data(), 1, 1, transform_type);
     }
 
     // to view the matrix columns as rows
@@ -191,11 +847,30 @@ void cft2_with_transpose(size_t m, size_t n,
     // `data` is (N+1)x(M+1) matrix
     // after `.transposeInPlace()`
     for (size_t i=0; i<=n; ++i) {
-        cosfft1(m, data.row(i), transform_type);
+        transform(m, data.row(i).data(), 1, 1, transform_type);
     }
 
     // restore back
     data.transposeInPlace();
 }
 
+void cft2_parallel(size_t m, size_t n,
+                   Eigen::Ref<RowMatrixXd> data,
+                   TransformType transform_type,
+                   size_t threads)
+{
+    // below that a transform takes about as long as starting a thread
+    constexpr size_t MIN_POINTS_PER_THREAD = 64 * 64;
+
+    if (threads == 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    threads = std::min(threads, std::max<size_t>(1, (m + 1) * (n + 1) / MIN_POINTS_PER_THREAD));
+
+    // `data` is (M+1)x(N+1) matrix
+    const size_t stride = data.outerStride();
+    transform_blocks(n, data.data(), m + 1, stride, 1, transform_type, threads);
+    transform_blocks(m, data.data(), n + 1, 1, stride, transform_type, threads);
+}
+
 } // namespace FCT
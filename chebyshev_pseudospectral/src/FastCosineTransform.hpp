@@ -24,6 +24,9 @@
 
 #pragma once
 
+#include <memory>
+#include <utility>
+#include <vector>
 #include "math.hpp"
 
 /**  
@@ -43,6 +46,98 @@ Eigen::VectorXd grid_span(size_t nodes,
                           double min = -1.,
                           double max =  1.);
 
+/**
+ *  @brief Precomputed tables of the DCT-I of size `n`.
+ *
+ *  The twiddles of the pre- and post-processing and of every FFT pass are
+ *  computed once by `std::cos`/`std::sin`, instead of trigonometric
+ *  recurrences on every call. For `n` a power of two the bit reversal is
+ *  kept as the list of swaps it makes and the FFT runs in radix-4 passes,
+ *  a radix-2 one first for an odd number of stages.
+ *
+ *  Any other even `n` goes through the same real FFT of `n/2` complex
+ *  points, by Stockham passes of radix 2, 3, 5 and 7 when `n/2` has no
+ *  other prime factor, by Bluestein's algorithm otherwise; an odd `n`
+ *  through the complex FFT of length `2n` of the even extension of the
+ *  data. So grids of 96 or 384 intervals cost little more than 128 or 512.
+ *
+ *  A plan is immutable, so one plan serves any number of threads;
+ *  `plan(n)` keeps one per size for the lifetime of the program,
+ *  shared by all the rows, columns and solves of that size.
+ */
+class Plan
+{
+public:
+    /// @throw std::invalid_argument for `n == 0`
+    explicit Plan(size_t n);
+
+    size_t size() const { return n_; }
+
+    /// transforms `width` vectors of `n + 1` elements, element `j` of the
+    /// `k`-th vector being `data[j*stride + k]`; a few of them at once,
+    /// every butterfly running over these lanes with SIMD
+    void execute(double* data,
+                 size_t stride,
+                 size_t width,
+                 TransformType transform_type = TransformType::Forward) const;
+
+private:
+    class ComplexFft;
+
+    template <int Width>
+    void execute_lanes(double* data,
+                       size_t stride,
+                       size_t width,
+                       TransformType transform_type) const;
+
+    template <int Width>
+    void execute_odd(double* data,
+                     size_t stride,
+                     size_t width,
+                     TransformType transform_type) const;
+
+    size_t n_;
+    Eigen::ArrayXd cos_, sin_;      ///< of `pi*j/n`, `j = 0 .. n/2`
+    bool radix2_ = false;           ///< a radix-2 pass before the radix-4 ones
+    Eigen::ArrayXd twiddles_;       ///< `v, v^2, v^3` for every `k` of every radix-4 pass
+    std::vector<std::pair<size_t, size_t>> swaps_; ///< of the bit reversal, complex indices
+    std::shared_ptr<const ComplexFft> fft_; ///< of `n/2` points, `2n` for odd `n`; none for powers of two
+};
+
+/// the plan of size `n`, made on first use
+const Plan& plan(size_t n);
+
+/**
+ *  @brief Implementations of the DCT-I behind `cosfft1` and the `cft2` family.
+ *
+ *  `Builtin` are the plans above, always there and the reference the
+ *  others are checked against; `Fftw` is FFTW's `REDFT00`, compiled in
+ *  with `FCT_WITH_FFTW` (the CMake option of that name, off by default,
+ *  needs FFTW). The backend is chosen at run time, once for the
+ *  whole program, so the solvers never name one: `Builtin` unless the
+ *  environment variable `FCT_BACKEND` is `fftw` or `set_backend` says
+ *  otherwise. All the backends give the same transform up to rounding.
+ */
+enum class Backend {Builtin, Fftw};
+
+/// true if `backend` was compiled in
+bool backend_available(Backend backend);
+
+/// the backend of all the transforms
+Backend backend();
+
+/// @throw std::invalid_argument if `backend` was not compiled in
+void set_backend(Backend backend);
+
+const char* backend_name(Backend backend);
+
+/// `Plan::execute` of size `n`, by the backend in use
+void transform(size_t n,
+               double* data,
+               size_t stride,
+               size_t width,
+               TransformType transform_type = TransformType::Forward);
+
 void cosfft1(size_t n,
              Eigen::Ref<Eigen::VectorXd> data,
              TransformType transform_type = TransformType::Forward);
@@ -58,4 +153,14 @@ void cft2_with_transpose(size_t m, size_t n,
                          RowMatrixXd &data, /// don't use `Eigen::Ref<RowMatrixXd>`
                          TransformType transform_type = TransformType::Forward); /// as you get assertion in `.transposeInPlace()`
 
+/// same result as `cft2`, bit for bit, on up to `threads` threads
+/// (0 -- one per core), small grids staying on fewer of them:
+/// rows and columns are transformed by blocks of eight, each gathered
+/// into a buffer with the elements of the block interleaved, vectorized
+/// across the block, and the blocks are split across the threads
+void cft2_parallel(size_t m, size_t n,
+                   Eigen::Ref<RowMatrixXd> data,
+                   TransformType transform_type = TransformType::Forward,
+                   size_t threads = 0);
+
 }
@@ -69,7 +69,7 @@ PoissonProblem::PoissonProblem(size_t M,     size_t N,
     RHS(ome_);
 
     // transform from physical to spectral space
-    FCT::cft2(M_, N_, ome_, FCT::TransformType::Inverse);
+    FCT::cft2_parallel(M_, N_, ome_, FCT::TransformType::Inverse);
 
     // homogenize_bc(ome_, second_derivative_respect_x_);
 
@@ -149,7 +149,7 @@ void PoissonProblem::solve()
     CS::homogeneous_boundary(M_, N_, psi_, psi_);
     if (verbose_)
         std::cout << "psi_ after homogeneous_boundary:\n" << psi_ << std::endl;
-    FCT::cft2(M_, N_, psi_);
+    FCT::cft2_parallel(M_, N_, psi_);
     if (verbose_)
         std::cout << "psi_ after cft2:\n" << psi_ << std::endl;
 }
@@ -0,0 +1,95 @@
+// -*- C++ -*-
+
+// The MIT License (MIT)
+//
+// Copyright (c) 2021 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// scaling of the 2D transforms with the grid size:
+// `cft2`, `cft2_with_transpose` and `cft2_parallel` on one thread and on
+// every core, for M = N = 32 .. 4096
+//
+// usage: cft_bench [max size] [threads]
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <thread>
+#include <functional>
+#include "math.hpp"
+#include "FastCosineTransform.hpp"
+
+namespace {
+
+/// milliseconds per call, repeated for at least a fifth of a second
+double time_ms(const RowMatrixXd& input, RowMatrixXd& output,
+               const std::function<void(RowMatrixXd&)>& transform)
+{
+    using clock = std::chrono::steady_clock;
+    size_t reps = 0;
+    double total = 0.0;
+    while (total < 0.2) {
+        output = input;
+        auto start = clock::now();
+        transform(output);
+        total += std::chrono::duration<double>(clock::now() - start).count();
+        ++reps;
+    }
+    return 1e3 * total / reps;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    using namespace FCT;
+
+    size_t max_size = argc > 1 ? std::stoul(argv[1]) : 4096;
+    size_t threads  = argc > 2 ? std::stoul(argv[2]) : std::max(1u, std::thread::hardware_concurrency());
+
+    std::cout << "ms per forward transform, " << threads << " threads for `parallel`\n"
+              << std::setw(6) << "M=N"
+              << std::setw(12) << "cft2"
+              << std::setw(12) << "transpose"
+              << std::setw(12) << "parallel/1"
+              << std::setw(12) << "parallel"
+              << std::setw(10) << "speedup"
+              << std::setw(10) << "same" << std::endl;
+
+    for (size_t n = 32; n <= max_size; n *= 2) {
+        RowMatrixXd input = RowMatrixXd::Random(n + 1, n + 1), reference, output;
+
+        double plain = time_ms(input, reference, [n](RowMatrixXd& d) { cft2(n, n, d); });
+        double transposed = time_ms(input, output, [n](RowMatrixXd& d) { cft2_with_transpose(n, n, d); });
+        double single = time_ms(input, output, [n](RowMatrixXd& d) { cft2_parallel(n, n, d, TransformType::Forward, 1); });
+        double parallel = time_ms(input, output, [n, threads](RowMatrixXd& d) { cft2_parallel(n, n, d, TransformType::Forward, threads); });
+
+        std::cout << std::fixed << std::setprecision(3)
+                  << std::setw(6) << n
+                  << std::setw(12) << plain
+                  << std::setw(12) << transposed
+                  << std::setw(12) << single
+                  << std::setw(12) << parallel
+                  << std::setw(9) << std::setprecision(1) << plain / parallel << "x"
+                  << std::setw(10) << (output == reference ? "yes" : "NO") << std::endl;
+    }
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+// -*- C++ -*-
+
+// The MIT License (MIT)
+//
+// Copyright (c) 2021 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+// the DCT-I backends side by side: `cft2_parallel` on one thread
+// for every backend compiled in, on grids of powers of two and of
+// 3 and 5 times powers of two, with the largest difference of each
+// backend from the built-in plans relative to the largest coefficient
+//
+// usage: fct_backend_bench [max size]
+
+#include <algorithm>
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <vector>
+#include "math.hpp"
+#include "FastCosineTransform.hpp"
+
+namespace {
+
+/// milliseconds per call, repeated for at least a fifth of a second
+double time_ms(const RowMatrixXd& input, RowMatrixXd& output, size_t n)
+{
+    using clock = std::chrono::steady_clock;
+    size_t reps = 0;
+    double total = 0.0;
+    while (total < 0.2) {
+        output = input;
+        auto start = clock::now();
+        FCT::cft2_parallel(n, n, output, FCT::TransformType::Forward, 1);
+        total += std::chrono::duration<double>(clock::now() - start).count();
+        ++reps;
+    }
+    return 1e3 * total / reps;
+}
+
+}
+
+int main(int argc, char** argv)
+{
+    using namespace FCT;
+
+    size_t max_size = argc > 1 ? std::stoul(argv[1]) : 2048;
+
+    std::vector<Backend> backends;
+    for (Backend b : {Backend::Builtin, Backend::Fftw}) {
+        if (backend_available(b)) {
+            backends.push_back(b);
+        }
+    }
+    const Backend selected = backend();
+
+    std::cout << "ms per forward transform on one thread, " << backend_name(selected) << " by default\n"
+              << std::setw(6) << "M=N";
+    for (Backend b : backends) {
+        std::cout << std::setw(12) << backend_name(b) << std::setw(10) << "diff";
+    }
+    std::cout << std::endl;
+
+    std::vector<size_t> sizes;
+    for (size_t n = 32; n <= max_size; n *= 2) {
+        for (size_t s : {n, 3 * n / 2, 5 * n / 4}) {
+            if (s <= max_size) {
+                sizes.push_back(s);
+            }
+        }
+    }
+    std::sort(sizes.begin(), sizes.end());
+
+    for (size_t n : sizes) {
+        RowMatrixXd input = RowMatrixXd::Random(n + 1, n + 1), reference, output;
+        std::cout << std::setw(6) << n;
+        for (Backend b : backends) {
+            set_backend(b);
+            double ms = time_ms(input, output, n);
+            if (b == Backend::Builtin) {
+                reference = output;
+            }
+            double diff = (output - reference).cwiseAbs().maxCoeff() / reference.cwiseAbs().maxCoeff();
+            std::cout << std::fixed << std::setprecision(3) << std::setw(12) << ms
+                      << std::scientific << std::setprecision(1) << std::setw(10) << diff;
+        }
+        std::cout << std::endl;
+    }
+    set_backend(selected);
+
+    return 0;
+}
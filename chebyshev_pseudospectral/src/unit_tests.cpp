@@ -187,6 +187,132 @@ TEST(cftSuite, test_cf2)
     EXPECT_NEAR((m - m1).norm(), 0.0, EPS);
 }
 
+TEST(cftSuite, test_cft2_parallel)
+{
+    // 257 columns: 32 full blocks and a block of one
+    constexpr size_t M = 128;
+    constexpr size_t N = 256;
+
+    for (auto transform_type : {FCT::TransformType::Forward, FCT::TransformType::Inverse}) {
+        RowMatrixXd m = RowMatrixXd::Random(M + 1, N + 1), m1 = m, m2 = m;
+
+        FCT::cft2(M, N, m, transform_type);
+        FCT::cft2_parallel(M, N, m1, transform_type, 1);
+        FCT::cft2_parallel(M, N, m2, transform_type, 4);
+
+        EXPECT_EQ(m, m1);
+        EXPECT_EQ(m, m2);
+    }
+}
+
+namespace {
+
+/// max error of `cosfft1` of size `n` against the direct sum
+/// `y_k = sum_j x_j cos(pi*j*k/n)`, relative to the max of `|y_k|`
+double cosfft1_error(size_t n)
+{
+    std::vector<long double> cosines(2 * n);
+    for (size_t i = 0; i < 2 * n; i++) {
+        cosines[i] = std::cos(M_PI * (long double)i / n);
+    }
+
+    Eigen::VectorXd x = Eigen::VectorXd::Random(n + 1), y = x;
+    FCT::cosfft1(n, y);
+
+    double err = 0.0, scale = 0.0;
+    for (size_t k = 0; k <= n; k++) {
+        long double sum = 0.0;
+        for (size_t j = 0; j <= n; j++) {
+            sum += x[j] * cosines[j * k % (2 * n)];
+        }
+        err = std::max(err, double(std::fabs(sum - y[k])));
+        scale = std::max(scale, double(std::fabs(sum)));
+    }
+    return err / scale;
+}
+
+}
+
+TEST(cftSuite, test_plan)
+{
+    EXPECT_THROW(FCT::Plan(0), std::invalid_argument);
+    EXPECT_EQ(&FCT::plan(64), &FCT::plan(64));
+    EXPECT_EQ(FCT::plan(64).size(), 64);
+
+    constexpr double EPS = 1e-14;
+    EXPECT_NEAR(cosfft1_error(1024), 0.0, EPS);
+}
+
+TEST(cftSuite, test_plan_any_size)
+{
+    constexpr double EPS = 1e-14, ROUND_TRIP_EPS = 1e-12;
+
+    // powers of two times 3, 5 and 7, odd sizes and sizes with a large
+    // prime factor, that go through Bluestein's algorithm
+    for (size_t n : {1, 2, 3, 5, 6, 7, 12, 20, 28, 75, 96, 101, 202, 210, 384, 1000, 1018}) {
+        SCOPED_TRACE(n);
+        EXPECT_NEAR(cosfft1_error(n), 0.0, EPS);
+
+        Eigen::VectorXd x = Eigen::VectorXd::Random(n + 1), y = x;
+        FCT::cosfft1(n, y, FCT::TransformType::Forward);
+        FCT::cosfft1(n, y, FCT::TransformType::Inverse);
+        EXPECT_NEAR((x - y).cwiseAbs().maxCoeff(), 0.0, ROUND_TRIP_EPS);
+    }
+
+    // a grid of 96 by 75 intervals on several threads
+    constexpr size_t M = 96, N = 75;
+    RowMatrixXd data = RowMatrixXd::Random(M + 1, N + 1), reference = data;
+    FCT::cft2(M, N, reference);
+    FCT::cft2_parallel(M, N, data, FCT::TransformType::Forward, 4);
+    EXPECT_EQ(data, reference);
+}
+
+TEST(cftSuite, test_backends)
+{
+    constexpr double EPS = 1e-13;
+
+    const FCT::Backend selected = FCT::backend();
+    EXPECT_TRUE(FCT::backend_available(FCT::Backend::Builtin));
+    if (!FCT::backend_available(FCT::Backend::Fftw)) {
+        EXPECT_THROW(FCT::set_backend(FCT::Backend::Fftw), std::invalid_argument);
+    }
+
+    // every backend against the direct sum, and the others against the
+    // built-in plans as well, forward and inverse
+    for (FCT::Backend backend : {FCT::Backend::Builtin, FCT::Backend::Fftw}) {
+        if (!FCT::backend_available(backend)) {
+            continue;
+        }
+        SCOPED_TRACE(FCT::backend_name(backend));
+        for (size_t n : {1, 2, 7, 64, 96, 101, 1024}) {
+            SCOPED_TRACE(n);
+            FCT::set_backend(backend);
+            const double err = cosfft1_error(n);
+            FCT::set_backend(selected);
+            EXPECT_NEAR(err, 0.0, EPS);
+            if (backend == FCT::Backend::Builtin) {
+                continue;
+            }
+            for (auto type : {FCT::TransformType::Forward, FCT::TransformType::Inverse}) {
+                Eigen::VectorXd reference = Eigen::VectorXd::Random(n + 1), y = reference;
+                FCT::plan(n).execute(reference.data(), 1, 1, type);
+                FCT::set_backend(backend);
+                FCT::cosfft1(n, y, type);
+                FCT::set_backend(selected);
+                EXPECT_NEAR((reference - y).cwiseAbs().maxCoeff() / reference.cwiseAbs().maxCoeff(), 0.0, EPS);
+            }
+        }
+
+        constexpr size_t M = 64, N = 48;
+        RowMatrixXd data = RowMatrixXd::Random(M + 1, N + 1), reference = data;
+        FCT::set_backend(backend);
+        FCT::cft2(M, N, reference);
+        FCT::cft2_parallel(M, N, data, FCT::TransformType::Forward, 4);
+        FCT::set_backend(selected);
+        EXPECT_EQ(data, reference);
+    }
+}
+
 TEST(bsSuite, test_gauss_elim)
 {
     constexpr double EPS = 1e-12;
@@ -0,0 +1,323 @@
+#pragma once
+
+// Benchmark harness for the concurrent structures in this directory.
+//
+// Every thread runs a loop of operations on one shared instance for a fixed
+// duration: a `put` with probability `put_percent` or a `get` otherwise, the
+// key drawn from a uniform or a zipfian distribution. Threads start together
+// on a barrier and may be pinned to a cpu each. Reported are the throughput,
+// a latency histogram of (sampled) single operations and how evenly the work
+// was spread over the threads.
+//
+// A workload is any default constructible type with
+//
+//   void prefill(uint64_t key);                      // before the threads start
+//   void op(size_t thread, bool put, uint64_t key);  // the measured operation
+//
+// `thread` lets a workload give threads roles, e.g. producer and consumer
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+
+struct bench_config
+{
+    enum distribution { uniform, zipf };
+
+    double duration = 1.0;          // seconds per run
+    unsigned put_percent = 50;
+    distribution dist = uniform;
+    double zipf_theta = 0.99;
+    uint64_t keys = 1 << 16;
+    size_t prefill = 1024;
+    bool pin = false;
+    unsigned sample_every = 16;     // time one operation in that many, 0 for none
+};
+
+// log-linear histogram of nanoseconds: 16 sub-buckets per power of two,
+// i.e. 1/16 relative precision at any magnitude
+class latency_histogram
+{
+    static constexpr unsigned sub_bits = 4;
+    static constexpr unsigned sub = 1u << sub_bits;
+
+    std::vector<uint64_t> counts = std::vector<uint64_t>(64 * sub);
+    uint64_t total = 0;
+    uint64_t largest = 0;
+
+    static size_t index(uint64_t v)
+    {
+        if (v < sub)
+            return v;
+        unsigned mag = 63 - __builtin_clzll(v);             // >= sub_bits
+        uint64_t mantissa = (v >> (mag - sub_bits)) & (sub - 1);
+        return (mag - sub_bits + 1) * sub + mantissa;
+    }
+
+    static uint64_t lower(size_t i)
+    {
+        if (i < sub)
+            return i;
+        unsigned mag = i / sub + sub_bits - 1;
+        return (uint64_t(1) << mag) | (uint64_t(i % sub) << (mag - sub_bits));
+    }
+
+public:
+
+    void record(uint64_t ns)
+    {
+        ++counts[index(ns)];
+        ++total;
+        largest = std::max(largest, ns);
+    }
+
+    void merge(const latency_histogram &other)
+    {
+        for (size_t i = 0; i < counts.size(); ++i)
+            counts[i] += other.counts[i];
+        total += other.total;
+        largest = std::max(largest, other.largest);
+    }
+
+    uint64_t count() const { return total; }
+
+    uint64_t max() const { return largest; }
+
+    // lower bound of the bucket holding the given percentile
+    uint64_t percentile(double p) const
+    {
+        if (total == 0)
+            return 0;
+        uint64_t rank = std::max<uint64_t>(1, uint64_t(std::ceil(p / 100. * total)));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < counts.size(); ++i) {
+            seen += counts[i];
+            if (seen >= rank)
+                return lower(i);
+        }
+        return largest;
+    }
+};
+
+// keys in [0, n), uniform or zipfian (Gray et al., "Quickly generating
+// billion-record synthetic databases"), xorshift underneath
+class key_generator
+{
+    uint64_t state;
+    uint64_t n;
+    bool zipf;
+    double theta, alpha, zetan, eta;
+
+    static double zeta(uint64_t n, double theta)
+    {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i)
+            sum += 1. / std::pow(double(i), theta);
+        return sum;
+    }
+
+public:
+
+    key_generator(const bench_config &cfg, uint64_t seed, double zetan_cached)
+        : state(seed * 0x9E3779B97F4A7C15ull | 1), n(cfg.keys),
+          zipf(cfg.dist == bench_config::zipf), theta(cfg.zipf_theta),
+          alpha(1. / (1. - theta)), zetan(zetan_cached),
+          eta((1. - std::pow(2. / n, 1. - theta)) / (1. - zeta(2, theta) / zetan))
+    {}
+
+    // the O(n) part, computed once per configuration
+    static double zetan_for(const bench_config &cfg)
+    {
+        return cfg.dist == bench_config::zipf ? zeta(cfg.keys, cfg.zipf_theta) : 1.;
+    }
+
+    uint64_t next_raw()
+    {
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    uint64_t next()
+    {
+        if (!zipf)
+            return next_raw() % n;
+        double u = (next_raw() >> 11) * (1. / 9007199254740992.);
+        double uz = u * zetan;
+        if (uz < 1.)
+            return 0;
+        if (uz < 1. + std::pow(0.5, theta))
+            return 1;
+        return uint64_t(n * std::pow(eta * u - eta + 1., alpha)) % n;
+    }
+};
+
+struct bench_result
+{
+    std::string name;
+    size_t threads = 0;
+    double secs = 0;
+    std::vector<uint64_t> per_thread;   // operations done by every thread
+    latency_histogram latency;
+
+    uint64_t ops() const
+    {
+        uint64_t sum = 0;
+        for (uint64_t n : per_thread)
+            sum += n;
+        return sum;
+    }
+
+    double mops() const { return ops() / secs / 1e6; }
+
+    // Jain's index: 1 when all threads did the same work, 1/threads when one did it all,
+    // 0 when nothing completed
+    double fairness() const
+    {
+        double sum = 0, sq = 0;
+        for (uint64_t n : per_thread) {
+            sum += n;
+            sq += double(n) * n;
+        }
+        return sq > 0 ? sum * sum / (per_thread.size() * sq) : 0.;
+    }
+
+    // share of the slowest and of the fastest thread relative to an even split,
+    // 0 when nothing completed
+    double min_share() const
+    {
+        uint64_t total = ops();
+        if (total == 0)
+            return 0.;
+        return *std::min_element(per_thread.begin(), per_thread.end()) * per_thread.size() / double(total);
+    }
+
+    double max_share() const
+    {
+        uint64_t total = ops();
+        if (total == 0)
+            return 0.;
+        return *std::max_element(per_thread.begin(), per_thread.end()) * per_thread.size() / double(total);
+    }
+};
+
+inline void pin_to_cpu(std::thread &t, size_t i)
+{
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(i % ncpu, &set);
+    pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+}
+
+template <typename Workload>
+bench_result run_bench(const std::string &name, const bench_config &cfg, size_t nthr)
+{
+    using clock = std::chrono::steady_clock;
+
+    struct alignas(64) thread_result {
+        uint64_t ops = 0;
+        latency_histogram latency;
+    };
+
+    Workload w;
+    double zetan = key_generator::zetan_for(cfg);
+    {
+        key_generator keys(cfg, nthr + 1, zetan);
+        for (size_t i = 0; i < cfg.prefill; ++i)
+            w.prefill(keys.next());
+    }
+
+    std::vector<thread_result> results(nthr);
+    std::atomic<size_t> ready {0};
+    std::atomic<bool> go {false}, stop {false};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < nthr; ++i) {
+        threads.emplace_back([&, i] {
+            key_generator keys(cfg, i + 1, zetan);
+            thread_result &r = results[i];
+            uint64_t put_below = uint64_t(cfg.put_percent) * 1024 / 100;
+            unsigned sample = cfg.sample_every;
+            unsigned countdown = sample;
+
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            while (!stop.load(std::memory_order_relaxed)) {
+                bool put = (keys.next_raw() & 1023) < put_below;
+                uint64_t key = keys.next();
+                if (sample != 0 && --countdown == 0) {
+                    countdown = sample;
+                    auto t0 = clock::now();
+                    w.op(i, put, key);
+                    auto t1 = clock::now();
+                    r.latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(t1 - t0).count());
+                } else {
+                    w.op(i, put, key);
+                }
+                ++r.ops;
+            }
+        });
+        if (cfg.pin)
+            pin_to_cpu(threads.back(), i);
+    }
+
+    while (ready.load() != nthr)
+        std::this_thread::yield();
+
+    auto start = clock::now();
+    go.store(true, std::memory_order_release);
+    std::this_thread::sleep_for(std::chrono::duration<double>(cfg.duration));
+    stop.store(true);
+    for (auto &t : threads)
+        t.join();
+
+    bench_result res;
+    res.name = name;
+    res.threads = nthr;
+    res.secs = std::chrono::duration<double>(clock::now() - start).count();
+    for (auto &r : results) {
+        res.per_thread.push_back(r.ops);
+        res.latency.merge(r.latency);
+    }
+    return res;
+}
+
+inline void print_header(bool csv)
+{
+    if (csv)
+        std::printf("structure,threads,ops,seconds,mops,p50_ns,p90_ns,p99_ns,p999_ns,max_ns,fairness,min_share,max_share\n");
+    else
+        std::printf("%-16s %7s %10s %8s %8s %8s %9s %10s %8s %6s/%-6s\n",
+                    "structure", "threads", "Mops/s", "p50 ns", "p90 ns", "p99 ns",
+                    "p99.9 ns", "max ns", "jain", "min", "max");
+}
+
+inline void print_result(const bench_result &r, bool csv)
+{
+    const latency_histogram &l = r.latency;
+    if (csv)
+        std::printf("%s,%zu,%llu,%.3f,%.3f,%llu,%llu,%llu,%llu,%llu,%.4f,%.3f,%.3f\n",
+                    r.name.c_str(), r.threads, (unsigned long long)r.ops(), r.secs, r.mops(),
+                    (unsigned long long)l.percentile(50), (unsigned long long)l.percentile(90),
+                    (unsigned long long)l.percentile(99), (unsigned long long)l.percentile(99.9),
+                    (unsigned long long)l.max(), r.fairness(), r.min_share(), r.max_share());
+    else
+        std::printf("%-16s %7zu %10.2f %8llu %8llu %8llu %9llu %10llu %8.3f %6.2f/%-6.2f\n",
+                    r.name.c_str(), r.threads, r.mops(),
+                    (unsigned long long)l.percentile(50), (unsigned long long)l.percentile(90),
+                    (unsigned long long)l.percentile(99), (unsigned long long)l.percentile(99.9),
+                    (unsigned long long)l.max(), r.fairness(), r.min_share(), r.max_share());
+    std::fflush(stdout);
+}
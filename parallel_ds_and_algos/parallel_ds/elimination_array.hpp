@@ -0,0 +1,83 @@
+#pragma once
+
+// Elimination backoff for a lock-free stack (Hendler, Shavit, Yerushalmi).
+//
+// A push and a pop that collide on `head` cancel out here instead of retrying
+// the CAS: the pusher offers its node in a random slot and waits a little,
+// a popper that finds the offer swaps it for a `taken` mark and keeps the
+// node. The push is linearized right before the pop, the stack never sees
+// either of them. Slots are padded to a cache line each.
+//
+// The popper owns a node it takes, no reclamation is needed: nobody else
+// dereferences a pointer read from a slot without winning it first.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <thread>
+#include "spinlocks.hpp"
+
+template <typename Node, size_t Slots = 16>
+class elimination_array
+{
+public:
+
+    // iterations a pusher waits for a popper, or a popper for an offer
+    static constexpr size_t spins = 128;
+
+    // true if a popper took `n`, false if `n` is still the pusher's
+    bool offer(Node *n)
+    {
+        slot &s = slots[pick()];
+        Node *expected = nullptr;
+        if (!s.offer.compare_exchange_strong(expected, n))
+            return false;
+        for (size_t i = 0; i < spins; ++i) {
+            if (s.offer.load(std::memory_order_acquire) == taken())
+                break;
+            cpu_relax();
+        }
+        expected = n;
+        if (s.offer.compare_exchange_strong(expected, nullptr))
+            return false;
+        // taken, free the slot for the next offer
+        s.offer.store(nullptr, std::memory_order_release);
+        return true;
+    }
+
+    // a node offered by a pusher, nullptr if none showed up
+    Node *take()
+    {
+        slot &s = slots[pick()];
+        for (size_t i = 0; i < spins; ++i) {
+            Node *n = s.offer.load(std::memory_order_acquire);
+            if (n != nullptr && n != taken() &&
+                s.offer.compare_exchange_strong(n, taken(), std::memory_order_acq_rel))
+                return n;
+            cpu_relax();
+        }
+        return nullptr;
+    }
+
+private:
+
+    struct alignas(64) slot {
+        std::atomic<Node *> offer {nullptr};
+    };
+
+    static Node *taken() { return reinterpret_cast<Node *>(uintptr_t(1)); }
+
+    // xorshift, seeded per thread so that colliding threads spread out
+    static size_t pick()
+    {
+        thread_local uint32_t x =
+            uint32_t(std::hash<std::thread::id>()(std::this_thread::get_id())) | 1;
+        x ^= x << 13;
+        x ^= x >> 17;
+        x ^= x << 5;
+        return x % Slots;
+    }
+
+    slot slots[Slots];
+};
@@ -0,0 +1,297 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <utility>
+
+#include "reclamation.hpp"
+
+// Split-ordered hash map (Shalev, Shavit): all items live in one lock-free
+// sorted list (Michael's, with marked links) ordered by the bit-reversed hash,
+// and every bucket is a pointer to a sentinel node inside that list.
+//
+// Doubling the number of buckets moves no item: bucket b splits into b and
+// b + n, whose items are already adjacent in the list, and the new sentinel is
+// inserted the first time bucket b + n is used. Resizing is therefore just a
+// CAS on the bucket count, nobody ever waits for it. Bucket pointers sit in
+// segments of doubling size that are allocated on demand and never move.
+//
+// `find`, `insert` and `erase` are lock-free, erased nodes are retired through
+// `Reclaimer` (see reclamation.hpp), sentinels are never removed.
+template <typename K, typename V, typename Hash = std::hash<K>,
+          typename Reclaimer = hazard_pointers>
+class hash_map_lock_free
+{
+
+private:
+
+    struct Node {
+        uint64_t so_key;                        // odd for items, even for sentinels
+        std::optional<std::pair<K, V>> kv;      // empty for sentinels
+        std::atomic<Node*> next {nullptr};
+    };
+
+    // average list length per bucket before the bucket count doubles
+    static constexpr size_t max_load = 2;
+
+    static constexpr size_t max_segments = 64;
+
+    using bucket_ptr = std::atomic<Node*>;
+
+    std::atomic<bucket_ptr*> segments[max_segments] {};
+
+    std::atomic<size_t> bucket_count;
+
+    alignas(64) std::atomic<size_t> count {0};
+
+    Hash hasher;
+
+    static bool marked(Node *p) { return uintptr_t(p) & 1; }
+
+    static Node *mark(Node *p) { return reinterpret_cast<Node *>(uintptr_t(p) | 1); }
+
+    static Node *unmark(Node *p) { return reinterpret_cast<Node *>(uintptr_t(p) & ~uintptr_t(1)); }
+
+    static uint64_t reverse(uint64_t v)
+    {
+        v = ((v >> 1) & 0x5555555555555555ull) | ((v & 0x5555555555555555ull) << 1);
+        v = ((v >> 2) & 0x3333333333333333ull) | ((v & 0x3333333333333333ull) << 2);
+        v = ((v >> 4) & 0x0F0F0F0F0F0F0F0Full) | ((v & 0x0F0F0F0F0F0F0F0Full) << 4);
+        return __builtin_bswap64(v);
+    }
+
+    static uint64_t item_key(uint64_t hash) { return reverse(hash | (uint64_t(1) << 63)); }
+
+    static uint64_t sentinel_key(size_t bucket) { return reverse(bucket); }
+
+    bucket_ptr &slot(size_t bucket);
+
+    Node *sentinel(size_t bucket);
+
+    Node *init_bucket(size_t bucket);
+
+    using guard = typename Reclaimer::guard;
+
+    // Michael's search from `start`: on return `*prev == cur` and `cur` is the
+    // match or the first node past `so_key`; both are protected by `gp`/`gc`.
+    // `key == nullptr` looks for the sentinel of that `so_key`
+    bool search(Node *start, uint64_t so_key, const K *key,
+                guard &gp, guard &gc, std::atomic<Node*> *&prev, Node *&cur);
+
+    // links `n` unless an equal node is there, `existing` gets that one
+    bool link(Node *start, Node *n, Node *&existing);
+
+public:
+
+    // `buckets` is rounded up to a power of two
+    explicit hash_map_lock_free (size_t buckets = 16);
+
+    // no other thread may use the map any more
+    ~hash_map_lock_free ();
+
+    hash_map_lock_free (const hash_map_lock_free &) = delete;
+
+    hash_map_lock_free &operator=(const hash_map_lock_free &) = delete;
+
+    // false if the key is there already
+    bool insert (const K &key, const V &value);
+
+    std::optional<V> find (const K &key);
+
+    bool contains (const K &key) { return find(key).has_value(); }
+
+    // false if the key wasn't there
+    bool erase (const K &key);
+
+    size_t size () const { return count.load(std::memory_order_relaxed); }
+
+    size_t buckets () const { return bucket_count.load(std::memory_order_relaxed); }
+};
+
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+hash_map_lock_free<K, V, Hash, Reclaimer>::hash_map_lock_free(size_t buckets)
+{
+    size_t n = 2;
+    while (n < buckets)
+        n <<= 1;
+    bucket_count.store(n);
+    slot(0).store(new Node { sentinel_key(0), std::nullopt });
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+hash_map_lock_free<K, V, Hash, Reclaimer>::~hash_map_lock_free()
+{
+    Node *n = slot(0).load();
+    while (n != nullptr) {
+        Node *next = unmark(n->next.load());
+        delete n;
+        n = next;
+    }
+    for (auto &s : segments)
+        delete[] s.load();
+}
+
+// segment 0 holds bucket 0, segment s > 0 buckets [2^(s-1), 2^s)
+template <typename K, typename V, typename Hash, typename Reclaimer>
+auto hash_map_lock_free<K, V, Hash, Reclaimer>::slot(size_t bucket) -> bucket_ptr &
+{
+    size_t s = bucket == 0 ? 0 : 64 - __builtin_clzll(bucket);
+    size_t first = s == 0 ? 0 : size_t(1) << (s - 1);
+    bucket_ptr *seg = segments[s].load(std::memory_order_acquire);
+    if (seg == nullptr) {
+        size_t size = s == 0 ? 1 : first;
+        bucket_ptr *fresh = new bucket_ptr[size]();
+        if (segments[s].compare_exchange_strong(seg, fresh))
+            seg = fresh;
+        else
+            delete[] fresh;
+    }
+    return seg[bucket - first];
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+auto hash_map_lock_free<K, V, Hash, Reclaimer>::sentinel(size_t bucket) -> Node *
+{
+    Node *s = slot(bucket).load(std::memory_order_acquire);
+    return s != nullptr ? s : init_bucket(bucket);
+}
+
+// the parent bucket (highest bit cleared) is the one that splits into this one
+template <typename K, typename V, typename Hash, typename Reclaimer>
+auto hash_map_lock_free<K, V, Hash, Reclaimer>::init_bucket(size_t bucket) -> Node *
+{
+    size_t parent = bucket & ~(size_t(1) << (63 - __builtin_clzll(bucket)));
+    Node *start = sentinel(parent);
+    Node *s = new Node { sentinel_key(bucket), std::nullopt };
+    Node *existing;
+    if (!link(start, s, existing)) {
+        delete s;
+        s = existing;               // sentinels are never retired
+    }
+    slot(bucket).store(s, std::memory_order_release);
+    return s;
+}
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+template <typename K, typename V, typename Hash, typename Reclaimer>
+bool hash_map_lock_free<K, V, Hash, Reclaimer>::search(
+    Node *start, uint64_t so_key, const K *key,
+    guard &gp, guard &gc, std::atomic<Node*> *&prev, Node *&cur)
+{
+retry:
+    prev = &start->next;            // sentinels stay, no need to protect `start`
+    cur = prev->load(std::memory_order_acquire);
+    for (;;) {
+        if (cur == nullptr)
+            return false;
+        gc.set(cur);
+        // a marked or changed link means `cur` may be gone already
+        if (prev->load(std::memory_order_acquire) != cur)
+            goto retry;
+
+        Node *next = cur->next.load(std::memory_order_acquire);
+        if (marked(next)) {
+            // erased but still linked: unlink it on the way
+            Node *expected = cur;
+            if (!prev->compare_exchange_strong(expected, unmark(next)))
+                goto retry;
+            gc.reset();
+            Reclaimer::retire(cur);
+            cur = unmark(next);
+            continue;
+        }
+
+        uint64_t ck = cur->so_key;
+        if (ck > so_key)
+            return false;
+        if (ck == so_key && (key == nullptr || cur->kv->first == *key))
+            return true;
+
+        gp.set(cur);                // still protected by `gc` at this point
+        prev = &cur->next;
+        cur = next;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+bool hash_map_lock_free<K, V, Hash, Reclaimer>::link(Node *start, Node *n, Node *&existing)
+{
+    guard gp, gc;
+    std::atomic<Node*> *prev;
+    Node *cur;
+    const K *key = n->kv ? &n->kv->first : nullptr;
+    for (;;) {
+        if (search(start, n->so_key, key, gp, gc, prev, cur)) {
+            existing = cur;
+            return false;
+        }
+        n->next.store(cur, std::memory_order_relaxed);
+        if (prev->compare_exchange_strong(cur, n))
+            return true;
+    }
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+bool hash_map_lock_free<K, V, Hash, Reclaimer>::insert(const K &key, const V &value)
+{
+    uint64_t h = hasher(key);
+    size_t n = bucket_count.load(std::memory_order_acquire);
+    Node *start = sentinel(h & (n - 1));
+
+    Node *node = new Node { item_key(h), std::make_pair(key, value) };
+    Node *existing;
+    if (!link(start, node, existing)) {
+        delete node;
+        return false;
+    }
+
+    // the split happens lazily, bucket by bucket, see `init_bucket()`
+    if (count.fetch_add(1, std::memory_order_relaxed) + 1 > max_load * n &&
+        n < (size_t(1) << (max_segments - 2)))
+        bucket_count.compare_exchange_strong(n, 2 * n);
+    return true;
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+std::optional<V> hash_map_lock_free<K, V, Hash, Reclaimer>::find(const K &key)
+{
+    uint64_t h = hasher(key);
+    Node *start = sentinel(h & (bucket_count.load(std::memory_order_acquire) - 1));
+    guard gp, gc;
+    std::atomic<Node*> *prev;
+    Node *cur;
+    if (!search(start, item_key(h), &key, gp, gc, prev, cur))
+        return std::nullopt;
+    return cur->kv->second;
+}
+
+template <typename K, typename V, typename Hash, typename Reclaimer>
+bool hash_map_lock_free<K, V, Hash, Reclaimer>::erase(const K &key)
+{
+    uint64_t h = hasher(key);
+    Node *start = sentinel(h & (bucket_count.load(std::memory_order_acquire) - 1));
+    guard gp, gc;
+    std::atomic<Node*> *prev;
+    Node *cur;
+    for (;;) {
+        if (!search(start, item_key(h), &key, gp, gc, prev, cur))
+            return false;
+        Node *next = cur->next.load(std::memory_order_acquire);
+        // marking the link is the erase, whoever unlinks it retires it
+        if (marked(next) || !cur->next.compare_exchange_strong(next, mark(next)))
+            continue;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        Node *expected = cur;
+        if (prev->compare_exchange_strong(expected, next)) {
+            gc.reset();
+            Reclaimer::retire(cur);
+        } else {
+            search(start, item_key(h), &key, gp, gc, prev, cur);
+        }
+        return true;
+    }
+}
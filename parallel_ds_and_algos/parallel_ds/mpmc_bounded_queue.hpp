@@ -0,0 +1,116 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// Bounded multi-producer multi-consumer array queue (Vyukov).
+//
+// Every cell carries a sequence number telling whether it is free for the
+// producer of ticket `pos` (seq == pos) or holds the item for the consumer of
+// ticket `pos` (seq == pos + 1). Producers and consumers claim tickets with a
+// CAS on their own counter and never touch the other side's, no node is ever
+// allocated so there is nothing to reclaim. Cells are padded to a cache line.
+//
+// rtp/BoundedQueue.h has the same ring as `MPMCBoundedQueue`, with unpadded
+// cells and a `tryPop(T&)` that needs a default constructible `T`; this one
+// keeps the layout and the `std::optional` interface of the other queues here.
+template <typename T>
+class mpmc_bounded_queue
+{
+
+private:
+
+    struct alignas(64) cell {
+        std::atomic<size_t> seq;
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    size_t mask;
+    std::unique_ptr<cell[]> cells;
+
+    alignas(64) std::atomic<size_t> enqueue_pos {0};
+
+    alignas(64) std::atomic<size_t> dequeue_pos {0};
+
+public:
+
+    // `capacity` is rounded up to a power of two
+    explicit mpmc_bounded_queue (size_t capacity)
+    {
+        if (capacity < 2)
+            throw std::invalid_argument("mpmc_bounded_queue: capacity should be at least 2");
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        mask = n - 1;
+        cells.reset(new cell[n]);
+        for (size_t i = 0; i < n; ++i)
+            cells[i].seq.store(i, std::memory_order_relaxed);
+    }
+
+    ~mpmc_bounded_queue ()
+    {
+        while (try_pop())
+            ;
+    }
+
+    mpmc_bounded_queue (const mpmc_bounded_queue &) = delete;
+
+    mpmc_bounded_queue &operator=(const mpmc_bounded_queue &) = delete;
+
+    size_t capacity () const { return mask + 1; }
+
+    // false if the queue is full
+    template <typename U>
+    bool try_push (U &&v)
+    {
+        size_t pos = enqueue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = cells[pos & mask];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos);
+            if (diff == 0) {
+                if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    new (c.storage) T(std::forward<U>(v));
+                    c.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;                       // a lap behind: full
+            } else {
+                pos = enqueue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // empty optional if the queue is empty
+    std::optional<T> try_pop ()
+    {
+        size_t pos = dequeue_pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell &c = cells[pos & mask];
+            size_t seq = c.seq.load(std::memory_order_acquire);
+            intptr_t diff = intptr_t(seq) - intptr_t(pos + 1);
+            if (diff == 0) {
+                if (dequeue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    std::optional<T> v(std::move(*c.value()));
+                    c.value()->~T();
+                    c.seq.store(pos + mask + 1, std::memory_order_release);
+                    return v;
+                }
+            } else if (diff < 0) {
+                return std::nullopt;                // not written yet: empty
+            } else {
+                pos = dequeue_pos.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
@@ -0,0 +1,163 @@
+#pragma once
+
+// Per-thread free lists of fixed size nodes for the lock-free structures.
+//
+// `create` and `destroy` only touch the calling thread's list; nodes move
+// between threads in batches through a shared pool (a mutex, taken once per
+// `batch` nodes) and fresh nodes come from slabs of `batch` nodes, so the
+// hot path never reaches the global allocator. A producer thread refills
+// from what consumer threads have spilled.
+//
+// `destroy` has the deleter signature of reclamation.hpp, so retired nodes
+// go back to the pool instead of to `delete`.
+
+#include <cstddef>
+#include <mutex>
+#include <new>
+#include <utility>
+#include <vector>
+
+template <typename Node>
+class node_pool
+{
+public:
+
+    // nodes moved between a thread and the shared pool at once
+    static constexpr size_t batch = 256;
+
+    template <typename... Args>
+    static Node *create(Args &&... args)
+    {
+        return new (allocate()) Node { std::forward<Args>(args)... };
+    }
+
+    static void destroy(void *p)
+    {
+        static_cast<Node *>(p)->~Node();
+        deallocate(p);
+    }
+
+private:
+
+    union slot {
+        slot *next;
+        alignas(Node) unsigned char storage[sizeof(Node)];
+    };
+
+    struct chain {
+        slot *head;
+        size_t count;
+    };
+
+    struct shared_pool {
+        std::mutex mtx;
+        std::vector<chain> chains;
+    };
+
+    static shared_pool &shared()
+    {
+        // never destroyed, nor are the slabs: their nodes may sit in any thread
+        static shared_pool *p = new shared_pool;
+        return *p;
+    }
+
+    // trivially destructible, so it stays usable while other thread locals
+    // (e.g. a reclaimer's retired list) are destroyed at thread exit
+    struct cache {
+        slot *head = nullptr;
+        size_t count = 0;
+        bool registered = false;
+        bool exited = false;
+    };
+
+    // hands the cache back to the shared pool when the thread exits
+    struct flusher {
+        ~flusher()
+        {
+            cache &c = local();
+            if (c.head != nullptr)
+                give(chain { c.head, c.count });
+            c.head = nullptr;
+            c.count = 0;
+            c.exited = true;
+        }
+    };
+
+    static cache &local()
+    {
+        thread_local cache c;
+        if (!c.registered) {
+            c.registered = true;
+            thread_local flusher f;
+            (void)f;
+        }
+        return c;
+    }
+
+    static void give(chain ch)
+    {
+        shared_pool &p = shared();
+        std::lock_guard<std::mutex> lock(p.mtx);
+        p.chains.push_back(ch);
+    }
+
+    static void *allocate()
+    {
+        cache &c = local();
+        if (c.head == nullptr)
+            refill(c);
+        slot *s = c.head;
+        c.head = s->next;
+        --c.count;
+        return s;
+    }
+
+    static void deallocate(void *p)
+    {
+        cache &c = local();
+        slot *s = static_cast<slot *>(p);
+        if (c.exited) {
+            s->next = nullptr;
+            give(chain { s, 1 });
+            return;
+        }
+        s->next = c.head;
+        c.head = s;
+        if (++c.count >= 2 * batch)
+            spill(c);
+    }
+
+    static void refill(cache &c)
+    {
+        shared_pool &p = shared();
+        {
+            std::lock_guard<std::mutex> lock(p.mtx);
+            if (!p.chains.empty()) {
+                chain ch = p.chains.back();
+                p.chains.pop_back();
+                c.head = ch.head;
+                c.count = ch.count;
+                return;
+            }
+        }
+        slot *slab = new slot[batch];
+        for (size_t i = 0; i + 1 < batch; ++i)
+            slab[i].next = &slab[i + 1];
+        slab[batch - 1].next = nullptr;
+        c.head = slab;
+        c.count = batch;
+    }
+
+    // keeps `batch` nodes, the other `batch` go to the shared pool
+    static void spill(cache &c)
+    {
+        slot *first = c.head;
+        slot *last = first;
+        for (size_t i = 1; i < batch; ++i)
+            last = last->next;
+        c.head = last->next;
+        last->next = nullptr;
+        c.count -= batch;
+        give(chain { first, batch });
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+// Hardware counters of the calling thread through perf_event_open(2).
+//
+//   perf_counters pc;          // opens the group, counting stopped
+//   pc.start();
+//   ...                        // the measured code
+//   pc.stop();
+//   pc.value(perf_counters::cache_misses);
+//
+// Only the calling thread is counted, in user space. Counters the machine or
+// the kernel don't provide (virtual machines, containers, perf_event_paranoid
+// above 2) read as `unavailable`, measuring goes on without them.
+
+#include <cstdint>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+class perf_counters
+{
+public:
+
+    enum event { cycles, instructions, cache_misses, l1d_misses, count };
+
+    static constexpr uint64_t unavailable = ~uint64_t(0);
+
+    static const char *name(event e)
+    {
+        static const char *names[count] = { "cycles", "instructions", "cache-misses", "L1d-misses" };
+        return names[e];
+    }
+
+private:
+
+    int fds[count];
+    int leader = -1;
+    uint64_t values[count];
+
+    static int open_event(uint32_t type, uint64_t config, int group)
+    {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        return int(syscall(SYS_perf_event_open, &attr, 0, -1, group, 0));
+    }
+
+    uint64_t read_one(int fd) const
+    {
+        uint64_t v;
+        if (fd < 0 || ::read(fd, &v, sizeof(v)) != sizeof(v))
+            return unavailable;
+        return v;
+    }
+
+public:
+
+    perf_counters()
+    {
+        const uint32_t types[count] = { PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE,
+                                        PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE };
+        const uint64_t configs[count] = {
+            PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES,
+            PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8)
+                                    | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+        };
+        for (int i = 0; i < count; ++i) {
+            // the first counter that opens leads the group, the others follow it
+            fds[i] = open_event(types[i], configs[i], leader);
+            if (leader == -1)
+                leader = fds[i];
+            values[i] = unavailable;
+        }
+    }
+
+    ~perf_counters()
+    {
+        for (int fd : fds)
+            if (fd >= 0)
+                close(fd);
+    }
+
+    perf_counters(const perf_counters &) = delete;
+    perf_counters &operator=(const perf_counters &) = delete;
+
+    // at least one counter works
+    bool available() const { return leader >= 0; }
+
+    void start()
+    {
+        if (leader < 0)
+            return;
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    void stop()
+    {
+        if (leader < 0)
+            return;
+        ioctl(leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        for (int i = 0; i < count; ++i)
+            values[i] = read_one(fds[i]);
+    }
+
+    // since start() up to stop()
+    uint64_t value(event e) const { return values[e]; }
+};
@@ -0,0 +1,164 @@
+#pragma once
+
+#include <atomic>
+#include <new>
+#include <optional>
+#include <utility>
+
+#include "reclamation.hpp"
+#include "node_pool.hpp"
+
+// Michael-Scott queue: a linked list with a dummy node at `head`, enqueue
+// links at `tail` and swings `tail` forward, anyone who finds `tail` lagging
+// helps it along. Dequeued dummies are retired through `Reclaimer` like the
+// nodes of stack_lock_free, and come from node_pool.hpp when `Pooled`.
+template <typename T, typename Reclaimer = hazard_pointers, bool Pooled = true>
+class queue_lock_free
+{
+
+private:
+
+    // the value lives in raw storage: the dummy node has none
+    struct Node {
+        std::atomic<Node*> next {nullptr};
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    using pool = node_pool<Node>;
+
+    alignas(64) std::atomic<Node*> head;
+
+    alignas(64) std::atomic<Node*> tail;
+
+    static Node *make();
+
+    static void destroy(Node *n);
+
+public:
+
+    queue_lock_free ();
+
+    // no other thread may use the queue any more
+    ~queue_lock_free ();
+
+    queue_lock_free (const queue_lock_free &) = delete;
+
+    queue_lock_free &operator=(const queue_lock_free &) = delete;
+
+    void push (const T &v) { push(T(v)); }
+
+    void push (T&&);
+
+    // empty optional if the queue is empty
+    std::optional<T> pop ();
+
+    // a snapshot, the dummy at `head` is protected as in `pop`
+    bool empty () const;
+};
+
+
+template <typename T, typename Reclaimer, bool Pooled>
+auto queue_lock_free<T, Reclaimer, Pooled>::make() -> Node *
+{
+    if constexpr (Pooled)
+        return pool::create();
+    else
+        return new Node;
+}
+
+template <typename T, typename Reclaimer, bool Pooled>
+void queue_lock_free<T, Reclaimer, Pooled>::destroy(Node *n)
+{
+    if constexpr (Pooled)
+        pool::destroy(n);
+    else
+        delete n;
+}
+
+template <typename T, typename Reclaimer, bool Pooled>
+queue_lock_free<T, Reclaimer, Pooled>::queue_lock_free()
+{
+    Node *dummy = make();
+    head.store(dummy);
+    tail.store(dummy);
+}
+
+template <typename T, typename Reclaimer, bool Pooled>
+queue_lock_free<T, Reclaimer, Pooled>::~queue_lock_free()
+{
+    Node *dummy = head.load();
+    Node *n = dummy->next.load();
+    destroy(dummy);                         // no value in there
+    while (n != nullptr) {
+        Node *next = n->next.load();
+        n->value()->~T();
+        destroy(n);
+        n = next;
+    }
+}
+
+template <typename T, typename Reclaimer, bool Pooled>
+void queue_lock_free<T, Reclaimer, Pooled>::push(T &&v)
+{
+    Node *n = make();
+    new (n->storage) T(std::move(v));
+
+    typename Reclaimer::guard g;
+    for (;;) {
+        Node *last = g.protect(tail);
+        Node *next = last->next.load(std::memory_order_acquire);
+        if (last != tail.load())
+            continue;
+        if (next == nullptr) {
+            if (last->next.compare_exchange_weak(next, n)) {
+                // may fail if somebody helped already
+                tail.compare_exchange_strong(last, n);
+                return;
+            }
+        } else {
+            tail.compare_exchange_strong(last, next);
+        }
+    }
+}
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+template <typename T, typename Reclaimer, bool Pooled>
+std::optional<T> queue_lock_free<T, Reclaimer, Pooled>::pop()
+{
+    typename Reclaimer::guard gh, gn;
+    for (;;) {
+        Node *first = gh.protect(head);
+        Node *last = tail.load();
+        // `next` can't be retired before `first`, which is protected
+        Node *next = gn.protect(first->next);
+        if (first != head.load())
+            continue;
+        if (next == nullptr)
+            return std::nullopt;
+        if (first == last) {
+            tail.compare_exchange_strong(last, next);
+            continue;
+        }
+        if (head.compare_exchange_strong(first, next)) {
+            // `next` is the new dummy, its value belongs to the winner of the CAS
+            std::optional<T> v(std::move(*next->value()));
+            next->value()->~T();
+            gh.reset();
+            gn.reset();
+            if constexpr (Pooled)
+                Reclaimer::retire(first, &pool::destroy);
+            else
+                Reclaimer::retire(first);
+            return v;
+        }
+    }
+}
+
+template <typename T, typename Reclaimer, bool Pooled>
+bool queue_lock_free<T, Reclaimer, Pooled>::empty() const
+{
+    typename Reclaimer::guard g;
+    return g.protect(head)->next.load(std::memory_order_acquire) == nullptr;
+}
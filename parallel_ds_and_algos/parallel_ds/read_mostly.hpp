@@ -0,0 +1,265 @@
+#pragma once
+
+// Synchronization for data that is read far more often than written.
+//
+// A std::shared_mutex makes every reader write the lock's reader count, so
+// readers on different cores still pass one cache line around and read
+// throughput stops growing after a few cores. These keep readers off shared
+// cache lines:
+//
+//   seqlock<T>       - readers don't write at all: they copy the value and
+//                      retry if a writer was active meanwhile. For small
+//                      trivially copyable values; writers never wait for
+//                      readers, readers may retry under heavy writing.
+//   br_lock          - big-reader lock: a reader count per thread slot, each
+//                      on its own cache line, so a reader only writes its own
+//                      line; a writer raises a flag and waits for every slot
+//                      to drain. SharedLockable, for std::shared_lock.
+//   sharded_counter  - one counter per thread slot, summed on read: adds
+//                      never contend, a read costs one load per slot.
+//
+// Thread slots are handed out round robin on a thread's first use, so up to
+// `slots` threads never share one.
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <thread>
+#include <type_traits>
+#include "spinlocks.hpp"
+
+namespace read_mostly_detail {
+
+// slots for one per cpu, rounded up to a power of two
+inline size_t default_slots()
+{
+    size_t n = 1;
+    while (n < std::thread::hardware_concurrency())
+        n <<= 1;
+    return n;
+}
+
+// a small number, fixed for the calling thread
+inline size_t thread_slot()
+{
+    static std::atomic<size_t> next {0};
+    thread_local size_t slot = next.fetch_add(1, std::memory_order_relaxed);
+    return slot;
+}
+
+} // namespace read_mostly_detail
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+template <typename T>
+class seqlock
+{
+    static_assert(std::is_trivially_copyable<T>::value, "seqlock values are copied bytewise");
+
+    // the value is copied with relaxed atomic words: a reader racing with a
+    // writer gets garbage that it throws away, but no data race (Boehm,
+    // "Can seqlocks get along with programming language memory models?")
+    static constexpr size_t words = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+    alignas(64) std::atomic<uint64_t> seq {0};     // odd while a write is in progress
+    std::atomic<uint64_t> data[words];
+    ttas_lock writer;
+
+    void copy_out(T &v) const
+    {
+        uint64_t buf[words];
+        for (size_t i = 0; i < words; ++i)
+            buf[i] = data[i].load(std::memory_order_relaxed);
+        std::memcpy(&v, buf, sizeof(T));
+    }
+
+    void copy_in(const T &v)
+    {
+        uint64_t buf[words] = {};
+        std::memcpy(buf, &v, sizeof(T));
+        for (size_t i = 0; i < words; ++i)
+            data[i].store(buf[i], std::memory_order_relaxed);
+    }
+
+    // writer lock held
+    void publish(const T &v)
+    {
+        uint64_t s = seq.load(std::memory_order_relaxed);
+        seq.store(s + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        copy_in(v);
+        seq.store(s + 2, std::memory_order_release);
+    }
+
+public:
+
+    explicit seqlock (const T &v = T()) { copy_in(v); }
+
+    seqlock (const seqlock &) = delete;
+
+    seqlock &operator=(const seqlock &) = delete;
+
+    T load () const
+    {
+        T v;
+        spin_wait wait;
+        for (;;) {
+            uint64_t s0 = seq.load(std::memory_order_acquire);
+            if ((s0 & 1) == 0) {
+                copy_out(v);
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (seq.load(std::memory_order_relaxed) == s0)
+                    return v;
+            }
+            wait.pause();
+        }
+    }
+
+    void store (const T &v)
+    {
+        std::lock_guard<ttas_lock> lock(writer);
+        publish(v);
+    }
+
+    // v = f(v) atomically with respect to other writers
+    template <typename F>
+    void update (F f)
+    {
+        std::lock_guard<ttas_lock> lock(writer);
+        T v;
+        copy_out(v);
+        f(v);
+        publish(v);
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class br_lock
+{
+    struct alignas(64) slot {
+        std::atomic<uint32_t> readers {0};
+    };
+
+    size_t mask;
+    std::unique_ptr<slot[]> slots;
+    alignas(64) std::atomic<bool> writer {false};
+
+    slot &mine () { return slots[read_mostly_detail::thread_slot() & mask]; }
+
+    // a reader and a writer each announce themselves, then look for the other;
+    // seq_cst on both sides makes sure at least one of them sees the other
+    bool enter_shared (slot &s)
+    {
+        s.readers.fetch_add(1, std::memory_order_seq_cst);
+        if (!writer.load(std::memory_order_seq_cst))
+            return true;
+        s.readers.fetch_sub(1, std::memory_order_release);
+        return false;
+    }
+
+public:
+
+    // `slots` is rounded up to a power of two, one per cpu by default
+    explicit br_lock (size_t nslots = read_mostly_detail::default_slots())
+    {
+        size_t n = 1;
+        while (n < nslots)
+            n <<= 1;
+        mask = n - 1;
+        slots.reset(new slot[n]);
+    }
+
+    br_lock (const br_lock &) = delete;
+
+    br_lock &operator=(const br_lock &) = delete;
+
+    void lock_shared ()
+    {
+        slot &s = mine();
+        spin_wait wait;
+        while (!enter_shared(s))
+            while (writer.load(std::memory_order_relaxed))
+                wait.pause();
+    }
+
+    bool try_lock_shared () { return enter_shared(mine()); }
+
+    void unlock_shared () { mine().readers.fetch_sub(1, std::memory_order_release); }
+
+    void lock ()
+    {
+        spin_wait wait;
+        while (writer.exchange(true, std::memory_order_seq_cst))
+            while (writer.load(std::memory_order_relaxed))
+                wait.pause();
+        for (size_t i = 0; i <= mask; ++i)
+            while (slots[i].readers.load(std::memory_order_seq_cst) != 0)
+                wait.pause();
+    }
+
+    bool try_lock ()
+    {
+        if (writer.load(std::memory_order_relaxed) ||
+            writer.exchange(true, std::memory_order_seq_cst))
+            return false;
+        for (size_t i = 0; i <= mask; ++i)
+            if (slots[i].readers.load(std::memory_order_seq_cst) != 0) {
+                writer.store(false, std::memory_order_release);
+                return false;
+            }
+        return true;
+    }
+
+    void unlock () { writer.store(false, std::memory_order_release); }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class sharded_counter
+{
+    struct alignas(64) slot {
+        std::atomic<int64_t> value {0};
+    };
+
+    size_t mask;
+    std::unique_ptr<slot[]> slots;
+
+public:
+
+    // `slots` is rounded up to a power of two, one per cpu by default
+    explicit sharded_counter (size_t nslots = read_mostly_detail::default_slots())
+    {
+        size_t n = 1;
+        while (n < nslots)
+            n <<= 1;
+        mask = n - 1;
+        slots.reset(new slot[n]);
+    }
+
+    sharded_counter (const sharded_counter &) = delete;
+
+    sharded_counter &operator=(const sharded_counter &) = delete;
+
+    // a fetch_add, but on a line no other thread writes unless threads outnumber slots
+    void add (int64_t n = 1)
+    {
+        slots[read_mostly_detail::thread_slot() & mask].value.fetch_add(n, std::memory_order_relaxed);
+    }
+
+    // exact once the adds are done; while only positive adds run, between
+    // the counts at the start and at the end of the call
+    int64_t get () const
+    {
+        int64_t sum = 0;
+        for (size_t i = 0; i <= mask; ++i)
+            sum += slots[i].value.load(std::memory_order_relaxed);
+        return sum;
+    }
+
+    // not atomic with respect to concurrent adds
+    void reset ()
+    {
+        for (size_t i = 0; i <= mask; ++i)
+            slots[i].value.store(0, std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,415 @@
+#pragma once
+
+// Safe memory reclamation for the lock-free structures in this directory.
+//
+// A lock-free structure unlinks a node with a CAS, but other threads may
+// still be reading it, so it can't be deleted right away: it is retired and
+// freed once no thread can hold a reference any more. Deleting immediately
+// is a use-after-free, and recycling the address is the ABA problem.
+//
+// Two interchangeable policies, selected as a template argument:
+//
+//   hazard_pointers - every reader publishes the pointer it is about to
+//                     dereference; a retired node is freed when no hazard
+//                     pointer refers to it. Bounded garbage, a store and a
+//                     reload per protected pointer.
+//   epoch_based     - readers pin the global epoch for the whole operation;
+//                     a node retired in epoch e is freed once the epoch has
+//                     advanced twice. Cheaper reads, unbounded garbage if a
+//                     thread stalls inside an operation.
+//
+// Both have the same interface:
+//
+//   {
+//       typename Reclaimer::guard g;   // one protected pointer / pinned region
+//       Node *p = g.protect(head);     // safe to dereference until g goes away
+//       ...
+//       Reclaimer::retire(p);          // after p has been unlinked
+//   }
+//
+// `g.set(p)` publishes a pointer the caller validates itself, e.g. when
+// walking a list with marked links, or hands a node over between guards.
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace reclamation_detail {
+
+struct retired_node {
+    void *ptr;
+    void (*deleter)(void *);
+    uint64_t epoch;     // epoch_based only
+
+    void reclaim() const { deleter(ptr); }
+};
+
+template <typename T>
+void delete_node(void *p)
+{
+    delete static_cast<T *>(p);
+}
+
+// Per-thread records live in a global list that only grows, a record is
+// recycled when its thread exits, so scanning never races with a free.
+template <typename Record>
+class registry
+{
+    std::atomic<Record *> head {nullptr};
+    std::atomic<size_t> count {0};
+
+public:
+
+    Record *acquire()
+    {
+        for (Record *r = head.load(std::memory_order_acquire); r; r = r->next) {
+            bool expected = false;
+            if (!r->in_use.load(std::memory_order_relaxed) &&
+                r->in_use.compare_exchange_strong(expected, true))
+                return r;
+        }
+        Record *r = new Record;
+        r->in_use.store(true, std::memory_order_relaxed);
+        r->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(r->next, r));
+        count.fetch_add(1, std::memory_order_relaxed);
+        return r;
+    }
+
+    void release(Record *r) { r->in_use.store(false, std::memory_order_release); }
+
+    // records ever created, i.e. the peak number of threads
+    size_t size() const { return count.load(std::memory_order_relaxed); }
+
+    template <typename F>
+    void for_each(F &&f) const
+    {
+        for (Record *r = head.load(std::memory_order_acquire); r; r = r->next)
+            f(*r);
+    }
+};
+
+// Nodes left behind by exited threads, adopted by the next scan.
+class orphanage
+{
+    std::mutex mtx;
+    std::vector<retired_node> nodes;
+
+public:
+
+    void give(std::vector<retired_node> &from)
+    {
+        if (from.empty())
+            return;
+        std::lock_guard<std::mutex> lock(mtx);
+        nodes.insert(nodes.end(), from.begin(), from.end());
+        from.clear();
+    }
+
+    void adopt(std::vector<retired_node> &to)
+    {
+        std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+        if (!lock || nodes.empty())
+            return;
+        to.insert(to.end(), nodes.begin(), nodes.end());
+        nodes.clear();
+    }
+};
+
+} // namespace reclamation_detail
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class hazard_pointers
+{
+public:
+
+    // protected pointers a thread may hold at once
+    static constexpr size_t slots_per_thread = 4;
+
+    // retired nodes per thread before a scan, at least twice the number
+    // of hazard pointers so that a scan always frees half of them
+    static constexpr size_t scan_threshold = 64;
+
+private:
+
+    using retired_node = reclamation_detail::retired_node;
+
+    struct record {
+        std::atomic<void *> hazard[slots_per_thread] {};
+        std::atomic<bool> in_use {false};
+        record *next = nullptr;
+    };
+
+    struct domain {
+        reclamation_detail::registry<record> records;
+        reclamation_detail::orphanage orphans;
+    };
+
+    static domain &global()
+    {
+        // never destroyed: thread exits may still come after static destructors
+        static domain *d = new domain;
+        return *d;
+    }
+
+    struct thread_state {
+        record *rec;
+        size_t used = 0;                    // slots taken by live guards
+        std::vector<retired_node> retired;
+
+        thread_state() : rec(global().records.acquire()) {}
+
+        ~thread_state()
+        {
+            scan(*this);
+            global().orphans.give(retired);
+            global().records.release(rec);
+        }
+    };
+
+    static thread_state &local()
+    {
+        thread_local thread_state s;
+        return s;
+    }
+
+    static void scan(thread_state &s)
+    {
+        domain &d = global();
+        d.orphans.adopt(s.retired);
+
+        // the nodes have been unlinked before they were retired,
+        // a hazard published after this point can't refer to them
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        std::vector<void *> hazards;
+        d.records.for_each([&hazards](record &r) {
+            for (auto &h : r.hazard)
+                if (void *p = h.load(std::memory_order_acquire))
+                    hazards.push_back(p);
+        });
+        std::sort(hazards.begin(), hazards.end());
+
+        auto freed = std::partition(s.retired.begin(), s.retired.end(),
+            [&hazards](const retired_node &n) {
+                return std::binary_search(hazards.begin(), hazards.end(), n.ptr);
+            });
+        for (auto it = freed; it != s.retired.end(); ++it)
+            it->reclaim();
+        s.retired.erase(freed, s.retired.end());
+    }
+
+public:
+
+    // owns one hazard pointer of the calling thread, guards nest
+    class guard
+    {
+        thread_state &s;
+        std::atomic<void *> &slot;
+
+        static std::atomic<void *> &take(thread_state &s)
+        {
+            assert(s.used < slots_per_thread);
+            return s.rec->hazard[s.used++];
+        }
+
+    public:
+
+        guard() : s(local()), slot(take(s)) {}
+
+        ~guard()
+        {
+            slot.store(nullptr, std::memory_order_release);
+            --s.used;
+        }
+
+        guard(const guard &) = delete;
+        guard &operator=(const guard &) = delete;
+
+        // loads `src` and keeps the node alive until the guard is reset or destroyed
+        template <typename T>
+        T *protect(const std::atomic<T *> &src)
+        {
+            T *p = src.load(std::memory_order_relaxed);
+            for (;;) {
+                slot.store(p, std::memory_order_seq_cst);
+                // still reachable after publishing, so not retired before it
+                T *q = src.load(std::memory_order_seq_cst);
+                if (q == p)
+                    return p;
+                p = q;
+            }
+        }
+
+        // publishes `p` without validation: the caller checks that `p` is still
+        // reachable afterwards, or `p` is protected by another guard already
+        template <typename T>
+        void set(T *p) { slot.store(p, std::memory_order_seq_cst); }
+
+        void reset() { slot.store(nullptr, std::memory_order_release); }
+    };
+
+    // `p` must be unlinked already, it is deleted once no hazard pointer refers to it,
+    // `deleter` replaces `delete` for nodes that come from a pool
+    template <typename T>
+    static void retire(T *p, void (*deleter)(void *) = reclamation_detail::delete_node<T>)
+    {
+        thread_state &s = local();
+        s.retired.push_back(retired_node { p, deleter, 0 });
+        size_t threshold = std::max(scan_threshold,
+                                    2 * slots_per_thread * global().records.size());
+        if (s.retired.size() >= threshold)
+            scan(s);
+    }
+
+    // frees what the calling thread can free right now
+    static void flush() { scan(local()); }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class epoch_based
+{
+public:
+
+    // retired nodes per thread before trying to advance the epoch
+    static constexpr size_t collect_threshold = 64;
+
+private:
+
+    using retired_node = reclamation_detail::retired_node;
+
+    struct record {
+        // (epoch << 1) | 1 while pinned, 0 while quiescent
+        std::atomic<uint64_t> state {0};
+        std::atomic<bool> in_use {false};
+        record *next = nullptr;
+    };
+
+    struct domain {
+        std::atomic<uint64_t> epoch {1};
+        reclamation_detail::registry<record> records;
+        reclamation_detail::orphanage orphans;
+    };
+
+    static domain &global()
+    {
+        // never destroyed: thread exits may still come after static destructors
+        static domain *d = new domain;
+        return *d;
+    }
+
+    struct thread_state {
+        record *rec;
+        size_t depth = 0;                   // nested guards
+        std::vector<retired_node> limbo;
+        size_t next_collect = collect_threshold;
+
+        thread_state() : rec(global().records.acquire()) {}
+
+        ~thread_state()
+        {
+            collect(*this);
+            global().orphans.give(limbo);
+            global().records.release(rec);
+        }
+    };
+
+    static thread_state &local()
+    {
+        thread_local thread_state s;
+        return s;
+    }
+
+    // the epoch moves on once every pinned thread has seen the current one
+    static void try_advance()
+    {
+        domain &d = global();
+        uint64_t e = d.epoch.load(std::memory_order_seq_cst);
+        bool behind = false;
+        d.records.for_each([&](record &r) {
+            uint64_t st = r.state.load(std::memory_order_seq_cst);
+            if ((st & 1) && (st >> 1) != e)
+                behind = true;
+        });
+        if (!behind)
+            d.epoch.compare_exchange_strong(e, e + 1);
+    }
+
+    static void collect(thread_state &s)
+    {
+        domain &d = global();
+        d.orphans.adopt(s.limbo);
+        try_advance();
+
+        // a thread pinned at e may reach nodes retired in e and e + 1 at most
+        uint64_t e = d.epoch.load(std::memory_order_acquire);
+        auto freed = std::partition(s.limbo.begin(), s.limbo.end(),
+            [e](const retired_node &n) { return n.epoch + 2 > e; });
+        for (auto it = freed; it != s.limbo.end(); ++it)
+            it->reclaim();
+        s.limbo.erase(freed, s.limbo.end());
+
+        // while a stalled thread holds the epoch back the limbo only grows,
+        // collecting again after it has doubled keeps retire amortized O(1)
+        s.next_collect = std::max(collect_threshold, 2 * s.limbo.size());
+    }
+
+public:
+
+    // pins the current epoch for the calling thread, guards nest
+    class guard
+    {
+        thread_state &s;
+
+    public:
+
+        guard() : s(local())
+        {
+            if (s.depth++ == 0) {
+                uint64_t e = global().epoch.load(std::memory_order_relaxed);
+                s.rec->state.store((e << 1) | 1, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+        }
+
+        ~guard()
+        {
+            if (--s.depth == 0)
+                s.rec->state.store(0, std::memory_order_release);
+        }
+
+        guard(const guard &) = delete;
+        guard &operator=(const guard &) = delete;
+
+        // anything reachable while pinned stays alive until the guard goes away
+        template <typename T>
+        T *protect(const std::atomic<T *> &src)
+        {
+            return src.load(std::memory_order_acquire);
+        }
+
+        template <typename T>
+        void set(T *) {}
+
+        void reset() {}
+    };
+
+    // `p` must be unlinked already, it is deleted two epochs later,
+    // `deleter` replaces `delete` for nodes that come from a pool
+    template <typename T>
+    static void retire(T *p, void (*deleter)(void *) = reclamation_detail::delete_node<T>)
+    {
+        thread_state &s = local();
+        uint64_t e = global().epoch.load(std::memory_order_acquire);
+        s.limbo.push_back(retired_node { p, deleter, e });
+        if (s.limbo.size() >= s.next_collect)
+            collect(s);
+    }
+
+    // frees what the calling thread can free right now
+    static void flush() { collect(local()); }
+};
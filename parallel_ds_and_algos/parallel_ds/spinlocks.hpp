@@ -0,0 +1,434 @@
+#pragma once
+
+// Spinlocks, from the naive one of ../spinlock to queue locks.
+//
+//   tas_lock     - test_and_set in a loop. Every waiter keeps writing the
+//                  lock's cache line, which ping-pongs between all of them
+//                  and slows the owner down too; collapses beyond a few cores.
+//   ttas_lock    - spins reading a cached copy, tries the RMW only when the
+//                  lock looks free and backs off exponentially when it loses.
+//   ticket_lock  - FIFO: take a ticket, wait until it is served; waiters back
+//                  off in proportion to their distance from the head.
+//   mcs_lock     - FIFO queue of per-thread nodes, every waiter spins on its
+//                  own node and the owner hands over with a single store:
+//                  O(1) cache line transfers per acquisition under any load.
+//   clh_lock     - like MCS but every waiter spins on its predecessor's node;
+//                  no CAS in unlock, nodes move from thread to thread.
+//   hybrid_lock  - spins briefly, then sleeps in the kernel on a futex
+//                  (Drepper, "Futexes are tricky"); for long or oversubscribed
+//                  critical sections where spinning wastes the cpu.
+//
+// All are Lockable (lock, try_lock, unlock) and work with std::lock_guard,
+// std::unique_lock and std::scoped_lock. The queue locks take their node from
+// a small per-thread cache, so a thread may hold any number of them at once.
+// Waiters yield after spinning for a while, see spin_wait.
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// tells the cpu we are spinning: frees the pipeline for the sibling
+// hyperthread and avoids the memory order mis-speculation on exit
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#endif
+}
+
+// busy waiting that gives the cpu up after a while. A FIFO lock hands over
+// to one particular waiter and nobody else may take it meanwhile; with more
+// threads than cpus that waiter is often preempted, and would only run again
+// once every spinner has burnt its whole time slice.
+class spin_wait
+{
+    unsigned count = 0;
+
+public:
+
+    static constexpr unsigned yield_after = 1024;
+
+    void pause ()
+    {
+        if (count < yield_after) {
+            ++count;
+            cpu_relax();
+        } else {
+            std::this_thread::yield();
+        }
+    }
+};
+
+// randomized exponential backoff (Anderson)
+class spin_backoff
+{
+    unsigned limit;
+    unsigned max;
+    uint32_t seed;
+
+public:
+
+    explicit spin_backoff (unsigned min_spins = 4, unsigned max_spins = 1024)
+        : limit(min_spins), max(max_spins), seed(uint32_t(uintptr_t(this)) | 1) {}
+
+    void pause ()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        for (unsigned i = seed % limit + 1; i != 0; --i)
+            cpu_relax();
+        limit = std::min(2 * limit, max);
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class tas_lock
+{
+    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+
+public:
+
+    void lock ()
+    {
+        while (locked.test_and_set(std::memory_order_acquire))
+            ;
+    }
+
+    bool try_lock () { return !locked.test_and_set(std::memory_order_acquire); }
+
+    void unlock () { locked.clear(std::memory_order_release); }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class ttas_lock
+{
+    alignas(64) std::atomic<bool> locked {false};
+
+public:
+
+    void lock ()
+    {
+        spin_backoff backoff;
+        spin_wait wait;
+        for (;;) {
+            while (locked.load(std::memory_order_relaxed))
+                wait.pause();
+            if (!locked.exchange(true, std::memory_order_acquire))
+                return;
+            backoff.pause();
+        }
+    }
+
+    bool try_lock ()
+    {
+        return !locked.load(std::memory_order_relaxed) &&
+               !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock () { locked.store(false, std::memory_order_release); }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class ticket_lock
+{
+public:
+
+    // pauses per waiter ahead of us between two reads of `serving`
+    static constexpr unsigned spins_per_waiter = 32;
+
+private:
+
+    alignas(64) std::atomic<uint32_t> next {0};
+    std::atomic<uint32_t> serving {0};
+
+public:
+
+    void lock ()
+    {
+        uint32_t ticket = next.fetch_add(1, std::memory_order_relaxed);
+        spin_wait wait;
+        for (;;) {
+            uint32_t s = serving.load(std::memory_order_acquire);
+            if (s == ticket)
+                return;
+            for (unsigned i = (ticket - s) * spins_per_waiter; i != 0; --i)
+                wait.pause();
+        }
+    }
+
+    bool try_lock ()
+    {
+        uint32_t s = serving.load(std::memory_order_acquire);
+        uint32_t n = s;
+        return next.compare_exchange_strong(n, s + 1, std::memory_order_acquire,
+                                            std::memory_order_relaxed);
+    }
+
+    // only the owner writes `serving`
+    void unlock ()
+    {
+        serving.store(serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+namespace spinlocks_detail {
+
+// queue nodes of the calling thread not in use by any lock. Nodes are never
+// freed, an exiting thread leaves them to the next ones: a clh try_lock may
+// still read a node that has gone back to a cache.
+template <typename Node>
+class node_cache
+{
+    struct shared_pool {
+        std::mutex mtx;
+        std::vector<Node *> nodes;
+    };
+
+    std::vector<Node *> free_nodes;
+
+    static shared_pool &global()
+    {
+        // never destroyed: thread exits may still come after static destructors
+        static shared_pool *p = new shared_pool;
+        return *p;
+    }
+
+    static node_cache &local()
+    {
+        thread_local node_cache c;
+        return c;
+    }
+
+public:
+
+    ~node_cache()
+    {
+        shared_pool &p = global();
+        std::lock_guard<std::mutex> lock(p.mtx);
+        p.nodes.insert(p.nodes.end(), free_nodes.begin(), free_nodes.end());
+    }
+
+    static Node *get()
+    {
+        node_cache &c = local();
+        if (c.free_nodes.empty()) {
+            shared_pool &p = global();
+            std::lock_guard<std::mutex> lock(p.mtx);
+            if (p.nodes.empty())
+                return new Node;
+            c.free_nodes.swap(p.nodes);
+        }
+        Node *n = c.free_nodes.back();
+        c.free_nodes.pop_back();
+        return n;
+    }
+
+    static void put(Node *n) { local().free_nodes.push_back(n); }
+};
+
+} // namespace spinlocks_detail
+
+class mcs_lock
+{
+    struct alignas(64) node {
+        std::atomic<node *> next {nullptr};
+        std::atomic<bool> locked {false};
+    };
+
+    using cache = spinlocks_detail::node_cache<node>;
+
+    alignas(64) std::atomic<node *> tail {nullptr};
+    node *holder = nullptr;             // the owner's node, only the owner touches it
+
+public:
+
+    void lock ()
+    {
+        node *me = cache::get();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        me->locked.store(true, std::memory_order_relaxed);
+
+        node *pred = tail.exchange(me, std::memory_order_acq_rel);
+        if (pred) {
+            pred->next.store(me, std::memory_order_release);
+            spin_wait wait;
+            while (me->locked.load(std::memory_order_acquire))
+                wait.pause();
+        }
+        holder = me;
+    }
+
+    bool try_lock ()
+    {
+        node *me = cache::get();
+        me->next.store(nullptr, std::memory_order_relaxed);
+        node *expected = nullptr;
+        if (!tail.compare_exchange_strong(expected, me, std::memory_order_acquire,
+                                          std::memory_order_relaxed)) {
+            cache::put(me);
+            return false;
+        }
+        holder = me;
+        return true;
+    }
+
+    void unlock ()
+    {
+        node *me = holder;
+        node *succ = me->next.load(std::memory_order_acquire);
+        if (!succ) {
+            node *expected = me;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+                cache::put(me);
+                return;
+            }
+            // a successor swapped the tail but hasn't linked itself yet
+            spin_wait wait;
+            while (!(succ = me->next.load(std::memory_order_acquire)))
+                wait.pause();
+        }
+        succ->locked.store(false, std::memory_order_release);
+        cache::put(me);
+    }
+};
+
+class clh_lock
+{
+    struct alignas(64) node {
+        std::atomic<bool> locked {false};
+    };
+
+    using cache = spinlocks_detail::node_cache<node>;
+
+    alignas(64) std::atomic<node *> tail;
+    node *holder = nullptr;             // the owner's node and its predecessor's,
+    node *holder_pred = nullptr;        // only the owner touches them
+
+public:
+
+    clh_lock () : tail(new node) {}
+
+    // the node in the tail belongs to the lock, whichever thread brought it
+    ~clh_lock () { cache::put(tail.load()); }
+
+    clh_lock (const clh_lock &) = delete;
+
+    clh_lock &operator=(const clh_lock &) = delete;
+
+    void lock ()
+    {
+        node *me = cache::get();
+        me->locked.store(true, std::memory_order_relaxed);
+        node *pred = tail.exchange(me, std::memory_order_acq_rel);
+        spin_wait wait;
+        while (pred->locked.load(std::memory_order_acquire))
+            wait.pause();
+        holder = me;
+        holder_pred = pred;
+    }
+
+    bool try_lock ()
+    {
+        node *pred = tail.load(std::memory_order_acquire);
+        if (pred->locked.load(std::memory_order_relaxed))
+            return false;
+        node *me = cache::get();
+        me->locked.store(true, std::memory_order_relaxed);
+        if (!tail.compare_exchange_strong(pred, me, std::memory_order_acq_rel,
+                                          std::memory_order_relaxed)) {
+            cache::put(me);
+            return false;
+        }
+        // pred can only be locked again if it went round another thread's
+        // cache and back into the tail meanwhile; we are next then anyway
+        spin_wait wait;
+        while (pred->locked.load(std::memory_order_acquire))
+            wait.pause();
+        holder = me;
+        holder_pred = pred;
+        return true;
+    }
+
+    // the successor spins on our node, we keep the predecessor's one
+    void unlock ()
+    {
+        node *me = holder, *pred = holder_pred;
+        me->locked.store(false, std::memory_order_release);
+        cache::put(pred);
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+class hybrid_lock
+{
+public:
+
+    // failed attempts before sleeping
+    static constexpr unsigned spin_rounds = 100;
+
+private:
+
+    // 0 unlocked, 1 locked, 2 locked and maybe somebody sleeps
+    alignas(64) std::atomic<uint32_t> state {0};
+
+    static_assert(sizeof(std::atomic<uint32_t>) == sizeof(uint32_t), "futex needs a plain 32 bit word");
+
+    uint32_t *word () { return reinterpret_cast<uint32_t *>(&state); }
+
+    void wait ()
+    {
+        syscall(SYS_futex, word(), FUTEX_WAIT_PRIVATE, 2, nullptr, nullptr, 0);
+    }
+
+    void wake ()
+    {
+        syscall(SYS_futex, word(), FUTEX_WAKE_PRIVATE, 1, nullptr, nullptr, 0);
+    }
+
+public:
+
+    void lock ()
+    {
+        uint32_t c = 0;
+        for (unsigned i = 0; i < spin_rounds; ++i) {
+            c = 0;
+            if (state.compare_exchange_weak(c, 1, std::memory_order_acquire,
+                                            std::memory_order_relaxed))
+                return;
+            if (c == 2)
+                break;
+            cpu_relax();
+        }
+        if (c != 2)
+            c = state.exchange(2, std::memory_order_acquire);
+        while (c != 0) {
+            wait();
+            c = state.exchange(2, std::memory_order_acquire);
+        }
+    }
+
+    bool try_lock ()
+    {
+        uint32_t c = 0;
+        return state.compare_exchange_strong(c, 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed);
+    }
+
+    void unlock ()
+    {
+        if (state.exchange(0, std::memory_order_release) == 2)
+            wake();
+    }
+};
@@ -0,0 +1,96 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <optional>
+#include <stdexcept>
+#include <utility>
+
+// Bounded single-producer single-consumer ring.
+//
+// Each side owns one index and only reads the other one when its cached copy
+// says the ring is full (producer) or empty (consumer), so in the steady state
+// the two cores exchange a cache line once per lap instead of once per item.
+// The producer's and the consumer's fields sit on separate cache lines.
+template <typename T>
+class spsc_ring
+{
+
+private:
+
+    struct slot {
+        alignas(T) unsigned char storage[sizeof(T)];
+
+        T *value() { return std::launder(reinterpret_cast<T *>(storage)); }
+    };
+
+    // producer side
+    alignas(64) std::atomic<size_t> tail {0};
+    size_t cached_head = 0;
+
+    // consumer side
+    alignas(64) std::atomic<size_t> head {0};
+    size_t cached_tail = 0;
+
+    alignas(64) size_t mask;
+    std::unique_ptr<slot[]> slots;
+
+public:
+
+    // `capacity` is rounded up to a power of two
+    explicit spsc_ring (size_t capacity)
+    {
+        if (capacity < 2)
+            throw std::invalid_argument("spsc_ring: capacity should be at least 2");
+        size_t n = 1;
+        while (n < capacity)
+            n <<= 1;
+        mask = n - 1;
+        slots.reset(new slot[n]);
+    }
+
+    ~spsc_ring ()
+    {
+        for (size_t i = head.load(); i != tail.load(); ++i)
+            slots[i & mask].value()->~T();
+    }
+
+    spsc_ring (const spsc_ring &) = delete;
+
+    spsc_ring &operator=(const spsc_ring &) = delete;
+
+    size_t capacity () const { return mask + 1; }
+
+    // producer only, false if the ring is full
+    template <typename U>
+    bool try_push (U &&v)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - cached_head > mask) {
+            cached_head = head.load(std::memory_order_acquire);
+            if (t - cached_head > mask)
+                return false;
+        }
+        new (slots[t & mask].storage) T(std::forward<U>(v));
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    // consumer only, empty optional if the ring is empty
+    std::optional<T> try_pop ()
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == cached_tail) {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (h == cached_tail)
+                return std::nullopt;
+        }
+        T *p = slots[h & mask].value();
+        std::optional<T> v(std::move(*p));
+        p->~T();
+        head.store(h + 1, std::memory_order_release);
+        return v;
+    }
+};
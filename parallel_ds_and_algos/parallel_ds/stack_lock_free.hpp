@@ -1,54 +1,138 @@
 #pragma once
 
 #include <atomic>
+#include <optional>
+#include <utility>
 
-template <typename T>
+#include "reclamation.hpp"
+#include "node_pool.hpp"
+#include "elimination_array.hpp"
+
+// Treiber stack, popped nodes are handed to `Reclaimer` (see reclamation.hpp)
+// instead of being deleted while other poppers may still read them.
+// `Pooled` takes the nodes from per-thread free lists (node_pool.hpp) instead
+// of the global allocator, `Eliminate` lets a push and a pop that collide on
+// `head` cancel out in an elimination array (elimination_array.hpp).
+template <typename T, typename Reclaimer = hazard_pointers,
+          bool Pooled = true, bool Eliminate = true>
 class stack_lock_free
 {
 
 private:
 
-    template <typename W>
     struct Node {
-        W data;
-        Node <W> *next;
+        T data;
+        Node *next;
     };
 
-    std::atomic<Node<T>*> head ;
+    using pool = node_pool<Node>;
+
+    std::atomic<Node*> head ;
+
+    elimination_array<Node> elimination;
+
+    static Node *make(T &&data, Node *next);
+
+    static void destroy(Node *n);
 
 public:
  
-    T pop ();
+    // empty optional if the stack is empty
+    std::optional<T> pop ();
  
     void push (const T&);
+
+    void push (T&&);
+
+    bool empty () const { return head.load() == nullptr; }
  
     stack_lock_free (){ head.store(nullptr);}
 
+    // no other thread may use the stack any more
+    ~stack_lock_free ();
+
     stack_lock_free (const stack_lock_free &) = delete ;
 
     stack_lock_free &operator=(const stack_lock_free&) = delete;
  };
 
 
-template <typename T>
-void stack_lock_free<T>::push(const T &i)
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+auto stack_lock_free<T, Reclaimer, Pooled, Eliminate>::make(T &&data, Node *next) -> Node *
 {
-    Node<T> *newNode = new Node <T>;
-    newNode->data = i;
-    newNode->next = head.load();
-    while ( !head.compare_exchange_weak(newNode->next, newNode) );
+    if constexpr (Pooled)
+        return pool::create(std::move(data), next);
+    else
+        return new Node { std::move(data), next };
+}
+
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+void stack_lock_free<T, Reclaimer, Pooled, Eliminate>::destroy(Node *n)
+{
+    if constexpr (Pooled)
+        pool::destroy(n);
+    else
+        delete n;
+}
+
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+void stack_lock_free<T, Reclaimer, Pooled, Eliminate>::push(const T &i)
+{
+    push(T(i));
+}
+
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+void stack_lock_free<T, Reclaimer, Pooled, Eliminate>::push(T &&i)
+{
+    Node *newNode = make(std::move(i), head.load(std::memory_order_relaxed));
+    for (;;) {
+        if (head.compare_exchange_weak(newNode->next, newNode))
+            return;
+        if constexpr (Eliminate) {
+            if (elimination.offer(newNode))
+                return;
+            newNode->next = head.load(std::memory_order_relaxed);
+        }
+    }
 }
 
 //−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
-template <typename T>
-T stack_lock_free<T>::pop()
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+std::optional<T> stack_lock_free<T, Reclaimer, Pooled, Eliminate>::pop()
 {
-    Node<T> *candidate = head . load () ;
-    while (candidate != nullptr &&
-            !head.compare_exchange_weak (candidate, candidate->next ));
-    if (candidate == nullptr) throw "empty stack";
-    T tmp = candidate->data;
-    delete candidate;
-    return std::move(tmp);
+    typename Reclaimer::guard g;
+    for (;;) {
+        // protected, so neither freed nor recycled under us (no ABA)
+        Node *candidate = g.protect(head);
+        if (candidate == nullptr)
+            return std::nullopt;
+        if (head.compare_exchange_weak(candidate, candidate->next)) {
+            std::optional<T> tmp(std::move(candidate->data));
+            g.reset();
+            if constexpr (Pooled)
+                Reclaimer::retire(candidate, &pool::destroy);
+            else
+                Reclaimer::retire(candidate);
+            return tmp;
+        }
+        if constexpr (Eliminate) {
+            // a node taken from a pusher was never in the stack, it is ours alone
+            if (Node *n = elimination.take()) {
+                std::optional<T> tmp(std::move(n->data));
+                destroy(n);
+                return tmp;
+            }
+        }
+    }
 }
 
+template <typename T, typename Reclaimer, bool Pooled, bool Eliminate>
+stack_lock_free<T, Reclaimer, Pooled, Eliminate>::~stack_lock_free()
+{
+    Node *n = head.load();
+    while (n != nullptr) {
+        Node *next = n->next;
+        destroy(n);
+        n = next;
+    }
+}
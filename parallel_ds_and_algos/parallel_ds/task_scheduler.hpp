@@ -0,0 +1,395 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include <pthread.h>
+#include <sched.h>
+#include "work_stealing_deque.hpp"
+#include "spinlocks.hpp"
+
+// Work-stealing fork-join scheduler.
+//
+// Every worker owns a work_stealing_deque: it pushes the tasks it spawns and
+// takes them back at the bottom (depth first, cache warm), an idle worker
+// steals the oldest task, usually the largest piece of work, from the top of
+// a random victim. Threads that are not workers hand their tasks over through
+// a shared injection queue. A thread waiting in sync() runs other tasks
+// meanwhile, so tasks may spawn and sync groups of their own.
+//
+//   task_scheduler sched;                  // one worker per cpu
+//   task_group g(sched);
+//   g.spawn([&] { left = fib(n - 1); });
+//   right = fib(n - 2);
+//   g.sync();                              // rethrows what a task threw
+//
+//   sched.parallel_for(0, n, [&](size_t i) { y[i] = f(x[i]); });
+//
+// Workers spin a little, then yield, then sleep until new work is spawned.
+
+class task_group;
+
+class task_scheduler
+{
+public:
+
+    // iterations between two checks of the adaptive parallel_for are at
+    // least the range over that many times the number of workers
+    static constexpr size_t chunks_per_worker = 64;
+
+    // idle rounds before a worker yields, and before it goes to sleep
+    static constexpr unsigned spin_rounds = 64;
+    static constexpr unsigned yield_rounds = 256;
+
+    // `threads` 0 is one worker per cpu, `pin` binds worker i to cpu i
+    explicit task_scheduler (size_t threads = 0, bool pin = false);
+
+    ~task_scheduler ();
+
+    task_scheduler (const task_scheduler &) = delete;
+
+    task_scheduler &operator=(const task_scheduler &) = delete;
+
+    size_t size () const { return workers.size(); }
+
+    // calls f(i) for every i in [begin, end) and returns when all are done.
+    // With `grain` 0 a range is only split while some worker is idle (lazy
+    // binary splitting), otherwise it is split in halves down to `grain`.
+    template <typename F>
+    void parallel_for (size_t begin, size_t end, F f, size_t grain = 0);
+
+private:
+
+    friend class task_group;
+
+    struct task {
+        task_group *group = nullptr;
+
+        virtual ~task() = default;
+        virtual void run() = 0;
+    };
+
+    template <typename F>
+    struct task_impl : task {
+        F f;
+
+        explicit task_impl(F fn) : f(std::move(fn)) {}
+        void run() override { f(); }
+    };
+
+    struct worker {
+        task_scheduler *owner;
+        work_stealing_deque<task *> deque;
+        std::thread thread;
+
+        explicit worker(task_scheduler *s) : owner(s) {}
+    };
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    std::mutex inject_mtx;
+    std::deque<task *> injected;
+    std::atomic<size_t> injected_count {0};
+
+    std::mutex sleep_mtx;
+    std::condition_variable sleep_cv;
+    std::atomic<size_t> sleepers {0};
+    std::atomic<uint64_t> wake_epoch {0};   // written under sleep_mtx
+    std::atomic<bool> stopping {false};
+
+    static worker *&current ()
+    {
+        thread_local worker *w = nullptr;
+        return w;
+    }
+
+    static uint64_t random ()
+    {
+        thread_local uint64_t state = 0x9E3779B97F4A7C15ull ^ uint64_t(uintptr_t(&state));
+        state ^= state << 13;
+        state ^= state >> 7;
+        state ^= state << 17;
+        return state;
+    }
+
+    // the calling thread's worker if it belongs to this scheduler
+    worker *self () const
+    {
+        worker *w = current();
+        return w && w->owner == this ? w : nullptr;
+    }
+
+    // no queued work the calling thread could give away
+    bool hungry (worker *w) const
+    {
+        return w ? w->deque.empty() : injected_count.load(std::memory_order_relaxed) == 0;
+    }
+
+    void submit (task *t);
+
+    task *find_work (worker *w);
+
+    void execute (task *t);
+
+    void work (worker *w);
+
+    template <typename F>
+    void split_lazily (task_group &g, size_t begin, size_t end, F &f, size_t chunk);
+
+    template <typename F>
+    void split_evenly (task_group &g, size_t begin, size_t end, F &f, size_t grain);
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+// tasks spawned together and waited for together
+class task_group
+{
+    friend class task_scheduler;
+
+    task_scheduler &sched;
+    std::atomic<size_t> pending {0};
+    std::atomic<bool> failed {false};
+    std::exception_ptr error;               // the first exception, set before pending drops
+
+    void fail (std::exception_ptr e)
+    {
+        if (!failed.exchange(true))
+            error = std::move(e);
+    }
+
+    void wait ()
+    {
+        task_scheduler::worker *w = sched.self();
+        unsigned idle = 0;
+        while (pending.load(std::memory_order_acquire) != 0) {
+            if (task_scheduler::task *t = sched.find_work(w)) {
+                sched.execute(t);
+                idle = 0;
+            } else if (++idle < task_scheduler::spin_rounds) {
+                cpu_relax();
+            } else {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+public:
+
+    explicit task_group (task_scheduler &s) : sched(s) {}
+
+    // waits, but drops an exception nobody synced for
+    ~task_group () { wait(); }
+
+    task_group (const task_group &) = delete;
+
+    task_group &operator=(const task_group &) = delete;
+
+    template <typename F>
+    void spawn (F &&f)
+    {
+        auto *t = new task_scheduler::task_impl<std::decay_t<F>>(std::forward<F>(f));
+        t->group = this;
+        pending.fetch_add(1, std::memory_order_relaxed);
+        sched.submit(t);
+    }
+
+    // returns once every spawned task has finished, running tasks meanwhile;
+    // rethrows the first exception a task threw
+    void sync ()
+    {
+        wait();
+        if (failed.load(std::memory_order_relaxed)) {
+            std::exception_ptr e = std::move(error);
+            error = nullptr;
+            failed.store(false, std::memory_order_relaxed);
+            std::rethrow_exception(e);
+        }
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+inline task_scheduler::task_scheduler (size_t threads, bool pin)
+{
+    unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+    if (threads == 0)
+        threads = ncpu;
+
+    for (size_t i = 0; i < threads; ++i)
+        workers.emplace_back(new worker(this));
+    // all deques exist before anybody steals
+    for (size_t i = 0; i < threads; ++i) {
+        worker *w = workers[i].get();
+        w->thread = std::thread([this, w] { work(w); });
+        if (pin) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(i % ncpu, &set);
+            pthread_setaffinity_np(w->thread.native_handle(), sizeof(set), &set);
+        }
+    }
+}
+
+// every task_group must have been synced before
+inline task_scheduler::~task_scheduler ()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mtx);
+        stopping.store(true);
+        wake_epoch.fetch_add(1);
+    }
+    sleep_cv.notify_all();
+    for (auto &w : workers)
+        w->thread.join();
+}
+
+inline void task_scheduler::submit (task *t)
+{
+    if (worker *w = self()) {
+        w->deque.push(t);
+    } else {
+        std::lock_guard<std::mutex> lock(inject_mtx);
+        injected.push_back(t);
+        injected_count.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // pairs with the fence in work(): either the sleeper sees the task or we see the sleeper
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) != 0) {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mtx);
+            wake_epoch.fetch_add(1, std::memory_order_relaxed);
+        }
+        sleep_cv.notify_one();
+    }
+}
+
+inline task_scheduler::task *task_scheduler::find_work (worker *w)
+{
+    if (w)
+        if (auto t = w->deque.take())
+            return *t;
+
+    if (injected_count.load(std::memory_order_relaxed) != 0) {
+        std::lock_guard<std::mutex> lock(inject_mtx);
+        if (!injected.empty()) {
+            task *t = injected.front();
+            injected.pop_front();
+            injected_count.fetch_sub(1, std::memory_order_relaxed);
+            return t;
+        }
+    }
+
+    size_t n = workers.size();
+    size_t start = random() % n;
+    for (size_t i = 0; i < n; ++i) {
+        worker *victim = workers[(start + i) % n].get();
+        if (victim != w)
+            if (auto t = victim->deque.steal())
+                return *t;
+    }
+    return nullptr;
+}
+
+inline void task_scheduler::execute (task *t)
+{
+    task_group *g = t->group;
+    try {
+        t->run();
+    } catch (...) {
+        g->fail(std::current_exception());
+    }
+    delete t;
+    // the group may be gone right after this
+    g->pending.fetch_sub(1, std::memory_order_release);
+}
+
+inline void task_scheduler::work (worker *w)
+{
+    current() = w;
+    unsigned idle = 0;
+    while (!stopping.load(std::memory_order_acquire)) {
+        if (task *t = find_work(w)) {
+            execute(t);
+            idle = 0;
+            continue;
+        }
+        if (++idle < spin_rounds) {
+            cpu_relax();
+            continue;
+        }
+        if (idle < spin_rounds + yield_rounds) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        uint64_t epoch = wake_epoch.load(std::memory_order_acquire);
+        sleepers.fetch_add(1, std::memory_order_seq_cst);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (task *t = find_work(w)) {
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+            execute(t);
+        } else {
+            std::unique_lock<std::mutex> lock(sleep_mtx);
+            sleep_cv.wait(lock, [&] {
+                return wake_epoch.load(std::memory_order_relaxed) != epoch || stopping.load();
+            });
+            sleepers.fetch_sub(1, std::memory_order_relaxed);
+        }
+        idle = 0;
+    }
+    current() = nullptr;
+}
+
+// runs chunks from the front and gives the back half away whenever the
+// calling thread has nothing queued that an idle worker could steal
+template <typename F>
+void task_scheduler::split_lazily (task_group &g, size_t begin, size_t end, F &f, size_t chunk)
+{
+    worker *w = self();
+    while (begin < end) {
+        if (end - begin > chunk && hungry(w)) {
+            size_t mid = begin + (end - begin) / 2;
+            g.spawn([this, &g, &f, mid, end, chunk] { split_lazily(g, mid, end, f, chunk); });
+            end = mid;
+            continue;
+        }
+        size_t stop = std::min(end, begin + chunk);
+        for (; begin < stop; ++begin)
+            f(begin);
+    }
+}
+
+template <typename F>
+void task_scheduler::split_evenly (task_group &g, size_t begin, size_t end, F &f, size_t grain)
+{
+    while (end - begin > grain) {
+        size_t mid = begin + (end - begin) / 2;
+        g.spawn([this, &g, &f, mid, end, grain] { split_evenly(g, mid, end, f, grain); });
+        end = mid;
+    }
+    for (; begin < end; ++begin)
+        f(begin);
+}
+
+template <typename F>
+void task_scheduler::parallel_for (size_t begin, size_t end, F f, size_t grain)
+{
+    if (begin >= end)
+        return;
+    task_group g(*this);
+    if (grain == 0)
+        split_lazily(g, begin, end, f, std::max<size_t>(1, (end - begin) / (chunks_per_worker * size())));
+    else
+        split_evenly(g, begin, end, f, grain);
+    g.sync();
+}
@@ -1,38 +1,425 @@
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <mutex>
+#include <stack>
+#include <queue>
+#include <shared_mutex>
+#include <unordered_map>
+#include <string>
+#include <sstream>
+#include <functional>
+#include <getopt.h>
 #include "stack_lock_free.hpp"
+#include "queue_lock_free.hpp"
+#include "spsc_ring.hpp"
+#include "mpmc_bounded_queue.hpp"
+#include "hash_map_lock_free.hpp"
+#include "spinlocks.hpp"
+#include "read_mostly.hpp"
+#include "bench_harness.hpp"
 
-static size_t nthr = 0;
+// runs the structures of this directory through bench_harness.hpp:
+//
+//   test_bench --threads 1,2,4,8,16,32,64 --duration 2 --mix 50 --pin
+//   test_bench --structures stack_hp,mutex_stack --dist zipf --csv > stack.csv
+//   test_bench --structures map_hp,mutex_map --mix 10     (read heavy)
+//   test_bench --structures map_hp,mutex_map --mix 90     (write heavy)
+//   test_bench --structures mutex,tas_lock,ttas_lock,ticket_lock,mcs_lock,clh_lock,hybrid_lock --pin
+//   test_bench --structures counter_rw,counter_seqlock,counter_brlock,counter_sharded --mix 1
+//
+// a put is a push (lock: a write, map: an insert, or an erase if the key is
+// there), a get is a pop (lock: a read of the counters, map: a find);
+// the spsc ring always runs with one producer and one consumer
 
-stack_lock_free<int> st;
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+// the baseline everybody starts with
+template <typename T>
+class stack_mutex
+{
+    std::mutex mtx;
+    std::stack<T> st;
+
+public:
+
+    void push(const T &v)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        st.push(v);
+    }
+
+    std::optional<T> pop()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (st.empty())
+            return std::nullopt;
+        T v = st.top();
+        st.pop();
+        return v;
+    }
+};
 
-void inc_thread(size_t id)
+template <typename Stack>
+struct stack_workload
 {
-    if (id % 2 == 0) {
-        st.push(id);
-    } else {
-        int nid = st.pop();
+    Stack st;
+
+    void prefill(uint64_t key) { st.push(key); }
+
+    void op(size_t, bool put, uint64_t key)
+    {
+        if (put)
+            st.push(key);
+        else
+            st.pop();
     }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+template <typename T>
+class queue_mutex
+{
+    std::mutex mtx;
+    std::queue<T> q;
+
+public:
+
+    void push(const T &v)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        q.push(v);
+    }
+
+    std::optional<T> pop()
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (q.empty())
+            return std::nullopt;
+        T v = q.front();
+        q.pop();
+        return v;
+    }
+};
+
+// a full bounded queue drops the put, the op is counted anyway
+template <typename Queue>
+struct bounded_workload
+{
+    Queue q { 4096 };
+
+    void prefill(uint64_t key) { q.try_push(key); }
+
+    void op(size_t, bool put, uint64_t key)
+    {
+        if (put)
+            q.try_push(key);
+        else
+            q.try_pop();
+    }
+};
+
+// thread 0 produces, thread 1 consumes, the mix is ignored
+struct spsc_workload
+{
+    spsc_ring<uint64_t> q { 4096 };
+
+    void prefill(uint64_t key) { q.try_push(key); }
+
+    void op(size_t thread, bool, uint64_t key)
+    {
+        if (thread == 0)
+            q.try_push(key);
+        else
+            q.try_pop();
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+// readers share the lock, like ThreadSafeCounter in c++new-features/shared_mutex.cpp
+template <typename K, typename V>
+class shared_mutex_map
+{
+    mutable std::shared_mutex mtx;
+    std::unordered_map<K, V> map;
+
+public:
+
+    bool insert(const K &key, const V &value)
+    {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        return map.emplace(key, value).second;
+    }
+
+    std::optional<V> find(const K &key) const
+    {
+        std::shared_lock<std::shared_mutex> lock(mtx);
+        auto it = map.find(key);
+        if (it == map.end())
+            return std::nullopt;
+        return it->second;
+    }
+
+    bool erase(const K &key)
+    {
+        std::unique_lock<std::shared_mutex> lock(mtx);
+        return map.erase(key) != 0;
+    }
+};
+
+template <typename Map>
+struct map_workload
+{
+    Map map;
+
+    void prefill(uint64_t key) { map.insert(key, key); }
+
+    void op(size_t, bool put, uint64_t key)
+    {
+        if (!put)
+            map.find(key);
+        else if (!map.insert(key, key))
+            map.erase(key);
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+// read-mostly counters, get is a read and put an increment;
+// counter_rw is ThreadSafeCounter of c++new-features/shared_mutex.cpp
+template <typename SharedLock>
+class rw_counter
+{
+    mutable SharedLock mtx;
+    uint64_t value = 0;
+
+public:
+
+    uint64_t get() const
+    {
+        std::shared_lock<SharedLock> lock(mtx);
+        return value;
+    }
+
+    void increment()
+    {
+        std::unique_lock<SharedLock> lock(mtx);
+        ++value;
+    }
+};
+
+class atomic_counter
+{
+    std::atomic<uint64_t> value {0};
+
+public:
+
+    uint64_t get() const { return value.load(std::memory_order_acquire); }
+
+    void increment() { value.fetch_add(1, std::memory_order_acq_rel); }
+};
+
+class seqlock_counter
+{
+    seqlock<uint64_t> value;
+
+public:
+
+    uint64_t get() const { return value.load(); }
+
+    void increment() { value.update([](uint64_t &v) { ++v; }); }
+};
+
+class sharded_counter_adapter
+{
+    sharded_counter value;
+
+public:
+
+    uint64_t get() const { return value.get(); }
+
+    void increment() { value.add(1); }
+};
+
+template <typename Counter>
+struct counter_workload
+{
+    Counter counter;
+
+    void prefill(uint64_t) { counter.increment(); }
+
+    void op(size_t, bool put, uint64_t)
+    {
+        if (put) {
+            counter.increment();
+        } else {
+            uint64_t v = counter.get();
+            asm volatile("" : : "r"(v));
+        }
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+// a short critical section over a few cache lines
+template <typename Lock>
+struct lock_workload
+{
+    static constexpr size_t lines = 4;
+
+    Lock l;
+    struct alignas(64) line { uint64_t value = 0; };
+    line counters[lines];
+
+    void prefill(uint64_t) {}
+
+    void op(size_t, bool put, uint64_t key)
+    {
+        std::lock_guard<Lock> guard(l);
+        if (put) {
+            ++counters[key % lines].value;
+        } else {
+            uint64_t sum = 0;
+            for (auto &c : counters)
+                sum += c.value;
+            asm volatile("" : : "r"(sum));
+        }
+    }
+};
+
+//−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−−
+using bench_fn = std::function<bench_result(const bench_config &, size_t)>;
+
+struct structure
+{
+    std::string name;
+    bench_fn run;
+    size_t fixed_threads;   // runs with exactly that many threads, 0 for any
+};
+
+template <typename Workload>
+structure make_structure(const std::string &name, size_t fixed_threads = 0)
+{
+    return structure { name, [name](const bench_config &cfg, size_t nthr) {
+        return run_bench<Workload>(name, cfg, nthr);
+    }, fixed_threads };
+}
+
+std::vector<structure> all_structures()
+{
+    return {
+        make_structure<stack_workload<stack_mutex<uint64_t>>>("mutex_stack"),
+        make_structure<stack_workload<stack_lock_free<uint64_t, hazard_pointers, false, false>>>("treiber"),
+        make_structure<stack_workload<stack_lock_free<uint64_t, hazard_pointers>>>("stack_hp"),
+        make_structure<stack_workload<stack_lock_free<uint64_t, epoch_based>>>("stack_ebr"),
+        make_structure<stack_workload<queue_mutex<uint64_t>>>("mutex_queue"),
+        make_structure<stack_workload<queue_lock_free<uint64_t, hazard_pointers>>>("queue_hp"),
+        make_structure<stack_workload<queue_lock_free<uint64_t, epoch_based>>>("queue_ebr"),
+        make_structure<bounded_workload<mpmc_bounded_queue<uint64_t>>>("mpmc_bounded"),
+        make_structure<spsc_workload>("spsc_ring", 2),
+        make_structure<map_workload<shared_mutex_map<uint64_t, uint64_t>>>("mutex_map"),
+        make_structure<map_workload<hash_map_lock_free<uint64_t, uint64_t>>>("map_hp"),
+        make_structure<map_workload<hash_map_lock_free<uint64_t, uint64_t, std::hash<uint64_t>, epoch_based>>>("map_ebr"),
+        make_structure<counter_workload<rw_counter<std::shared_mutex>>>("counter_rw"),
+        make_structure<counter_workload<atomic_counter>>("counter_atomic"),
+        make_structure<counter_workload<seqlock_counter>>("counter_seqlock"),
+        make_structure<counter_workload<rw_counter<br_lock>>>("counter_brlock"),
+        make_structure<counter_workload<sharded_counter_adapter>>("counter_sharded"),
+        make_structure<lock_workload<std::mutex>>("mutex"),
+        make_structure<lock_workload<tas_lock>>("tas_lock"),
+        make_structure<lock_workload<ttas_lock>>("ttas_lock"),
+        make_structure<lock_workload<ticket_lock>>("ticket_lock"),
+        make_structure<lock_workload<mcs_lock>>("mcs_lock"),
+        make_structure<lock_workload<clh_lock>>("clh_lock"),
+        make_structure<lock_workload<hybrid_lock>>("hybrid_lock"),
+    };
+}
+
+std::vector<std::string> split(const std::string &s)
+{
+    std::vector<std::string> parts;
+    std::stringstream ss(s);
+    std::string item;
+    while (std::getline(ss, item, ','))
+        if (!item.empty())
+            parts.push_back(item);
+    return parts;
+}
+
+void usage(const char *prog, const std::vector<structure> &structures)
+{
+    std::cout << "usage: " << prog << " [options]\n"
+              << "  --structures a,b   default all of:";
+    for (auto &s : structures)
+        std::cout << " " << s.name;
+    std::cout << "\n"
+              << "  --threads 1,2,4    thread counts to run\n"
+              << "  --duration 1       seconds per run\n"
+              << "  --mix 50           percent of puts\n"
+              << "  --dist uniform     or zipf\n"
+              << "  --theta 0.99       zipf skew\n"
+              << "  --keys 65536       key range\n"
+              << "  --prefill 1024     puts before the run\n"
+              << "  --sample 16        time one op in that many, 0 for none\n"
+              << "  --pin              pin thread i to cpu i\n"
+              << "  --csv              csv instead of a table\n";
 }
 
 auto main(int argc, char **argv) -> int
 {
-  if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " <num of threads>\n";
-    return EXIT_FAILURE;
-  }
+  bench_config cfg;
+  std::vector<size_t> threads { 1, 2, 4, 8, 16, 32, 64 };
+  std::vector<structure> structures = all_structures();
+  std::vector<std::string> selected;
+  bool csv = false;
 
-  std::vector<std::thread> threads;
-  nthr = std::atoi(argv[1]);
-  threads.resize(nthr);
+  static const option options[] = {
+      { "structures", required_argument, nullptr, 's' },
+      { "threads",    required_argument, nullptr, 't' },
+      { "duration",   required_argument, nullptr, 'd' },
+      { "mix",        required_argument, nullptr, 'm' },
+      { "dist",       required_argument, nullptr, 'D' },
+      { "theta",      required_argument, nullptr, 'z' },
+      { "keys",       required_argument, nullptr, 'k' },
+      { "prefill",    required_argument, nullptr, 'p' },
+      { "sample",     required_argument, nullptr, 'S' },
+      { "pin",        no_argument,       nullptr, 'P' },
+      { "csv",        no_argument,       nullptr, 'c' },
+      { "help",       no_argument,       nullptr, 'h' },
+      { nullptr, 0, nullptr, 0 },
+  };
 
-  for (size_t i = 0; i < nthr; ++i) {
-    threads[i] = std::thread(inc_thread, i);
+  int opt;
+  while ((opt = getopt_long(argc, argv, "", options, nullptr)) != -1) {
+    switch (opt) {
+    case 's': selected = split(optarg); break;
+    case 't':
+      threads.clear();
+      for (auto &t : split(optarg))
+        threads.push_back(std::stoul(t));
+      break;
+    case 'd': cfg.duration = std::stod(optarg); break;
+    case 'm': cfg.put_percent = std::min(100ul, std::stoul(optarg)); break;
+    case 'D': cfg.dist = std::string(optarg) == "zipf" ? bench_config::zipf : bench_config::uniform; break;
+    case 'z': cfg.zipf_theta = std::stod(optarg); break;
+    case 'k': cfg.keys = std::max(2ul, std::stoul(optarg)); break;
+    case 'p': cfg.prefill = std::stoul(optarg); break;
+    case 'S': cfg.sample_every = std::stoul(optarg); break;
+    case 'P': cfg.pin = true; break;
+    case 'c': csv = true; break;
+    default:
+      usage(argv[0], structures);
+      return opt == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
   }
 
-  for (size_t i = 0; i < nthr; ++i) {
-    threads[i].join();
+  print_header(csv);
+  for (auto &s : structures) {
+    if (!selected.empty() && std::find(selected.begin(), selected.end(), s.name) == selected.end())
+      continue;
+    if (s.fixed_threads != 0) {
+      print_result(s.run(cfg, s.fixed_threads), csv);
+      continue;
+    }
+    for (size_t nthr : threads)
+      print_result(s.run(cfg, nthr), csv);
   }
 
     return EXIT_SUCCESS;
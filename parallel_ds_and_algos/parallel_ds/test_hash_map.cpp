@@ -0,0 +1,86 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+#include "hash_map_lock_free.hpp"
+
+// stress test of hash_map_lock_free:
+//
+//   test_hash_map [threads = 4] [keys per thread = 100000]
+//
+// every thread owns a range of keys and inserts, erases and reinserts them
+// while the others read everything; the map starts with 2 buckets so it
+// resizes all along. At the end exactly the odd keys must be there, with
+// their values. Failures exit with a message.
+
+static void check(bool ok, const std::string &what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+template <typename Map>
+void stress(const std::string &name, size_t nthr, size_t keys)
+{
+    Map map(2);
+    std::atomic<bool> writing {true};
+    std::atomic<size_t> writers {nthr};
+    std::vector<std::thread> threads;
+
+    for (size_t t = 0; t < nthr; ++t)
+        threads.emplace_back([&, t] {
+            size_t first = t * keys;
+            for (size_t k = first; k < first + keys; ++k)
+                check(map.insert(std::to_string(k), k), name + ": fresh insert failed");
+            for (size_t k = first; k < first + keys; ++k)
+                check(!map.insert(std::to_string(k), 0), name + ": duplicate inserted");
+            for (size_t k = first; k < first + keys; k += 2)
+                check(map.erase(std::to_string(k)), name + ": erase failed");
+            for (size_t k = first; k < first + keys; k += 2)
+                check(!map.erase(std::to_string(k)), name + ": erased twice");
+            if (writers.fetch_sub(1) == 1)
+                writing.store(false);
+        });
+
+    // readers: whatever they find must carry the right value
+    for (size_t t = 0; t < nthr; ++t)
+        threads.emplace_back([&, t] {
+            uint64_t x = t + 1;
+            while (writing.load()) {
+                x ^= x << 13; x ^= x >> 7; x ^= x << 17;
+                size_t k = x % (nthr * keys);
+                if (auto v = map.find(std::to_string(k)))
+                    check(*v == k, name + ": wrong value");
+            }
+        });
+
+    for (auto &t : threads)
+        t.join();
+
+    check(map.size() == nthr * keys / 2, name + ": wrong size");
+    for (size_t k = 0; k < nthr * keys; ++k) {
+        auto v = map.find(std::to_string(k));
+        check(bool(v) == (k % 2 == 1), name + ": wrong contents");
+        check(!v || *v == k, name + ": wrong value at the end");
+    }
+    std::cout << name << ": ok, " << map.buckets() << " buckets" << std::endl;
+}
+
+auto main(int argc, char **argv) -> int
+{
+  size_t nthr = argc > 1 ? std::atoi(argv[1]) : 4;
+  size_t keys = argc > 2 ? std::atoi(argv[2]) : 100000;
+  if (nthr == 0 || keys == 0) {
+    std::cout << "usage: " << argv[0] << " [threads] [keys per thread]\n";
+    return EXIT_FAILURE;
+  }
+
+  stress<hash_map_lock_free<std::string, size_t, std::hash<std::string>, hazard_pointers>>("hash_map_hp", nthr, keys);
+  stress<hash_map_lock_free<std::string, size_t, std::hash<std::string>, epoch_based>>("hash_map_ebr", nthr, keys);
+
+    return EXIT_SUCCESS;
+}
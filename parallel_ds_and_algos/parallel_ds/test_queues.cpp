@@ -0,0 +1,147 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <string>
+#include <cstdlib>
+#include <type_traits>
+#include "queue_lock_free.hpp"
+#include "spsc_ring.hpp"
+#include "mpmc_bounded_queue.hpp"
+
+// stress tests of the queues:
+//
+//   test_queues [producers = 4] [consumers = 4] [items per producer = 200000]
+//
+// every item is (producer, sequence number). Nothing may be lost or duplicated,
+// and as a producer's enqueues are ordered, every consumer must see each
+// producer's items in increasing order; a linearizable FIFO queue can't break
+// that. Queues with `empty()` also have it polled all along, so that it runs
+// against the pops freeing the nodes. Failures exit with a message.
+
+static void check(bool ok, const std::string &what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+static uint64_t encode(size_t producer, uint64_t seq) { return (uint64_t(producer) << 40) | seq; }
+
+// adapters to one interface: blocking push, non-blocking pop
+template <typename Q>
+struct unbounded
+{
+    Q q;
+    void push(uint64_t v) { q.push(v); }
+    std::optional<uint64_t> pop() { return q.pop(); }
+    bool empty() const { return q.empty(); }
+};
+
+template <typename Q>
+struct bounded
+{
+    Q q { 1024 };
+    void push(uint64_t v) { while (!q.try_push(v)) std::this_thread::yield(); }
+    std::optional<uint64_t> pop() { return q.try_pop(); }
+};
+
+template <typename Q, typename = void>
+struct has_empty : std::false_type {};
+
+template <typename Q>
+struct has_empty<Q, std::void_t<decltype(std::declval<const Q &>().empty())>> : std::true_type {};
+
+template <typename Queue>
+void mpmc_stress(const std::string &name, size_t producers, size_t consumers, uint64_t items)
+{
+    Queue q;
+    std::atomic<size_t> producers_done {0};
+    std::atomic<uint64_t> popped {0}, sum {0};
+    std::vector<std::thread> threads;
+
+    for (size_t p = 0; p < producers; ++p)
+        threads.emplace_back([&, p] {
+            for (uint64_t i = 1; i <= items; ++i)
+                q.push(encode(p, i));
+            producers_done.fetch_add(1);
+        });
+
+    for (size_t c = 0; c < consumers; ++c)
+        threads.emplace_back([&] {
+            std::vector<uint64_t> last(producers, 0);
+            for (;;) {
+                bool done = producers_done.load() == producers;
+                auto v = q.pop();
+                if (!v) {
+                    if (done)
+                        break;
+                    std::this_thread::yield();
+                    continue;
+                }
+                size_t p = *v >> 40;
+                uint64_t seq = *v & ((uint64_t(1) << 40) - 1);
+                check(p < producers, name + ": garbage item");
+                check(seq > last[p], name + ": producer order broken");
+                last[p] = seq;
+                popped.fetch_add(1, std::memory_order_relaxed);
+                sum.fetch_add(seq, std::memory_order_relaxed);
+            }
+        });
+
+    if constexpr (has_empty<Queue>::value)
+        threads.emplace_back([&] {
+            while (popped.load(std::memory_order_relaxed) < producers * items)
+                (void)q.empty();
+        });
+
+    for (auto &t : threads)
+        t.join();
+
+    check(popped.load() == producers * items, name + ": items lost or duplicated");
+    check(sum.load() == producers * items * (items + 1) / 2, name + ": wrong items");
+    check(!q.pop(), name + ": not empty at the end");
+    std::cout << name << ": ok" << std::endl;
+}
+
+void spsc_stress(uint64_t items)
+{
+    spsc_ring<std::string> ring(64);
+    std::thread producer([&] {
+        for (uint64_t i = 0; i < items; ++i)
+            while (!ring.try_push(std::to_string(i)))
+                std::this_thread::yield();
+    });
+    for (uint64_t i = 0; i < items; ) {
+        auto v = ring.try_pop();
+        if (!v) {
+            std::this_thread::yield();
+            continue;
+        }
+        check(*v == std::to_string(i), "spsc_ring: out of order");
+        ++i;
+    }
+    producer.join();
+    check(!ring.try_pop(), "spsc_ring: not empty at the end");
+    std::cout << "spsc_ring: ok" << std::endl;
+}
+
+auto main(int argc, char **argv) -> int
+{
+  size_t producers = argc > 1 ? std::atoi(argv[1]) : 4;
+  size_t consumers = argc > 2 ? std::atoi(argv[2]) : 4;
+  uint64_t items = argc > 3 ? std::atoll(argv[3]) : 200000;
+  if (producers == 0 || consumers == 0 || items == 0) {
+    std::cout << "usage: " << argv[0] << " [producers] [consumers] [items per producer]\n";
+    return EXIT_FAILURE;
+  }
+
+  mpmc_stress<unbounded<queue_lock_free<uint64_t, hazard_pointers>>>("queue_hp", producers, consumers, items);
+  mpmc_stress<unbounded<queue_lock_free<uint64_t, epoch_based>>>("queue_ebr", producers, consumers, items);
+  mpmc_stress<unbounded<queue_lock_free<uint64_t, hazard_pointers, false>>>("queue_hp_new", producers, consumers, items);
+  mpmc_stress<bounded<mpmc_bounded_queue<uint64_t>>>("mpmc_bounded", producers, consumers, items);
+  spsc_stress(items * producers);
+
+    return EXIT_SUCCESS;
+}
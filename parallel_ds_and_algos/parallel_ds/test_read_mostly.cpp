@@ -0,0 +1,149 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <cstdlib>
+#include "read_mostly.hpp"
+
+// tests of read_mostly.hpp:
+//
+//   test_read_mostly [readers = 3] [writes = 200000]
+//
+// a seqlock reader must never see a half written value, a br_lock reader
+// never a half done update, and a sharded counter must add up. Failures
+// exit with a message.
+
+static void check(bool ok, const std::string &what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+// three words, consistent only if written together
+struct triple {
+    uint64_t a, b, c;
+};
+
+void seqlock_test(size_t readers, uint64_t writes)
+{
+    seqlock<triple> s(triple { 0, ~uint64_t(0), 0 });
+    std::atomic<bool> done {false};
+    std::atomic<uint64_t> reads {0};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < readers; ++i)
+        threads.emplace_back([&] {
+            uint64_t last = 0, n = 0;
+            while (!done.load(std::memory_order_relaxed)) {
+                triple t = s.load();
+                check(t.b == ~t.a && t.c == 3 * t.a, "seqlock: torn read");
+                check(t.a >= last, "seqlock: went back in time");
+                last = t.a;
+                ++n;
+            }
+            reads.fetch_add(n);
+        });
+
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= writes; ++i) {
+            if (i % 2)
+                s.store(triple { i, ~i, 3 * i });
+            else
+                s.update([](triple &t) { ++t.a; t.b = ~t.a; t.c = 3 * t.a; });
+        }
+        done.store(true);
+    });
+    writer.join();
+    for (auto &t : threads)
+        t.join();
+
+    check(s.load().a == writes, "seqlock: lost write");
+    std::cout << "seqlock: ok, " << reads.load() << " reads" << std::endl;
+}
+
+void br_lock_test(size_t readers, uint64_t writes)
+{
+    br_lock l(2);                       // fewer slots than threads, slots are shared
+    uint64_t x = 0, y = 0;
+    std::atomic<bool> done {false};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < readers; ++i)
+        threads.emplace_back([&] {
+            while (!done.load(std::memory_order_relaxed)) {
+                std::shared_lock<br_lock> lock(l);
+                check(x == y, "br_lock: reader saw a half done write");
+            }
+        });
+
+    std::vector<std::thread> writers;
+    for (int w = 0; w < 2; ++w)
+        writers.emplace_back([&] {
+            for (uint64_t i = 0; i < writes / 2; ++i) {
+                std::unique_lock<br_lock> lock(l);
+                ++x;
+                ++y;
+            }
+        });
+    for (auto &t : writers)
+        t.join();
+    done.store(true);
+    for (auto &t : threads)
+        t.join();
+
+    check(x == writes / 2 * 2 && x == y, "br_lock: lost update");
+    check(l.try_lock(), "br_lock: try_lock on a free lock");
+    check(!l.try_lock_shared(), "br_lock: try_lock_shared while write locked");
+    l.unlock();
+    check(l.try_lock_shared(), "br_lock: try_lock_shared on a free lock");
+    check(!l.try_lock(), "br_lock: try_lock while read locked");
+    l.unlock_shared();
+    std::cout << "br_lock: ok" << std::endl;
+}
+
+void sharded_counter_test(size_t adders, uint64_t adds)
+{
+    sharded_counter c;
+    std::atomic<bool> done {false};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < adders; ++i)
+        threads.emplace_back([&] {
+            for (uint64_t k = 0; k < adds; ++k)
+                c.add(1);
+        });
+    std::thread reader([&] {
+        int64_t last = 0;
+        while (!done.load()) {
+            int64_t v = c.get();
+            check(v >= last, "sharded_counter: went back");
+            last = v;
+        }
+    });
+    for (auto &t : threads)
+        t.join();
+    done.store(true);
+    reader.join();
+
+    check(c.get() == int64_t(adders * adds), "sharded_counter: sum");
+    c.reset();
+    check(c.get() == 0, "sharded_counter: reset");
+    std::cout << "sharded_counter: ok" << std::endl;
+}
+
+auto main(int argc, char **argv) -> int
+{
+  size_t readers = argc > 1 ? std::stoul(argv[1]) : 3;
+  uint64_t writes = argc > 2 ? std::stoull(argv[2]) : 200000;
+
+  seqlock_test(readers, writes);
+  br_lock_test(readers, writes);
+  sharded_counter_test(readers + 1, writes);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,184 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <stdexcept>
+#include <cstdlib>
+#include "task_scheduler.hpp"
+
+// tests of work_stealing_deque and task_scheduler:
+//
+//   test_scheduler [workers = one per cpu]
+//
+// the deque must hand every item out exactly once while thieves race the
+// owner, fork-join must compute what the sequential code computes, and a
+// parallel_for must call its body exactly once per index. Failures exit with
+// a message.
+
+static void check(bool ok, const std::string &what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+void deque_stress(size_t thieves, uint64_t items)
+{
+    work_stealing_deque<uint64_t> dq(2);            // starts tiny to test growing
+    std::vector<std::atomic<uint8_t>> seen(items + 1);
+    std::atomic<bool> done {false};
+    std::atomic<uint64_t> stolen {0};
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < thieves; ++i)
+        threads.emplace_back([&] {
+            for (;;) {
+                bool last = done.load();
+                if (auto v = dq.steal()) {
+                    seen[*v].fetch_add(1, std::memory_order_relaxed);
+                    stolen.fetch_add(1, std::memory_order_relaxed);
+                } else if (last && dq.empty()) {
+                    break;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+    // pushes in bursts and takes back part of each burst, like a worker
+    uint64_t next = 1;
+    while (next <= items) {
+        for (int i = 0; i < 100 && next <= items; ++i)
+            dq.push(next++);
+        for (int i = 0; i < 60; ++i)
+            if (auto v = dq.take())
+                seen[*v].fetch_add(1, std::memory_order_relaxed);
+    }
+    while (auto v = dq.take())
+        seen[*v].fetch_add(1, std::memory_order_relaxed);
+    done.store(true);
+    for (auto &t : threads)
+        t.join();
+
+    for (uint64_t i = 1; i <= items; ++i)
+        check(seen[i].load() == 1, "deque: item " + std::to_string(i) + " handed out "
+                                   + std::to_string(seen[i].load()) + " times");
+    std::cout << "deque: " << items << " items, " << stolen.load() << " stolen" << std::endl;
+}
+
+uint64_t fib(task_scheduler &sched, unsigned n)
+{
+    if (n < 20) {
+        uint64_t a = 0, b = 1;
+        for (unsigned i = 0; i < n; ++i) {
+            uint64_t c = a + b;
+            a = b;
+            b = c;
+        }
+        return a;
+    }
+    uint64_t left, right;
+    task_group g(sched);
+    g.spawn([&] { left = fib(sched, n - 1); });
+    right = fib(sched, n - 2);
+    g.sync();
+    return left + right;
+}
+
+void fork_join(task_scheduler &sched)
+{
+    check(fib(sched, 40) == 102334155, "fork join: fib(40)");
+
+    task_group g(sched);
+    std::atomic<int> ran {0};
+    for (int i = 0; i < 100; ++i)
+        g.spawn([&ran, i] {
+            ran.fetch_add(1);
+            if (i == 42)
+                throw std::runtime_error("task 42");
+        });
+    bool caught = false;
+    try {
+        g.sync();
+    } catch (const std::runtime_error &e) {
+        caught = std::string(e.what()) == "task 42";
+    }
+    check(caught, "fork join: exception not rethrown by sync");
+    check(ran.load() == 100, "fork join: a task was skipped");
+    g.sync();                                       // the exception is gone
+    std::cout << "fork join: ok" << std::endl;
+}
+
+void loops(task_scheduler &sched)
+{
+    for (size_t n : { 0, 1, 7, 1000, 1000003 }) {
+        for (size_t grain : { 0, 1, 1000 }) {
+            std::vector<int> hits(n);
+            sched.parallel_for(0, n, [&](size_t i) { ++hits[i]; }, grain);
+            for (size_t i = 0; i < n; ++i)
+                check(hits[i] == 1, "parallel_for: n " + std::to_string(n) + " grain "
+                                    + std::to_string(grain) + " index " + std::to_string(i));
+        }
+    }
+
+    // nested loops, from several threads that are not workers at once
+    const size_t rows = 300, cols = 1000;
+    std::vector<std::thread> clients;
+    std::vector<std::vector<int>> results(4, std::vector<int>(rows * cols));
+    for (size_t c = 0; c < results.size(); ++c)
+        clients.emplace_back([&, c] {
+            sched.parallel_for(0, rows, [&](size_t r) {
+                sched.parallel_for(0, cols, [&](size_t j) { results[c][r * cols + j] += int(c + 1); });
+            });
+        });
+    for (auto &t : clients)
+        t.join();
+    for (size_t c = 0; c < results.size(); ++c)
+        for (int v : results[c])
+            check(v == int(c + 1), "parallel_for: nested loop");
+    std::cout << "parallel_for: ok" << std::endl;
+}
+
+// uneven work per index, where a static split would leave threads waiting
+void timing(task_scheduler &sched)
+{
+    using clock = std::chrono::steady_clock;
+    const size_t n = 20000;
+    auto body = [](size_t i) {
+        double s = 0;
+        for (size_t k = 0; k < i / 4; ++k)
+            s += std::sqrt(double(k));
+        return s;
+    };
+
+    std::vector<double> seq(n), par(n);
+    auto t0 = clock::now();
+    for (size_t i = 0; i < n; ++i)
+        seq[i] = body(i);
+    auto t1 = clock::now();
+    sched.parallel_for(0, n, [&](size_t i) { par[i] = body(i); });
+    auto t2 = clock::now();
+
+    check(seq == par, "timing: results differ");
+    std::chrono::duration<double, std::milli> ts = t1 - t0, tp = t2 - t1;
+    std::cout << "triangular loop: sequential " << ts.count() << " ms, "
+              << sched.size() << " workers " << tp.count() << " ms" << std::endl;
+}
+
+auto main(int argc, char **argv) -> int
+{
+  size_t workers = argc > 1 ? std::stoul(argv[1]) : 0;
+
+  deque_stress(3, 1000000);
+
+  task_scheduler sched(workers);
+  fork_join(sched);
+  loops(sched);
+  timing(sched);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,105 @@
+#include <iostream>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <string>
+#include <cstdlib>
+#include "spinlocks.hpp"
+
+// tests of the locks of spinlocks.hpp:
+//
+//   test_spinlocks [threads = 4] [iterations per thread = 50000]
+//
+// threads increment plain counters under the lock, so a lost update means
+// two owners at once. Failures exit with a message.
+
+static void check(bool ok, const std::string &what)
+{
+    if (!ok) {
+        std::cerr << "FAILED: " << what << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+}
+
+template <typename Lock>
+void mutual_exclusion(const std::string &name, size_t nthr, uint64_t iterations)
+{
+    Lock l;
+    uint64_t counter = 0;
+    uint64_t tried = 0;                 // taken with try_lock
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < nthr; ++i)
+        threads.emplace_back([&, i] {
+            for (uint64_t k = 0; k < iterations; ++k) {
+                if (i % 2 == 1 && k % 8 == 0) {
+                    while (!l.try_lock())
+                        std::this_thread::yield();
+                    ++tried;
+                    ++counter;
+                    l.unlock();
+                } else {
+                    std::lock_guard<Lock> guard(l);
+                    ++counter;
+                }
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+
+    check(counter == nthr * iterations, name + ": lost updates, " + std::to_string(counter)
+                                        + " of " + std::to_string(nthr * iterations));
+    check(l.try_lock(), name + ": try_lock on a free lock");
+    Lock other;
+    check(other.try_lock(), name + ": try_lock on a new lock");
+    check(!l.try_lock(), name + ": try_lock on a held lock");
+    l.unlock();
+    other.unlock();
+    std::cout << name << ": ok, " << tried << " times with try_lock" << std::endl;
+}
+
+// two locks of a kind taken together and released out of order
+template <typename Lock>
+void nesting(const std::string &name, size_t nthr, uint64_t iterations)
+{
+    Lock a, b;
+    uint64_t x = 0, y = 0;
+    std::vector<std::thread> threads;
+
+    for (size_t i = 0; i < nthr; ++i)
+        threads.emplace_back([&] {
+            for (uint64_t k = 0; k < iterations; ++k) {
+                std::unique_lock<Lock> la(a, std::defer_lock), lb(b, std::defer_lock);
+                std::lock(la, lb);
+                ++x;
+                la.unlock();
+                ++y;
+            }
+        });
+    for (auto &t : threads)
+        t.join();
+
+    check(x == nthr * iterations && y == x, name + ": nested locks");
+}
+
+template <typename Lock>
+void run(const std::string &name, size_t nthr, uint64_t iterations)
+{
+    mutual_exclusion<Lock>(name, nthr, iterations);
+    nesting<Lock>(name, nthr, iterations / 10);
+}
+
+auto main(int argc, char **argv) -> int
+{
+  size_t nthr = argc > 1 ? std::stoul(argv[1]) : 4;
+  uint64_t iterations = argc > 2 ? std::stoull(argv[2]) : 50000;
+
+  run<tas_lock>("tas_lock", nthr, iterations);
+  run<ttas_lock>("ttas_lock", nthr, iterations);
+  run<ticket_lock>("ticket_lock", nthr, iterations);
+  run<mcs_lock>("mcs_lock", nthr, iterations);
+  run<clh_lock>("clh_lock", nthr, iterations);
+  run<hybrid_lock>("hybrid_lock", nthr, iterations);
+
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,143 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+// Unbounded work-stealing deque (Chase and Lev, with the C11 orderings of
+// Lê, Pop, Cohen and Zappa Nardelli, "Correct and efficient work-stealing
+// for weak memory models").
+//
+// The owner pushes and takes at the bottom like a stack, any other thread
+// steals from the top. Owner operations only need a CAS when they race for
+// the last item. The ring grows when full; the old ring may still be read by
+// a thief, so it is kept until the deque goes away instead of being freed,
+// which costs at most as much memory again as the largest ring.
+template <typename T>
+class work_stealing_deque
+{
+    static_assert(std::is_trivially_copyable<T>::value,
+                  "work_stealing_deque holds trivially copyable items, e.g. pointers");
+
+private:
+
+    struct ring {
+        int64_t mask;
+        std::unique_ptr<std::atomic<T>[]> items;
+
+        explicit ring(int64_t n) : mask(n - 1), items(new std::atomic<T>[n]) {}
+
+        int64_t size() const { return mask + 1; }
+
+        T get(int64_t i) const { return items[i & mask].load(std::memory_order_relaxed); }
+
+        void put(int64_t i, T v) { items[i & mask].store(v, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> top {0};
+
+    alignas(64) std::atomic<int64_t> bottom {0};
+    std::atomic<ring *> items;
+    std::vector<std::unique_ptr<ring>> rings;   // owner only, the current one last
+
+    ring *grow(ring *old, int64_t b, int64_t t)
+    {
+        rings.emplace_back(new ring(2 * old->size()));
+        ring *r = rings.back().get();
+        for (int64_t i = t; i < b; ++i)
+            r->put(i, old->get(i));
+        items.store(r, std::memory_order_release);
+        return r;
+    }
+
+public:
+
+    // `capacity` is rounded up to a power of two
+    explicit work_stealing_deque (size_t capacity = 256)
+    {
+        if (capacity < 2)
+            throw std::invalid_argument("work_stealing_deque: capacity should be at least 2");
+        int64_t n = 1;
+        while (n < int64_t(capacity))
+            n <<= 1;
+        rings.emplace_back(new ring(n));
+        items.store(rings.back().get(), std::memory_order_relaxed);
+    }
+
+    work_stealing_deque (const work_stealing_deque &) = delete;
+
+    work_stealing_deque &operator=(const work_stealing_deque &) = delete;
+
+    // a snapshot, exact only for the owner while nobody steals
+    size_t size () const
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_relaxed);
+        return b > t ? size_t(b - t) : 0;
+    }
+
+    bool empty () const { return size() == 0; }
+
+    // owner only
+    void push (T v)
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed);
+        int64_t t = top.load(std::memory_order_acquire);
+        ring *r = items.load(std::memory_order_relaxed);
+        if (b - t > r->mask)
+            r = grow(r, b, t);
+        r->put(b, v);
+        // a release store rather than the paper's release fence and relaxed
+        // store: the same on x86 and arm64, and visible to thread sanitizers
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    // owner only, the most recently pushed item
+    std::optional<T> take ()
+    {
+        int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+        ring *r = items.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t t = top.load(std::memory_order_relaxed);
+
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        T v = r->get(b);
+        if (t == b) {
+            // the last item, a thief may be after it too
+            bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                                   std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won)
+                return std::nullopt;
+        }
+        return v;
+    }
+
+    // any thread, the oldest item; empty if there is none or another thread
+    // got it first
+    std::optional<T> steal ()
+    {
+        int64_t t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        int64_t b = bottom.load(std::memory_order_acquire);
+        if (t >= b)
+            return std::nullopt;
+
+        // consume in the paper, acquire is what compilers give for it anyway
+        ring *r = items.load(std::memory_order_acquire);
+        T v = r->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst,
+                                         std::memory_order_relaxed))
+            return std::nullopt;
+        return v;
+    }
+};
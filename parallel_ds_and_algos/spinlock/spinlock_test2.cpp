@@ -1,65 +1,298 @@
-#include <cassert>
+#include <algorithm>
 #include <atomic>
+#include <chrono>
+#include <cstdio>
 #include <cstdlib>
+#include <functional>
 #include <iostream>
-#include <vector>
+#include <mutex>
+#include <sstream>
+#include <string>
 #include <thread>
-#include <cinttypes>
+#include <vector>
+#include <getopt.h>
+#include <pthread.h>
+#include <sched.h>
+#include "../parallel_ds/spinlocks.hpp"
+#include "../parallel_ds/perf_counters.hpp"
 
-class SpinLock {
-    std::atomic_flag locked = ATOMIC_FLAG_INIT;
+// Lock throughput benchmark.
+//
+// Every thread runs `pairs` lock/unlock pairs; inside the critical section it
+// increments `lines` counters, outside it may spin `think` pauses. The
+// counters are
+//
+//   shared   - one array, eight counters per cache line
+//   padded   - one array, one counter per cache line
+//   private  - per thread (the lock's own cache line is all that moves)
+//
+//   spinlock_test2 --threads 1,2,4,8 --pairs 1000000 --data padded --lines 4 --pin
+//   spinlock_test2 --locks tas_lock,mcs_lock --think 100 --csv
+//
+// Reported are the wall time per pair over all threads, Jain's fairness index
+// of the per-thread rates, and cycles and cache misses per pair from
+// perf_event_open, "-" where the counters are not available.
+
+constexpr size_t CACHE_LINE = 64;
 
-public:
-    void lock() {
-        while (locked.test_and_set(std::memory_order_acquire))
-            ;
+struct alignas(CACHE_LINE) padded_counter { uint64_t value = 0; };
+
+enum class data_layout { shared, padded, private_ };
+
+struct options
+{
+    std::vector<std::string> locks;
+    std::vector<size_t> threads { 1, 2, 4, 8 };
+    uint64_t pairs = 1'000'000;     // per thread
+    size_t lines = 1;
+    data_layout data = data_layout::padded;
+    unsigned think = 0;
+    bool pin = false;
+    bool csv = false;
+};
+
+struct result
+{
+    std::string lock;
+    size_t threads;
+    double ns_per_pair;
+    double fairness;
+    double cycles, misses, l1d_misses;  // per pair, negative if unavailable
+};
+
+void pin_to_cpu(std::thread &t, size_t i)
+{
+  unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
+  cpu_set_t set;
+  CPU_ZERO(&set);
+  CPU_SET(i % ncpu, &set);
+  pthread_setaffinity_np(t.native_handle(), sizeof(set), &set);
+}
+
+template <typename Lock>
+result run(const std::string &name, const options &opt, size_t nthr)
+{
+  using clock = std::chrono::steady_clock;
+
+  struct alignas(CACHE_LINE) thread_result {
+    double secs = 0;
+    uint64_t counters[perf_counters::count] = {};
+  };
+
+  Lock lock;
+  std::vector<uint64_t> shared(opt.lines);
+  std::vector<padded_counter> padded(opt.lines);
+  std::vector<thread_result> results(nthr);
+  std::atomic<size_t> ready {0};
+  std::atomic<bool> go {false};
+  std::vector<std::thread> threads;
+
+  for (size_t i = 0; i < nthr; ++i) {
+    threads.emplace_back([&, i] {
+      std::vector<padded_counter> mine(opt.lines);
+      uint64_t *base;
+      size_t stride;
+      switch (opt.data) {
+      case data_layout::shared:   base = shared.data(); stride = 1; break;
+      case data_layout::padded:   base = &padded[0].value; stride = CACHE_LINE / sizeof(uint64_t); break;
+      default:                    base = &mine[0].value; stride = CACHE_LINE / sizeof(uint64_t); break;
+      }
+      perf_counters pc;
+
+      ready.fetch_add(1);
+      while (!go.load(std::memory_order_acquire))
+        std::this_thread::yield();
+
+      pc.start();
+      auto t0 = clock::now();
+      for (uint64_t n = 0; n < opt.pairs; ++n) {
+        lock.lock();
+        for (size_t j = 0; j < opt.lines; ++j)
+          ++base[j * stride];
+        lock.unlock();
+        for (unsigned k = 0; k < opt.think; ++k)
+          cpu_relax();
+      }
+      auto t1 = clock::now();
+      pc.stop();
+
+      thread_result &r = results[i];
+      r.secs = std::chrono::duration<double>(t1 - t0).count();
+      for (int e = 0; e < perf_counters::count; ++e)
+        r.counters[e] = pc.value(perf_counters::event(e));
+    });
+    if (opt.pin)
+      pin_to_cpu(threads.back(), i);
+  }
+
+  while (ready.load() != nthr)
+    std::this_thread::yield();
+  auto start = clock::now();
+  go.store(true, std::memory_order_release);
+  for (auto &t : threads)
+    t.join();
+  double secs = std::chrono::duration<double>(clock::now() - start).count();
+
+  // a lost update means the lock let two threads in
+  uint64_t expected = nthr * opt.pairs;
+  for (size_t j = 0; j < opt.lines; ++j) {
+    uint64_t got = opt.data == data_layout::shared ? shared[j]
+                 : opt.data == data_layout::padded ? padded[j].value : expected;
+    if (got != expected) {
+      std::cerr << name << ": counter " << j << " is " << got << ", expected " << expected << std::endl;
+      std::exit(EXIT_FAILURE);
     }
-    void unlock() {
-        locked.clear(std::memory_order_release);
+  }
+
+  double total = double(nthr) * opt.pairs;
+  result res { name, nthr, secs * 1e9 / total, 1., -1., -1., -1. };
+
+  double sum = 0, sq = 0;
+  for (auto &r : results) {
+    double rate = opt.pairs / r.secs;
+    sum += rate;
+    sq += rate * rate;
+  }
+  res.fairness = sum * sum / (nthr * sq);
+
+  double *per_pair[perf_counters::count] = { &res.cycles, nullptr, &res.misses, &res.l1d_misses };
+  for (int e = 0; e < perf_counters::count; ++e) {
+    if (!per_pair[e])
+      continue;
+    uint64_t s = 0;
+    bool ok = true;
+    for (auto &r : results) {
+      ok = ok && r.counters[e] != perf_counters::unavailable;
+      s += r.counters[e];
     }
-};
+    if (ok)
+      *per_pair[e] = s / total;
+  }
+  return res;
+}
 
-// Number of total lock/unlock pair.
-constexpr size_t N_PAIR = 16'000'000;
+void print_header(bool csv)
+{
+  if (csv)
+    std::printf("lock,threads,ns_per_pair,fairness,cycles_per_pair,misses_per_pair,l1d_misses_per_pair\n");
+  else
+    std::printf("%-12s %7s %10s %7s %10s %10s %10s\n",
+                "lock", "threads", "ns/pair", "jain", "cycles", "misses", "L1d miss");
+}
 
-constexpr size_t NCOUNTER = 1;
-constexpr size_t CACHE_LINE = 64;
+void print_result(const result &r, bool csv)
+{
+  auto counter = [csv](double v) {
+    char buf[32];
+    if (v < 0)
+      std::snprintf(buf, sizeof(buf), csv ? "" : "-");
+    else
+      std::snprintf(buf, sizeof(buf), "%.2f", v);
+    return std::string(buf);
+  };
+  if (csv)
+    std::printf("%s,%zu,%.2f,%.4f,%s,%s,%s\n", r.lock.c_str(), r.threads, r.ns_per_pair, r.fairness,
+                counter(r.cycles).c_str(), counter(r.misses).c_str(), counter(r.l1d_misses).c_str());
+  else
+    std::printf("%-12s %7zu %10.2f %7.3f %10s %10s %10s\n", r.lock.c_str(), r.threads, r.ns_per_pair,
+                r.fairness, counter(r.cycles).c_str(), counter(r.misses).c_str(),
+                counter(r.l1d_misses).c_str());
+  std::fflush(stdout);
+}
 
-static __thread int8_t counter[CACHE_LINE*NCOUNTER];
+using lock_bench = std::function<result(const options &, size_t)>;
 
-static size_t nthr = 0;
+std::vector<std::pair<std::string, lock_bench>> all_locks()
+{
+  return {
+    { "mutex",       [](const options &o, size_t n) { return run<std::mutex>("mutex", o, n); } },
+    { "tas_lock",    [](const options &o, size_t n) { return run<tas_lock>("tas_lock", o, n); } },
+    { "ttas_lock",   [](const options &o, size_t n) { return run<ttas_lock>("ttas_lock", o, n); } },
+    { "ticket_lock", [](const options &o, size_t n) { return run<ticket_lock>("ticket_lock", o, n); } },
+    { "mcs_lock",    [](const options &o, size_t n) { return run<mcs_lock>("mcs_lock", o, n); } },
+    { "clh_lock",    [](const options &o, size_t n) { return run<clh_lock>("clh_lock", o, n); } },
+    { "hybrid_lock", [](const options &o, size_t n) { return run<hybrid_lock>("hybrid_lock", o, n); } },
+  };
+}
 
-static SpinLock spin;
+std::vector<std::string> split(const std::string &s)
+{
+  std::vector<std::string> parts;
+  std::stringstream ss(s);
+  std::string item;
+  while (std::getline(ss, item, ','))
+    if (!item.empty())
+      parts.push_back(item);
+  return parts;
+}
 
-void inc_thread(size_t id)
+void usage(const char *prog)
 {
-  size_t n = N_PAIR / nthr;
-  assert(n * nthr == N_PAIR);
-  std::cout << "thread " << id << " launched" << std::endl;
-
-  spin.lock();
-  for (size_t j = 0; j < NCOUNTER; ++j)
-    ++counter[j*CACHE_LINE];
-  spin.unlock();
+  std::cout << "usage: " << prog << " [options]\n"
+            << "  --locks a,b        default all of:";
+  for (auto &l : all_locks())
+    std::cout << " " << l.first;
+  std::cout << "\n"
+            << "  --threads 1,2,4,8  thread counts to run\n"
+            << "  --pairs 1000000    lock/unlock pairs per thread\n"
+            << "  --lines 1          counters incremented while holding the lock\n"
+            << "  --data padded      or shared, private\n"
+            << "  --think 0          pauses between unlock and the next lock\n"
+            << "  --pin              pin thread i to cpu i\n"
+            << "  --csv              csv instead of a table\n";
 }
 
 int main(int argc, char **argv)
 {
-  if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " <num of threads>\n";
-    return EXIT_FAILURE;
-  }
+  options opt;
 
-  std::vector<std::thread> threads;
-  nthr = std::atoi(argv[1]);
-  threads.resize(nthr);
+  static const option longopts[] = {
+    { "locks",   required_argument, nullptr, 'l' },
+    { "threads", required_argument, nullptr, 't' },
+    { "pairs",   required_argument, nullptr, 'n' },
+    { "lines",   required_argument, nullptr, 'L' },
+    { "data",    required_argument, nullptr, 'd' },
+    { "think",   required_argument, nullptr, 'T' },
+    { "pin",     no_argument,       nullptr, 'P' },
+    { "csv",     no_argument,       nullptr, 'c' },
+    { "help",    no_argument,       nullptr, 'h' },
+    { nullptr, 0, nullptr, 0 },
+  };
 
-  for (size_t i = 0; i < nthr; ++i) {
-    threads[i] = std::thread(inc_thread, i);
+  int c;
+  while ((c = getopt_long(argc, argv, "", longopts, nullptr)) != -1) {
+    switch (c) {
+    case 'l': opt.locks = split(optarg); break;
+    case 't':
+      opt.threads.clear();
+      for (auto &t : split(optarg))
+        opt.threads.push_back(std::max(1ul, std::stoul(t)));
+      break;
+    case 'n': opt.pairs = std::max(1ull, std::stoull(optarg)); break;
+    case 'L': opt.lines = std::max(1ul, std::stoul(optarg)); break;
+    case 'd':
+      if (std::string(optarg) == "shared")
+        opt.data = data_layout::shared;
+      else if (std::string(optarg) == "private")
+        opt.data = data_layout::private_;
+      else
+        opt.data = data_layout::padded;
+      break;
+    case 'T': opt.think = std::stoul(optarg); break;
+    case 'P': opt.pin = true; break;
+    case 'c': opt.csv = true; break;
+    default:
+      usage(argv[0]);
+      return c == 'h' ? EXIT_SUCCESS : EXIT_FAILURE;
+    }
   }
 
-  for (size_t i = 0; i < nthr; ++i) {
-    threads[i].join();
+  print_header(opt.csv);
+  for (auto &l : all_locks()) {
+    if (!opt.locks.empty() && std::find(opt.locks.begin(), opt.locks.end(), l.first) == opt.locks.end())
+      continue;
+    for (size_t nthr : opt.threads)
+      print_result(l.second(opt, nthr), opt.csv);
   }
 
   return EXIT_SUCCESS;
@@ -0,0 +1,276 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <new>
+#include <thread>
+#include <utility>
+#include <stdexcept>
+#include <type_traits>
+
+/// bounded lock-free multi-producer/multi-consumer ring
+/// after [Dmitry Vyukov's bounded MPMC queue](http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue)
+///
+/// every cell carries a sequence number telling whether it is ready
+/// to be written (`seq == pos`) or to be read (`seq == pos + 1`),
+/// so producers and consumers only contend on their own position counter
+template <typename T>
+class MPMCBoundedQueue
+{
+public:
+
+  /// `capacity` is rounded up to a power of two
+  explicit MPMCBoundedQueue(size_t capacity)
+    : mask_(roundUpPow2(capacity) - 1),
+      cells_(new Cell[mask_ + 1])
+  {
+    for (size_t i = 0; i <= mask_; ++i)
+      cells_[i].sequence.store(i, std::memory_order_relaxed);
+    enqueue_pos_.store(0, std::memory_order_relaxed);
+    dequeue_pos_.store(0, std::memory_order_relaxed);
+  }
+
+  ~MPMCBoundedQueue()
+  {
+    size_t end = enqueue_pos_.load(std::memory_order_relaxed);
+    for (size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos)
+      reinterpret_cast<T*>(&cells_[pos & mask_].storage)->~T();
+  }
+
+  MPMCBoundedQueue(const MPMCBoundedQueue&) = delete;
+  MPMCBoundedQueue& operator=(const MPMCBoundedQueue&) = delete;
+
+  /// @return false if the queue is full, `item` is left untouched then
+  template <typename U>
+  bool tryPush(U&& item)
+  {
+    Cell* cell;
+    size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)pos;
+      if (dif == 0)
+      {
+        if (enqueue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (dif < 0)
+      {
+        return false; // full
+      }
+      else
+      {
+        pos = enqueue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    new (&cell->storage) T(std::forward<U>(item));
+    cell->sequence.store(pos + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// @return false if the queue is empty
+  bool tryPop(T& item)
+  {
+    Cell* cell;
+    size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      cell = &cells_[pos & mask_];
+      size_t seq = cell->sequence.load(std::memory_order_acquire);
+      intptr_t dif = (intptr_t)seq - (intptr_t)(pos + 1);
+      if (dif == 0)
+      {
+        if (dequeue_pos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (dif < 0)
+      {
+        return false; // empty
+      }
+      else
+      {
+        pos = dequeue_pos_.load(std::memory_order_relaxed);
+      }
+    }
+    T* slot = reinterpret_cast<T*>(&cell->storage);
+    item = std::move(*slot);
+    slot->~T();
+    cell->sequence.store(pos + mask_ + 1, std::memory_order_release);
+    return true;
+  }
+
+  /// a snapshot, exact only when the queue is quiescent
+  bool empty() const
+  {
+    return dequeue_pos_.load(std::memory_order_acquire)
+        == enqueue_pos_.load(std::memory_order_acquire);
+  }
+
+  size_t capacity() const { return mask_ + 1; }
+
+private:
+
+  static size_t roundUpPow2(size_t n)
+  {
+    if (n < 2)
+      throw std::invalid_argument("queue capacity should be at least 2");
+    size_t p = 1;
+    while (p < n)
+      p <<= 1;
+    return p;
+  }
+
+  constexpr static size_t CACHE_LINE = 64;
+
+  struct Cell
+  {
+    std::atomic<size_t> sequence;
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+  };
+
+// data members
+private:
+
+  const size_t mask_;
+  std::unique_ptr<Cell[]> cells_;
+
+  // producers and consumers should not share a cache line
+  alignas(CACHE_LINE) std::atomic<size_t> enqueue_pos_;
+  alignas(CACHE_LINE) std::atomic<size_t> dequeue_pos_;
+};
+
+/// blocking facade over `MPMCBoundedQueue`
+///
+/// the fast path never touches the mutex; a thread sleeps only when the
+/// queue is empty (consumer) or full (producer), and the other side
+/// notifies only if somebody is actually asleep
+template <typename T>
+class BlockingQueue
+{
+public:
+
+  explicit BlockingQueue(size_t capacity)
+    : queue_(capacity)
+  {}
+
+  void push(T item)
+  {
+    if (!spinPush(item))
+    {
+      std::unique_lock<std::mutex> locker(mu_);
+      waiting_producers_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      not_full_.wait(locker, [&] { return queue_.tryPush(std::move(item)); });
+      waiting_producers_.fetch_sub(1);
+    }
+    wake(waiting_consumers_, not_empty_);
+  }
+
+  T pop()
+  {
+    T item;
+    if (!spinPop(item))
+    {
+      std::unique_lock<std::mutex> locker(mu_);
+      waiting_consumers_.fetch_add(1);
+      std::atomic_thread_fence(std::memory_order_seq_cst);
+      not_empty_.wait(locker, [&] { return queue_.tryPop(item); });
+      waiting_consumers_.fetch_sub(1);
+    }
+    wake(waiting_producers_, not_full_);
+    return item;
+  }
+
+  bool tryPush(T item)
+  {
+    if (!queue_.tryPush(std::move(item)))
+      return false;
+    wake(waiting_consumers_, not_empty_);
+    return true;
+  }
+
+  bool tryPop(T& item)
+  {
+    if (!queue_.tryPop(item))
+      return false;
+    wake(waiting_producers_, not_full_);
+    return true;
+  }
+
+  bool empty() const { return queue_.empty(); }
+
+private:
+
+  /// a full or empty queue is often a transient state,
+  /// so retry for a while before paying for a sleep and a wake up
+  constexpr static int SPIN_COUNT = 128;
+
+  bool spinPush(T& item)
+  {
+    for (int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if (queue_.tryPush(std::move(item)))
+        return true;
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+  bool spinPop(T& item)
+  {
+    for (int i = 0; i < SPIN_COUNT; ++i)
+    {
+      if (queue_.tryPop(item))
+        return true;
+      std::this_thread::yield();
+    }
+    return false;
+  }
+
+  void wake(std::atomic<int>& waiters, std::condition_variable& cond)
+  {
+    // pairs with `fetch_add` of a sleeper: either it sees our item while
+    // evaluating its predicate or we see it waiting
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (waiters.load(std::memory_order_relaxed) > 0)
+    {
+      std::lock_guard<std::mutex> locker(mu_);
+      cond.notify_one();
+    }
+  }
+
+// data members
+private:
+
+  MPMCBoundedQueue<T> queue_;
+
+  std::mutex mu_;
+  std::condition_variable not_empty_, not_full_;
+  std::atomic<int> waiting_producers_{0}, waiting_consumers_{0};
+};
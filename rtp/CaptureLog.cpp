@@ -0,0 +1,170 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <system_error>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "CaptureLog.h"
+
+namespace rtp
+{
+
+namespace
+{
+
+uint64_t nanoseconds(std::chrono::nanoseconds t) { return t.count(); }
+
+uint64_t steadyNow()
+{
+  return nanoseconds(std::chrono::steady_clock::now().time_since_epoch());
+}
+
+std::system_error systemError(const std::string& what)
+{
+  return std::system_error(errno, std::generic_category(), what);
+}
+
+}
+
+constexpr size_t CaptureLog::DEFAULT_CAPACITY;
+
+CaptureLog::CaptureLog(const std::string& path, size_t capacity)
+  : capacity_(captureAlign(std::max(capacity, sizeof(CaptureFileHeader)))),
+    start_(steadyNow()),
+    end_(sizeof(CaptureFileHeader)),
+    dropped_(0),
+    connections_(0)
+{
+  fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+  if (fd_ < 0)
+    throw systemError("can't create " + path);
+
+  // the file is zero filled, so an entry not written yet reads as the end of the log
+  if (::ftruncate(fd_, capacity_) != 0)
+  {
+    auto e = systemError("can't size " + path);
+    ::close(fd_);
+    throw e;
+  }
+
+  void* p = ::mmap(nullptr, capacity_, PROT_READ | PROT_WRITE, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED)
+  {
+    auto e = systemError("can't map " + path);
+    ::close(fd_);
+    throw e;
+  }
+  data_ = static_cast<char*>(p);
+
+  CaptureFileHeader header;
+  std::memcpy(header.magic, CAPTURE_MAGIC, sizeof(header.magic));
+  header.start_ns = nanoseconds(std::chrono::system_clock::now().time_since_epoch());
+  std::memcpy(data_, &header, sizeof(header));
+}
+
+CaptureLog::~CaptureLog()
+{
+  size_t used = size();
+  ::munmap(data_, capacity_);
+  if (::ftruncate(fd_, used) != 0)
+  {
+    // the log stays readable, just not trimmed
+  }
+  ::close(fd_);
+}
+
+bool CaptureLog::record(CaptureDirection direction, uint32_t connection,
+                        const void* head, size_t head_size,
+                        const void* tail, size_t tail_size)
+{
+  size_t size = head_size + tail_size;
+  size_t total = captureAlign(sizeof(CaptureEntry) + size);
+  size_t offset = end_.fetch_add(total, std::memory_order_relaxed);
+  if (offset + total > capacity_)
+  {
+    dropped_.fetch_add(1, std::memory_order_relaxed);
+    return false;
+  }
+
+  char* p = data_ + offset;
+  CaptureEntry entry { steadyNow() - start_, uint32_t(size), connection, direction, 0 };
+  std::memcpy(p + sizeof(entry), head, head_size);
+  if (tail_size)
+    std::memcpy(p + sizeof(entry) + head_size, tail, tail_size);
+  std::memcpy(p, &entry, sizeof(entry));
+  return true;
+}
+
+size_t CaptureLog::size() const
+{
+  return std::min(end_.load(), capacity_);
+}
+
+CaptureReader::CaptureReader(const std::string& path)
+{
+  fd_ = ::open(path.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    throw systemError("can't open " + path);
+
+  struct stat st;
+  if (::fstat(fd_, &st) != 0)
+  {
+    auto e = systemError("can't stat " + path);
+    ::close(fd_);
+    throw e;
+  }
+  size_ = st.st_size;
+  if (size_ < sizeof(CaptureFileHeader))
+  {
+    ::close(fd_);
+    throw std::runtime_error(path + " is not an rtp capture");
+  }
+
+  void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd_, 0);
+  if (p == MAP_FAILED)
+  {
+    auto e = systemError("can't map " + path);
+    ::close(fd_);
+    throw e;
+  }
+  data_ = static_cast<const char*>(p);
+
+  if (std::memcmp(header().magic, CAPTURE_MAGIC, sizeof(CAPTURE_MAGIC)) != 0)
+  {
+    ::munmap(const_cast<char*>(data_), size_);
+    ::close(fd_);
+    throw std::runtime_error(path + " is not an rtp capture");
+  }
+}
+
+CaptureReader::~CaptureReader()
+{
+  ::munmap(const_cast<char*>(data_), size_);
+  ::close(fd_);
+}
+
+}
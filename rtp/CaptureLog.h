@@ -0,0 +1,154 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace rtp
+{
+
+struct CaptureFileHeader
+{
+  char magic[8];
+  uint64_t start_ns;  // system clock at the start of the capture
+};
+
+constexpr char CAPTURE_MAGIC[8] = "RTPCAP1";
+
+enum CaptureDirection : uint32_t
+{
+  CAPTURE_RECEIVED = 1,
+  CAPTURE_SENT = 2,
+};
+
+struct CaptureEntry
+{
+  uint64_t time_ns;     // since the start of the capture
+  uint32_t size;        // raw bytes following the entry
+  uint32_t connection;
+  uint32_t direction;   // `CaptureDirection`
+  uint32_t reserved;
+};
+
+constexpr size_t captureAlign(size_t n) { return (n + 7) & ~size_t(7); }
+
+/// append-only capture of rtp sessions in a memory-mapped file
+///
+/// the file is sized up front and mapped once, recording an entry reserves
+/// its space with one atomic add and copies the bytes in, so any number of
+/// connections capture concurrently without a lock or a syscall. When the
+/// file is full further entries are dropped and counted, see `dropped()`.
+///
+/// layout: `CaptureFileHeader`, then entries of `CaptureEntry` followed by
+/// `size` raw bytes, padded to 8 bytes; an entry of size 0 ends the log
+class CaptureLog
+{
+public:
+
+  constexpr static size_t DEFAULT_CAPACITY = size_t(256) << 20;
+
+  /// creates (or truncates) `path` and maps `capacity` bytes of it,
+  /// throws `std::system_error` on failure
+  explicit CaptureLog(const std::string& path, size_t capacity = DEFAULT_CAPACITY);
+
+  /// trims the file to the recorded entries
+  ~CaptureLog();
+
+  CaptureLog(const CaptureLog&) = delete;
+  CaptureLog& operator=(const CaptureLog&) = delete;
+
+  /// id to tell the connections apart in the log
+  uint32_t newConnection() { return connections_.fetch_add(1) + 1; }
+
+  /// appends one entry made of `head` and `tail` (e.g. a frame header and its body)
+  /// @return false if the log is full and the entry has been dropped
+  bool record(CaptureDirection direction, uint32_t connection,
+              const void* head, size_t head_size,
+              const void* tail = nullptr, size_t tail_size = 0);
+
+  size_t dropped() const { return dropped_.load(); }
+
+  /// bytes taken by the entries so far
+  size_t size() const;
+
+// data members
+private:
+
+  int fd_;
+  char* data_;
+  size_t capacity_;
+  uint64_t start_;  // steady clock, ns
+  std::atomic<size_t> end_;  // where the next entry goes
+  std::atomic<size_t> dropped_;
+  std::atomic<uint32_t> connections_;
+};
+
+/// read-only view of a capture file
+class CaptureReader
+{
+public:
+
+  /// maps `path`, throws `std::system_error` if it can't and
+  /// `std::runtime_error` if it isn't a capture file
+  explicit CaptureReader(const std::string& path);
+
+  ~CaptureReader();
+
+  CaptureReader(const CaptureReader&) = delete;
+  CaptureReader& operator=(const CaptureReader&) = delete;
+
+  const CaptureFileHeader& header() const
+  {
+    return *reinterpret_cast<const CaptureFileHeader*>(data_);
+  }
+
+  /// calls `handler(const CaptureEntry&, const char* bytes)` for every entry in order
+  /// @return number of entries
+  template <typename Handler>
+  size_t forEach(Handler&& handler) const
+  {
+    size_t count = 0;
+    size_t offset = sizeof(CaptureFileHeader);
+    while (offset + sizeof(CaptureEntry) <= size_)
+    {
+      auto entry = reinterpret_cast<const CaptureEntry*>(data_ + offset);
+      size_t next = offset + captureAlign(sizeof(CaptureEntry) + entry->size);
+      if (entry->size == 0 || next > size_)
+        break;
+      handler(*entry, data_ + offset + sizeof(CaptureEntry));
+      offset = next;
+      ++count;
+    }
+    return count;
+  }
+
+// data members
+private:
+
+  int fd_;
+  const char* data_;
+  size_t size_;
+};
+
+}
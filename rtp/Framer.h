@@ -0,0 +1,99 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <vector>
+#include <cstring>
+#include <stdexcept>
+
+#include "RobotProtocol.h"
+
+/// splits a TCP byte stream into `PacketHeader` + body frames
+///
+/// a `receive()` may end in the middle of a frame or carry several of them,
+/// complete frames are handed to the handler straight from the receive buffer,
+/// only an incomplete tail is copied and kept until the next `feed()`
+class Framer
+{
+public:
+
+  constexpr static size_t DEFAULT_MAX_BODY = 4096;
+
+  explicit Framer(size_t max_body = DEFAULT_MAX_BODY)
+    : max_body_(max_body)
+  {}
+
+  /// calls `handler(const rtp::PacketHeader&, const char* body, size_t size)`
+  /// for every complete frame, throws `std::runtime_error` on a malformed header
+  /// @return number of frames handled
+  template <typename Handler>
+  size_t feed(const char* data, size_t size, Handler&& handler)
+  {
+    size_t frames = 0;
+    if (pending_.empty())
+    {
+      size_t used = parse(data, size, handler, frames);
+      pending_.assign(data + used, data + size);
+    }
+    else
+    {
+      pending_.insert(pending_.end(), data, data + size);
+      size_t used = parse(pending_.data(), pending_.size(), handler, frames);
+      pending_.erase(pending_.begin(), pending_.begin() + used);
+    }
+    return frames;
+  }
+
+  /// bytes of an incomplete frame waiting for more data
+  size_t pending() const { return pending_.size(); }
+
+  void reset() { pending_.clear(); }
+
+private:
+
+  template <typename Handler>
+  size_t parse(const char* data, size_t size, Handler& handler, size_t& frames)
+  {
+    size_t offset = 0;
+    while (size - offset >= sizeof(rtp::PacketHeader))
+    {
+      rtp::PacketHeader header;
+      std::memcpy(&header, data + offset, sizeof(header));
+      int32_t len = rtp::bodyLength(header);
+      if (len < 0 || size_t(len) > max_body_)
+        throw std::runtime_error("malformed frame, msg_len: " + std::to_string(header.msg_len));
+      if (size - offset - sizeof(header) < size_t(len))
+        break;
+      handler(header, data + offset + sizeof(header), size_t(len));
+      offset += sizeof(header) + len;
+      ++frames;
+    }
+    return offset;
+  }
+
+// data members
+private:
+
+  size_t max_body_;
+
+  std::vector<char> pending_;
+};
@@ -0,0 +1,134 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include <algorithm>
+#include <stdexcept>
+
+namespace rtp
+{
+
+/// HDR-histogram style latency recorder
+///
+/// values below `2^SUB_BUCKET_BITS` are counted exactly, larger ones fall
+/// into log2 buckets each split into `2^(SUB_BUCKET_BITS-1)` linear
+/// sub-buckets, i.e. the relative error stays under `2^-(SUB_BUCKET_BITS-1)`
+/// over the full `uint64_t` range with constant-time `record()`
+class LatencyHistogram
+{
+public:
+
+  constexpr static unsigned SUB_BUCKET_BITS = 8; // < 1% error
+  constexpr static uint64_t SUB_BUCKET_COUNT = uint64_t(1) << SUB_BUCKET_BITS;
+  constexpr static uint64_t SUB_BUCKET_HALF = SUB_BUCKET_COUNT / 2;
+
+  LatencyHistogram()
+    : counts_(indexOf(UINT64_MAX) + 1, 0)
+  {}
+
+  void record(uint64_t value)
+  {
+    ++counts_[indexOf(value)];
+    ++total_;
+    min_ = std::min(min_, value);
+    max_ = std::max(max_, value);
+    sum_ += value;
+  }
+
+  void merge(const LatencyHistogram& other)
+  {
+    for (size_t i = 0; i < counts_.size(); ++i)
+      counts_[i] += other.counts_[i];
+    total_ += other.total_;
+    min_ = std::min(min_, other.min_);
+    max_ = std::max(max_, other.max_);
+    sum_ += other.sum_;
+  }
+
+  /// @param percentile in [0 .. 100]
+  /// @return the highest value equivalent to the bucket holding the percentile
+  uint64_t valueAt(double percentile) const
+  {
+    if (total_ == 0)
+      return 0;
+    if (percentile < 0. || percentile > 100.)
+      throw std::out_of_range("percentile should be in [0 .. 100]");
+
+    uint64_t rank = std::max<uint64_t>(1, uint64_t(percentile / 100. * total_ + 0.5));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < counts_.size(); ++i)
+    {
+      seen += counts_[i];
+      if (seen >= rank)
+        return std::min(highestEquivalent(i), max_);
+    }
+    return max_;
+  }
+
+  uint64_t count() const { return total_; }
+
+  uint64_t min() const { return total_ ? min_ : 0; }
+
+  uint64_t max() const { return max_; }
+
+  double mean() const { return total_ ? double(sum_) / total_ : 0.; }
+
+  void reset()
+  {
+    std::fill(counts_.begin(), counts_.end(), 0);
+    total_ = sum_ = max_ = 0;
+    min_ = UINT64_MAX;
+  }
+
+private:
+
+  static size_t indexOf(uint64_t value)
+  {
+    if (value < SUB_BUCKET_COUNT)
+      return value;
+    unsigned msb = 63 - __builtin_clzll(value);
+    unsigned shift = msb - (SUB_BUCKET_BITS - 1);
+    return shift * SUB_BUCKET_HALF + (value >> shift);
+  }
+
+  static uint64_t highestEquivalent(size_t index)
+  {
+    if (index < SUB_BUCKET_COUNT)
+      return index;
+    unsigned shift = index / SUB_BUCKET_HALF - 1;
+    uint64_t sub = index - shift * SUB_BUCKET_HALF;
+    return ((sub + 1) << shift) - 1;
+  }
+
+// data members
+private:
+
+  std::vector<uint64_t> counts_;
+  uint64_t total_ = 0;
+  uint64_t sum_ = 0;
+  uint64_t min_ = UINT64_MAX;
+  uint64_t max_ = 0;
+};
+
+} // namespace rtp
@@ -0,0 +1,171 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <vector>
+#include <utility>
+#include <cstring>
+#include <type_traits>
+#include <boost/asio.hpp>
+
+/// per-connection output queue
+///
+/// every frame is a `Header` followed by a body, both are staged here
+/// and `flush()` hands the whole sequence to one gather write, i.e.
+/// a single `sendmsg`/`writev` for up to `max_frames` frames
+template <typename Header>
+class OutputQueue
+{
+public:
+
+  /// boost::asio gathers at most 64 buffers per syscall on POSIX,
+  /// a frame takes two of them (header + body)
+  constexpr static size_t DEFAULT_MAX_FRAMES = 32;
+
+  explicit OutputQueue(size_t max_frames = DEFAULT_MAX_FRAMES)
+    : max_frames_(max_frames)
+  {
+    headers_.reserve(max_frames_);
+    spans_.reserve(max_frames_);
+    buffers_.reserve(2 * max_frames_);
+  }
+
+  OutputQueue(const OutputQueue&) = delete;
+  OutputQueue& operator=(const OutputQueue&) = delete;
+
+  /// stage a frame, the body is copied so it may be a temporary
+  template <typename Body>
+  void enqueue(const Header& header, const Body& body)
+  {
+    static_assert(std::is_trivially_copyable<Body>::value,
+                  "frame body is sent as raw bytes");
+    enqueue(header, &body, sizeof(Body));
+  }
+
+  void enqueue(const Header& header, const void* body, size_t size)
+  {
+    size_t offset = bodies_.size();
+    bodies_.resize(offset + size);
+    std::memcpy(bodies_.data() + offset, body, size);
+    headers_.push_back(header);
+    spans_.emplace_back(offset, size);
+  }
+
+  /// write all staged frames at once, returns number of bytes written
+  template <typename SyncWriteStream>
+  size_t flush(SyncWriteStream& stream)
+  {
+    if (empty())
+      return 0;
+
+    buildBuffers();
+    size_t n = boost::asio::write(stream, buffers_);
+    clear();
+    return n;
+  }
+
+  /// `flush()` for a socket in non-blocking mode: writes what the socket
+  /// takes now and keeps the rest, so a slow reader never blocks the caller
+  /// @return true once everything staged has been written
+  template <typename Socket>
+  bool flushSome(Socket& sock, boost::system::error_code& ec)
+  {
+    ec.clear();
+    while (!empty())
+    {
+      buildBuffers();
+      size_t n = sock.write_some(buffers_, ec);
+      if (ec)
+      {
+        if (ec == boost::asio::error::would_block || ec == boost::asio::error::try_again)
+          ec.clear();
+        return false;
+      }
+      written_ += n;
+      if (written_ == bytes())
+        clear();
+    }
+    return true;
+  }
+
+  void clear()
+  {
+    headers_.clear();
+    spans_.clear();
+    bodies_.clear();
+    written_ = 0;
+  }
+
+  /// staged bytes, headers included
+  size_t bytes() const { return headers_.size() * sizeof(Header) + bodies_.size(); }
+
+  /// staged bytes not written yet
+  size_t pending() const { return bytes() - written_; }
+
+  bool empty() const { return headers_.empty(); }
+
+  bool full() const { return headers_.size() >= max_frames_; }
+
+  size_t size() const { return headers_.size(); }
+
+private:
+
+  /// buffers are built only now as `bodies_` may reallocate while staging,
+  /// the part already written by `flushSome()` is skipped
+  void buildBuffers()
+  {
+    buffers_.clear();
+    size_t skip = written_;
+    auto add = [this, &skip](const void* data, size_t size)
+    {
+      if (skip >= size)
+      {
+        skip -= size;
+        return;
+      }
+      buffers_.emplace_back(static_cast<const char*>(data) + skip, size - skip);
+      skip = 0;
+    };
+    for (size_t i = 0; i < headers_.size(); ++i)
+    {
+      add(&headers_[i], sizeof(Header));
+      add(bodies_.data() + spans_[i].first, spans_[i].second);
+    }
+  }
+
+// data members
+private:
+
+  size_t max_frames_;
+
+  std::vector<Header> headers_;
+
+  std::vector<char> bodies_;
+
+  /// (offset, size) of every body in `bodies_`
+  std::vector<std::pair<size_t, size_t>> spans_;
+
+  std::vector<boost::asio::const_buffer> buffers_;
+
+  /// bytes already handed to the socket by `flushSome()`
+  size_t written_ = 0;
+};
@@ -0,0 +1,132 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <cstdint>
+
+/// wire format of the robot connector protocol,
+/// kept free of ROS so that tools and tests can use it standalone
+namespace rtp
+{
+
+struct __attribute__((__packed__)) PacketHeader
+{
+  int32_t msg_len;
+  int32_t msg_type;   // identifies type of message (standard and robot specific values)
+  int32_t comm_type;
+  int32_t reply_code; // only valid in service replies
+};
+
+/// `msg_len` counts everything after itself
+template <typename Body>
+constexpr int32_t messageLength()
+{
+  return sizeof(Body) + sizeof(PacketHeader) - sizeof(int32_t);
+}
+
+/// the rest of the frame once `PacketHeader` has been read
+constexpr int32_t bodyLength(const PacketHeader& header)
+{
+  return header.msg_len + sizeof(int32_t) - sizeof(PacketHeader);
+}
+
+/// message type ids, the standard simple_message ones are fixed,
+/// the robot specific ones are supplied by the robot connector
+/// (see RosAdapter.h) or by the command line of the standalone simulator
+struct MsgTypes
+{
+  int32_t joint_traj_pt  = 11; // simple_message JOINT_TRAJ_PT
+  int32_t status         = 13; // simple_message STATUS
+  int32_t task           = 1001;
+  int32_t joint_responce = 1002;
+  int32_t task_result    = 1003;
+};
+
+/// simple_message communication types
+enum CommType : int32_t
+{
+  TOPIC = 1, SERVICE_REQUEST = 2, SERVICE_REPLY = 3,
+};
+
+/// simple_message reply codes
+enum ReplyType : int32_t
+{
+  REPLY_INVALID = 0, REPLY_SUCCESS = 1, REPLY_FAILURE = 2,
+};
+
+struct __attribute__((__packed__)) TaskMessage
+{
+  int32_t task_id;
+  int32_t error_handler;
+  int32_t count;
+};
+
+constexpr uint32_t MAX_JOINTS = 10;
+
+struct __attribute__((__packed__)) JointResponceMessage // 44 Bytes
+{
+  int32_t sequence_id;
+  float joints[MAX_JOINTS];
+
+  JointResponceMessage(int32_t id)
+    : sequence_id(id), joints{0.f,}
+  {}
+};
+
+struct __attribute__((__packed__)) JointTrajPtMessage
+  : public JointResponceMessage // 56 Bytes
+{
+  float velocity;
+  float duration;
+
+  JointTrajPtMessage(int32_t id = 0)
+    : JointResponceMessage(id)
+  {}
+};
+
+struct __attribute__((__packed__)) TaskResult
+{
+  int32_t task_id;
+  int32_t sequence_id;
+  int32_t error_code;
+};
+
+/// simple_message robot status, all fields are tri-state: -1 unknown, 0 false, 1 true
+/// except for `error_code` and `mode`
+struct __attribute__((__packed__)) RobotStatus // 28 Bytes
+{
+  int32_t drives_powered  = 0;
+  int32_t e_stopped       = 0;
+  int32_t error_code      = 0;
+  int32_t in_error        = 0;
+  int32_t in_motion       = 0;
+  int32_t mode            = 0;
+  int32_t motion_possible = 0;
+};
+
+template <typename Body>
+constexpr PacketHeader replyHeader(int32_t msg_type)
+{
+  return PacketHeader { messageLength<Body>(), msg_type, SERVICE_REPLY, REPLY_SUCCESS };
+}
+
+} // namespace rtp
@@ -0,0 +1,221 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include <iostream>
+#include <thread>
+#include <cstring>
+
+#include "RobotService.h"
+
+using namespace boost::asio;
+
+namespace
+{
+
+// bodies are read into properly aligned copies, the receive buffer has no alignment
+template <typename T>
+bool readBody(const char* body, size_t size, T& msg)
+{
+  if (size < sizeof(T))
+    return false;
+  std::memcpy(&msg, body, sizeof(T));
+  return true;
+}
+
+}
+
+RobotService::RobotService(ServiceType service_type,
+                           const ServiceOptions& options,
+                           std::shared_ptr<CommandQueue> commands)
+  : service_type_(service_type),
+    options_(options),
+    commands_(std::move(commands)),
+    current_task_id_(0),
+    connection_(options_.capture ? options_.capture->newConnection() : 0)
+{}
+
+void RobotService::StartHandling(std::shared_ptr<ip::tcp::socket> sock)
+{
+  sock_ = std::move(sock);
+  // replies are already batched by `out_`, so Nagle only adds latency
+  sock_->set_option(ip::tcp::no_delay(options_.tcp_no_delay));
+  std::thread th([this] { HandleClient(); });
+  th.detach();
+}
+
+void RobotService::attach(std::shared_ptr<ip::tcp::socket> sock)
+{
+  sock_ = std::move(sock);
+  sock_->set_option(ip::tcp::no_delay(options_.tcp_no_delay));
+  sock_->non_blocking(true);
+}
+
+bool RobotService::publishStatus()
+{
+  // a reader that fell behind gets the rest of its previous batch, not a new one
+  if (out_.empty())
+  {
+    stageStatus();
+  }
+
+  boost::system::error_code ec;
+  out_.flushSome(*sock_, ec);
+  if (ec && ec != error::eof && ec != error::broken_pipe && ec != error::connection_reset)
+  {
+    std::cout << "Error occured! Error code = "
+              << ec << ". Message: "
+              << ec.message() << std::endl;
+  }
+  return !ec;
+}
+
+void RobotService::onFrame(const rtp::PacketHeader& header, const char* body, size_t size)
+{
+  const rtp::MsgTypes& types = options_.msg_types;
+
+  if (options_.capture)
+  {
+    options_.capture->record(rtp::CAPTURE_RECEIVED, connection_,
+                             &header, sizeof(header), body, size);
+  }
+
+  if (options_.verbose)
+  {
+    std::cout
+      << "msg_len: " << header.msg_len
+      << " msg_type: " << header.msg_type
+      << " comm_type: " << header.comm_type
+      << " reply_code: " << header.reply_code << std::endl;
+  }
+
+  if (header.msg_type == types.task)
+  {
+    rtp::TaskMessage task_message;
+    if (readBody(body, size, task_message))
+    {
+      if (options_.verbose)
+      {
+        std::cout << "task_id: " << task_message.task_id
+                  << " error_handler: " << task_message.error_handler
+                  << " count: " << task_message.count
+                  << std::endl;
+      }
+
+      current_task_id_.store(task_message.task_id);
+      commands_->push(RobotCommand { task_id : task_message.task_id,
+                                     sequence_id : -1,
+                                     command_type : 0 } );
+    }
+  }
+  else if (header.msg_type == types.joint_traj_pt)
+  {
+    rtp::JointTrajPtMessage joint_traj_pt_msg;
+    if (readBody(body, size, joint_traj_pt_msg))
+    {
+      if (options_.verbose)
+      {
+        std::cout << "joint_traj_pt_msg: sequence_id: " << joint_traj_pt_msg.sequence_id
+                  << " velocity: " << joint_traj_pt_msg.velocity << "\n joints : [ ";
+        for (size_t i = 0; i < rtp::MAX_JOINTS; ++i)
+        {
+          std::cout << joint_traj_pt_msg.joints[i] << " ";
+        }
+        std::cout << "]\n";
+      }
+
+      commands_->push(RobotCommand { task_id : current_task_id_.load(),
+                                     sequence_id : joint_traj_pt_msg.sequence_id,
+                                     command_type : 1 } );
+    }
+  }
+
+  // every request is answered
+  reply(rtp::replyHeader<rtp::JointResponceMessage>(types.joint_responce),
+        rtp::JointResponceMessage(1));
+}
+
+void RobotService::stageStatus()
+{
+  const rtp::MsgTypes& types = options_.msg_types;
+
+  rtp::RobotStatus status;
+  for (size_t i = 0; i < options_.status_per_cycle; ++i)
+  {
+    reply(rtp::replyHeader<rtp::RobotStatus>(types.status), status);
+  }
+
+  // results are no longer paced by a busy loop, so hand over everything pending
+  RobotCommand cmd;
+  while (commands_->tryPop(cmd))
+  {
+    if (cmd.command_type != 0) // TODO for task command, enum instead of constant
+    {
+      auto task_result = rtp::TaskResult { task_id : cmd.task_id, sequence_id : /* cmd.sequence_id */ 0, error_code : 0 };
+      reply(rtp::replyHeader<rtp::TaskResult>(types.task_result), task_result);
+    }
+  }
+}
+
+void RobotService::streamTrajectory()
+{
+  auto handler = [this](const rtp::PacketHeader& header, const char* body, size_t size)
+  {
+    onFrame(header, body, size);
+    if (out_.full())
+    {
+      out_.flush(*sock_);
+    }
+  };
+
+  for (;;)
+  {
+    size_t n = sock_->read_some(buffer(rx_));
+    framer_.feed(rx_.data(), n, handler);
+    // all replies to the requests of one `read_some()` leave together
+    out_.flush(*sock_);
+  }
+}
+
+void RobotService::HandleClient()
+{
+  try
+  {
+    if (service_type_ == TRAJECTORY_STREAMING)
+    {
+      streamTrajectory();
+    }
+  }
+  catch (boost::system::system_error &e)
+  {
+    if (e.code() != error::eof)
+    {
+      std::cout << "Error occured! Error code = "
+                << e.code() << ". Message: "
+                << e.what() << std::endl;
+    }
+  }
+  catch (const std::exception &e)
+  {
+    std::cout << "Error occured! Message: " << e.what() << std::endl;
+  }
+
+  onFinish();
+}
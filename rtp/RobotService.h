@@ -0,0 +1,142 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <boost/asio.hpp>
+
+#include "RobotProtocol.h"
+#include "RobotCommand.h"
+#include "BoundedQueue.h"
+#include "OutputQueue.h"
+#include "Framer.h"
+#include "CaptureLog.h"
+
+/// commands travel from the trajectory streaming service to the robot state service
+using CommandQueue = BlockingQueue<RobotCommand>;
+
+struct ServiceOptions
+{
+  /// set `TCP_NODELAY` on accepted sockets
+  bool tcp_no_delay = false;
+
+  /// dump every received message to `std::cout`
+  bool verbose = false;
+
+  /// status messages sent per cycle of the robot state service
+  size_t status_per_cycle = 1;
+
+  /// robot state service cycles per second on every connection
+  double status_rate = 100.;
+
+  rtp::MsgTypes msg_types;
+
+  /// every received and sent frame is appended here when set, see `rtp_replay`
+  std::shared_ptr<rtp::CaptureLog> capture;
+};
+
+/// serves one robot-connector connection
+class RobotService
+{
+// service type
+public:
+  enum ServiceType
+  {
+    TRAJECTORY_STREAMING, ROBOT_STATE,
+  };
+
+public:
+
+  RobotService(ServiceType service_type,
+               const ServiceOptions& options,
+               std::shared_ptr<CommandQueue> commands);
+
+  /// trajectory streaming: takes over the connection in a detached thread,
+  /// the service deletes itself when it ends
+  void StartHandling(std::shared_ptr<boost::asio::ip::tcp::socket> sock);
+
+  /// robot state: takes over the connection in non-blocking mode,
+  /// cycles are driven by `publishStatus()`, see `StatusPublisher`
+  void attach(std::shared_ptr<boost::asio::ip::tcp::socket> sock);
+
+  /// robot state: one cycle, never blocks
+  /// @return false once the connection is gone
+  bool publishStatus();
+
+  /// trajectory streaming: handle a request and stage the reply
+  void onFrame(const rtp::PacketHeader& header, const char* body, size_t size);
+
+  /// robot state: stage one cycle of status messages and the results of all pending commands
+  void stageStatus();
+
+  /// replies staged until the next flush point
+  OutputQueue<rtp::PacketHeader>& output() { return out_; }
+
+// methods
+private:
+
+  /// the main workforce for communicating with robot-connector
+  void HandleClient();
+
+  void streamTrajectory();
+
+  /// stage a reply, captured on the way out
+  template <typename Body>
+  void reply(const rtp::PacketHeader& header, const Body& body)
+  {
+    out_.enqueue(header, body);
+    if (options_.capture)
+    {
+      options_.capture->record(rtp::CAPTURE_SENT, connection_,
+                               &header, sizeof(header), &body, sizeof(body));
+    }
+  }
+
+  /// cleanup.
+  void onFinish() {
+    delete this;
+  }
+
+// data members
+private:
+
+  std::shared_ptr<boost::asio::ip::tcp::socket> sock_;
+
+  ServiceType service_type_;
+
+  ServiceOptions options_;
+
+  std::shared_ptr<CommandQueue> commands_;
+
+  Framer framer_;
+
+  std::array<char, 4096> rx_;
+
+  OutputQueue<rtp::PacketHeader> out_;
+
+  std::atomic<int32_t> current_task_id_;
+
+  /// tells this connection apart in the capture
+  uint32_t connection_;
+};
@@ -0,0 +1,121 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include <iostream>
+
+#include "RobotSimulatorServer.h"
+
+using namespace boost::asio;
+
+RobotAcceptor::RobotAcceptor(io_service &ios, uint16_t port_num)
+  : ios_(ios),
+    acceptor_(ios_,
+              ip::tcp::endpoint(ip::address_v4::any(),
+                                port_num))
+{
+  acceptor_.listen();
+}
+
+bool RobotAcceptor::Accept(RobotService::ServiceType service_type,
+                           const ServiceOptions& options,
+                           std::shared_ptr<CommandQueue> commands,
+                           StatusPublisher* publisher,
+                           const std::atomic<bool>& stop)
+{
+  auto sock = std::make_shared<ip::tcp::socket>(ios_);
+  acceptor_.accept(*sock.get());
+  if (stop.load())
+    return false;
+  std::unique_ptr<RobotService> service(new RobotService(service_type, options, std::move(commands)));
+  if (service_type == RobotService::ROBOT_STATE)
+  {
+    publisher->add(std::move(service), std::move(sock), options.status_rate);
+  }
+  else
+  {
+    service.release()->StartHandling(sock);
+  }
+  return true;
+}
+
+RobotSimulatorServer::RobotSimulatorServer(const ServiceOptions& options)
+  : stop_(false), options_(options) {}
+
+RobotSimulatorServer::~RobotSimulatorServer()
+{
+  if (thread_)
+    Stop();
+}
+
+void RobotSimulatorServer::Start(uint16_t port_num,
+                                 RobotService::ServiceType service_type,
+                                 std::shared_ptr<CommandQueue> commands,
+                                 std::shared_ptr<StatusPublisher> publisher)
+{
+  commands_ = std::move(commands);
+  publisher_ = std::move(publisher);
+  if (service_type == RobotService::ROBOT_STATE && !publisher_)
+  {
+    publisher_ = std::make_shared<StatusPublisher>();
+  }
+  acceptor_.reset(new RobotAcceptor(ios_, port_num));
+  thread_.reset(new std::thread(
+        [this, service_type]
+        {
+          this->Run(service_type);
+        })
+      );
+}
+
+void RobotSimulatorServer::Stop()
+{
+  stop_.store(true);
+  // `accept()` is blocking, wake it up with a connection of our own
+  try
+  {
+    io_service ios;
+    ip::tcp::socket wakeup(ios);
+    wakeup.connect(ip::tcp::endpoint(ip::address_v4::loopback(), port()));
+  }
+  catch (boost::system::system_error &)
+  {
+    // the acceptor is already gone
+  }
+  thread_->join();
+  thread_.reset();
+}
+
+void RobotSimulatorServer::Run(RobotService::ServiceType service_type)
+{
+  try
+  {
+    while (!stop_.load())
+    {
+      acceptor_->Accept(service_type, options_, commands_, publisher_.get(), stop_);
+    }
+  }
+  catch (boost::system::system_error &e)
+  {
+    std::cout << "Error occured! Error code = "
+              << e.code() << ". Message: "
+              << e.what() << std::endl;
+  }
+}
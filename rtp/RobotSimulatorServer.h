@@ -0,0 +1,95 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <boost/asio.hpp>
+
+#include "RobotService.h"
+#include "StatusPublisher.h"
+
+class RobotAcceptor {
+public:
+
+  RobotAcceptor(boost::asio::io_service &ios, uint16_t port_num);
+
+  /// blocks until a client connects and hands it over to a new `RobotService`,
+  /// robot state connections go to `publisher`
+  /// @return false if the acceptor has been woken up to stop
+  bool Accept(RobotService::ServiceType service_type,
+              const ServiceOptions& options,
+              std::shared_ptr<CommandQueue> commands,
+              StatusPublisher* publisher,
+              const std::atomic<bool>& stop);
+
+  uint16_t port() const { return acceptor_.local_endpoint().port(); }
+
+// data members
+private:
+
+  boost::asio::io_service &ios_;
+  boost::asio::ip::tcp::acceptor acceptor_;
+};
+
+/// accepts robot-connector connections on one port in a background thread
+class RobotSimulatorServer
+{
+public:
+
+  RobotSimulatorServer(const ServiceOptions& options = ServiceOptions());
+
+  ~RobotSimulatorServer();
+
+  /// binds the port right away, so errors surface here,
+  /// `port_num` 0 picks a free port, see `port()`
+  /// @param commands shared by the joints and the state server of one robot
+  /// @param publisher drives the robot state connections, may be shared by several
+  ///        state servers, a state server without one creates its own
+  void Start(uint16_t port_num,
+             RobotService::ServiceType service_type,
+             std::shared_ptr<CommandQueue> commands,
+             std::shared_ptr<StatusPublisher> publisher = nullptr);
+
+  /// stops accepting new connections, the established ones are served to the end
+  void Stop();
+
+  uint16_t port() const { return acceptor_->port(); }
+
+// methods
+private:
+  void Run(RobotService::ServiceType service_type);
+
+// data members
+private:
+
+  std::unique_ptr<std::thread> thread_;
+  std::atomic<bool> stop_;
+  ServiceOptions options_;
+  std::shared_ptr<CommandQueue> commands_;
+  boost::asio::io_service ios_;
+  std::unique_ptr<RobotAcceptor> acceptor_;
+  // after `ios_`: the connections it serves go first
+  std::shared_ptr<StatusPublisher> publisher_;
+
+};
@@ -0,0 +1,59 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+// the ROS side of the simulator: everything the core library needs
+// from the robot connector packages is translated here
+
+#include <robot_connector/msg_type.h>
+#include <robot_connector/utils.h>
+
+#include <rtp_simulator/RobotProtocol.h>
+#include <rtp_simulator/RobotService.h>
+
+/// message type ids as assigned by the robot connector
+inline rtp::MsgTypes rosMsgTypes()
+{
+  rtp::MsgTypes types;
+  types.joint_traj_pt  = toUType(rwc::MsgType::JOINT_TRAJ_PT);
+  types.status         = toUType(rwc::MsgType::STATUS);
+  types.task           = toUType(rwc::MsgType::TASK);
+  types.joint_responce = toUType(rwc::MsgType::JOINT_RESPONCE);
+  types.task_result    = toUType(rwc::MsgType::TASK_RESULT);
+  return types;
+}
+
+/// service options from the ROS parameter server
+inline ServiceOptions rosServiceOptions()
+{
+  ServiceOptions options;
+  ros::param::get("tcp_no_delay", options.tcp_no_delay);
+  ros::param::get("verbose", options.verbose);
+  ros::param::get("status_rate", options.status_rate);
+  std::string capture;
+  if (ros::param::get("capture", capture) && !capture.empty())
+  {
+    options.capture = std::make_shared<rtp::CaptureLog>(capture);
+  }
+  options.msg_types = rosMsgTypes();
+  return options;
+}
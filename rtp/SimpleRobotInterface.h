@@ -31,66 +31,8 @@
 #include <memory>
 
 #include <rwc_msgs/RobotCommand.h>
-
-template<class T>
-auto operator<<(std::ostream& os, const T& t) -> decltype(t.print(os), os)
-{
-  t.print(os);
-  return os;
-}
-
-// to store robot commands and for message queue
-template <typename T>
-class Buffer
-{
-public:
-    void add(T&& item)
-    {
-      std::unique_lock<std::mutex> locker(mu_);
-      cond_.wait(locker, [this] { return buffer_.size() < size_; } );
-      std::cout << "add(): pushed " << item << "\n";
-      buffer_.push_back(item);
-      cond_.notify_all();
-      return;
-    }
-
-    T remove()
-    {
-      std::unique_lock<std::mutex> locker(mu_);
-      cond_.wait(locker, [this] { return !buffer_.empty(); } );
-      auto back = buffer_.back();
-      buffer_.pop_back();
-      std::cout << "remove(): popped " << back << "\n";
-      cond_.notify_all();
-      return back;
-    }
-
-    bool empty() const
-    {
-      return buffer_.empty();
-    }
-
-    Buffer() {}
-
-private:
-    std::mutex mu_;
-    std::condition_variable cond_;
-
-    std::deque<T> buffer_;
-    const unsigned size_ = 128;
-};
-
-struct RobotCommand
-{
-  int task_id, sequence_id, command_type;
-
-  void print(std::ostream& strm) const
-  {
-    strm << "task_id: " << task_id
-         << " sequence_id: " << sequence_id
-         << " command_type: " << command_type;
-  }
-};
+#include <rtp_simulator/BoundedQueue.h>
+#include <rtp_simulator/RobotCommand.h>
 
 // base class for all messages
 class Message
@@ -108,14 +50,17 @@ public:
     OK, NO_CONNECTION, COMMAND_UNSUPPORTED, COMMAND_FAILED,
   };
 
-  using MessageQueue = Buffer<std::unique_ptr<Message>>;
+  using MessageQueue = BlockingQueue<std::unique_ptr<Message>>;
+
+  constexpr static size_t MESSAGE_QUEUE_SIZE = 128;
 
 // methods
 public:
 
   /// a constructor: error handlers should be set before the first task execution
   SimpleRobotInterface(std::vector<rwc_msgs::RobotErrorHandler>&& error_handlers)
-    : error_handlers_(error_handlers)
+    : error_handlers_(error_handlers),
+      message_queue_(MESSAGE_QUEUE_SIZE)
   {}
 
   Responce executeTask(rwc_msgs::RobotTask&& tasks);
@@ -0,0 +1,151 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include <cmath>
+#include <stdexcept>
+
+#include "StatusPublisher.h"
+
+using clock_type = std::chrono::steady_clock;
+
+constexpr std::chrono::microseconds StatusPublisher::DEFAULT_TICK;
+
+StatusPublisher::StatusPublisher(std::chrono::microseconds tick, size_t slots)
+  : tick_(tick),
+    turn_(tick * static_cast<std::chrono::microseconds::rep>(slots)),
+    wheel_(slots)
+{
+  if (tick_.count() <= 0 || slots == 0)
+    throw std::invalid_argument("StatusPublisher: tick and slots should be positive");
+  thread_ = std::thread([this] { run(); });
+}
+
+StatusPublisher::~StatusPublisher()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stop_ = true;
+  }
+  added_.notify_one();
+  thread_.join();
+}
+
+void StatusPublisher::add(std::unique_ptr<RobotService> service,
+                          std::shared_ptr<boost::asio::ip::tcp::socket> sock,
+                          double rate)
+{
+  if (!(rate > 0.))
+    throw std::invalid_argument("StatusPublisher: rate should be positive");
+
+  double ticks = 1e6 / (rate * tick_.count());
+  auto period = static_cast<uint64_t>(std::max(1., std::round(ticks)));
+
+  service->attach(std::move(sock));
+  std::unique_ptr<Connection> conn(new Connection{std::move(service), period, 0});
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    incoming_.push_back(std::move(conn));
+  }
+  connections_.fetch_add(1);
+  added_.notify_one();
+}
+
+void StatusPublisher::run()
+{
+  auto next = clock_type::now();
+  for (;;)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      if (connections_.load() == 0)
+      {
+        // nothing to publish, don't tick in vain
+        added_.wait(lock, [this] { return stop_ || !incoming_.empty(); });
+        next = clock_type::now();
+      }
+      if (stop_)
+        return;
+    }
+
+    adopt();
+    advance();
+
+    next += tick_;
+    auto now = clock_type::now();
+    if (now - next > turn_)
+    {
+      // fell behind by more than a turn (e.g. the process was stopped),
+      // skip the missed ticks instead of publishing them in a burst
+      next = now;
+    }
+    std::this_thread::sleep_until(next);
+  }
+}
+
+void StatusPublisher::adopt()
+{
+  std::vector<std::unique_ptr<Connection>> incoming;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    incoming.swap(incoming_);
+  }
+  for (auto& conn : incoming)
+  {
+    schedule(std::move(conn), 1);
+  }
+}
+
+void StatusPublisher::advance()
+{
+  ++now_;
+  auto& slot = wheel_[now_ % wheel_.size()];
+
+  // connections put back into this very slot are due a full turn later
+  std::vector<std::unique_ptr<Connection>> due;
+  due.swap(slot);
+
+  for (auto& conn : due)
+  {
+    if (conn->rounds > 0)
+    {
+      --conn->rounds;
+      slot.push_back(std::move(conn));
+    }
+    else if (conn->service->publishStatus())
+    {
+      uint64_t period = conn->period;
+      schedule(std::move(conn), period);
+    }
+    else
+    {
+      conn.reset();
+      connections_.fetch_sub(1);
+    }
+  }
+}
+
+void StatusPublisher::schedule(std::unique_ptr<Connection> conn, uint64_t delay)
+{
+  // the slot of `now_ + delay` is visited after `(delay - 1) % size + 1` ticks
+  // and then every turn
+  conn->rounds = (delay - 1) / wheel_.size();
+  wheel_[(now_ + delay) % wheel_.size()].push_back(std::move(conn));
+}
@@ -0,0 +1,111 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "RobotService.h"
+
+/// publishes robot status on every state connection from one timer thread
+///
+/// connections sit in a hashed timing wheel: each tick the thread wakes up
+/// once, serves all connections due in the current slot and puts them back
+/// one period ahead, so the cost follows the configured rates and not the
+/// number of connections times the speed of a busy loop. Sockets are
+/// non-blocking, a reader that falls behind gets the rest of its previous
+/// batch on its next turn instead of a new one and never stalls the others
+class StatusPublisher
+{
+public:
+
+  constexpr static std::chrono::microseconds DEFAULT_TICK{1000};
+
+  /// one turn of the wheel covers a second with the default tick,
+  /// longer periods take several rounds
+  constexpr static size_t DEFAULT_SLOTS = 1024;
+
+  explicit StatusPublisher(std::chrono::microseconds tick = DEFAULT_TICK,
+                           size_t slots = DEFAULT_SLOTS);
+
+  /// stops the timer thread, the remaining connections are closed
+  ~StatusPublisher();
+
+  StatusPublisher(const StatusPublisher&) = delete;
+  StatusPublisher& operator=(const StatusPublisher&) = delete;
+
+  /// takes over a state connection, it is served `rate` times per second
+  /// starting with the next tick
+  void add(std::unique_ptr<RobotService> service,
+           std::shared_ptr<boost::asio::ip::tcp::socket> sock,
+           double rate);
+
+  /// connections currently served
+  size_t connections() const { return connections_.load(); }
+
+// methods
+private:
+
+  struct Connection
+  {
+    std::unique_ptr<RobotService> service;
+    uint64_t period;  // in ticks
+    uint64_t rounds;  // full turns of the wheel left before it is due
+  };
+
+  void run();
+
+  /// moves the connections added since the last tick into the wheel
+  void adopt();
+
+  /// serves the connections of the current slot
+  void advance();
+
+  void schedule(std::unique_ptr<Connection> conn, uint64_t delay);
+
+// data members
+private:
+
+  const std::chrono::microseconds tick_;
+
+  /// one full turn of the wheel
+  const std::chrono::microseconds turn_;
+
+  std::vector<std::vector<std::unique_ptr<Connection>>> wheel_;
+
+  /// ticks since start, owned by the timer thread
+  uint64_t now_ = 0;
+
+  std::atomic<size_t> connections_{0};
+
+  std::mutex mutex_;
+  std::condition_variable added_;
+  std::vector<std::unique_ptr<Connection>> incoming_;  // guarded by `mutex_`
+  bool stop_ = false;                                  // guarded by `mutex_`
+
+  std::thread thread_;
+};
@@ -0,0 +1,300 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+// load generator for `RobotSimulatorServer`, speaks the wire protocol directly
+// so it needs neither ROS nor a robot connector:
+//
+//   rtp_loadgen --connections 16 --rate 1000 --duration 10
+//
+// every joints connection streams `JointTrajPtMessage` at `rate` per second and
+// measures the time to the matching `JointResponceMessage`; the latency is
+// taken from the *scheduled* send time so that a stalled server is not hidden
+// by the generator slowing down (coordinated omission).
+// every state connection just drains and counts the status stream.
+
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <algorithm>
+#include <boost/asio.hpp>
+#include <boost/program_options.hpp>
+
+#include "RobotProtocol.h"
+#include "LatencyHistogram.h"
+#include "BoundedQueue.h"
+
+using namespace boost::asio;
+using Clock = std::chrono::steady_clock;
+
+struct program_options
+{
+  std::string host      = {"127.0.0.1"};
+  uint16_t joints_port  = {11000};
+  uint16_t state_port   = {11002};
+  size_t connections    = {1};       // joints connections
+  size_t state_connections = {1};    // state connections
+  double rate           = {100.};    // messages per second per connection
+  double duration       = {10.};     // seconds
+  size_t window         = {1};       // max requests in flight per connection
+  int32_t traj_msg_type = {11};      // simple_message JOINT_TRAJ_PT
+  bool tcp_no_delay     = {true};
+};
+
+program_options parse_command_line(int argc, char** argv)
+{
+  namespace po = boost::program_options;
+  program_options popt;
+  po::options_description desc("allowed options");
+  desc.add_options()
+    ("help",              "describe arguments")
+    ("host",              po::value<std::string>(&popt.host),            "simulator address")
+    ("joints_port",       po::value<uint16_t>(&popt.joints_port),        "trajectory streaming port")
+    ("state_port",        po::value<uint16_t>(&popt.state_port),         "robot state port")
+    ("connections",       po::value<size_t>(&popt.connections),          "number of joints connections")
+    ("state_connections", po::value<size_t>(&popt.state_connections),    "number of state connections")
+    ("rate",              po::value<double>(&popt.rate),                 "messages per second per joints connection")
+    ("duration",          po::value<double>(&popt.duration),             "test duration in seconds")
+    ("window",            po::value<size_t>(&popt.window),               "max requests in flight per connection")
+    ("traj_msg_type",     po::value<int32_t>(&popt.traj_msg_type),       "message type id of JOINT_TRAJ_PT")
+    ("tcp_no_delay",      po::value<bool>(&popt.tcp_no_delay),           "set TCP_NODELAY on client sockets");
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      std::exit(0);
+    }
+    if (popt.window == 0 || popt.rate <= 0.)
+      throw std::invalid_argument("`window` and `rate` should be positive");
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    std::exit(-1);
+  }
+  return popt;
+}
+
+/// reads one frame, returns its header, the body is left in `body`
+rtp::PacketHeader readFrame(ip::tcp::socket& sock, std::vector<char>& body)
+{
+  rtp::PacketHeader header;
+  read(sock, buffer(&header, sizeof(header)));
+  int32_t len = rtp::bodyLength(header);
+  if (len < 0)
+    throw std::runtime_error("malformed frame");
+  body.resize(len);
+  read(sock, buffer(body));
+  return header;
+}
+
+struct Stats
+{
+  rtp::LatencyHistogram latency; // ns
+  uint64_t sent = 0, received = 0;
+  uint64_t status_frames = 0, status_bytes = 0;
+};
+
+class JointsClient
+{
+public:
+
+  JointsClient(io_service& ios, const program_options& po, Clock::time_point deadline)
+    : po_(po), sock_(ios), deadline_(deadline), in_flight_(std::max<size_t>(2, po.window))
+  {
+    sock_.connect(ip::tcp::endpoint(ip::address::from_string(po_.host), po_.joints_port));
+    sock_.set_option(ip::tcp::no_delay(po_.tcp_no_delay));
+  }
+
+  void run(Stats& stats)
+  {
+    std::thread receiver([this, &stats] { receive(stats); });
+    send(stats);
+    receiver.join();
+  }
+
+private:
+
+  void send(Stats& stats)
+  {
+    const auto period = std::chrono::duration_cast<Clock::duration>(
+                          std::chrono::duration<double>(1. / po_.rate));
+    auto scheduled = Clock::now();
+    int32_t seq = 0;
+
+    rtp::PacketHeader header { rtp::messageLength<rtp::JointTrajPtMessage>(),
+                               po_.traj_msg_type, rtp::SERVICE_REQUEST, rtp::REPLY_INVALID };
+    std::vector<const_buffer> frame { buffer(&header, sizeof(header)) };
+
+    while (scheduled < deadline_)
+    {
+      std::this_thread::sleep_until(scheduled);
+
+      rtp::JointTrajPtMessage msg(seq++);
+      msg.velocity = 0.5f;
+      frame.resize(1);
+      frame.push_back(buffer(&msg, sizeof(msg)));
+
+      while (outstanding_.load() >= po_.window)
+        std::this_thread::yield();
+      outstanding_.fetch_add(1);
+      in_flight_.tryPush(scheduled); // capacity is at least `window`
+      write(sock_, frame);
+      ++stats.sent;
+      scheduled += period;
+    }
+    done_.store(true);
+  }
+
+  void receive(Stats& stats)
+  {
+    std::vector<char> body;
+    for (;;)
+    {
+      Clock::time_point scheduled;
+      while (!in_flight_.tryPop(scheduled))
+      {
+        if (done_.load() && in_flight_.empty())
+          return;
+        std::this_thread::yield();
+      }
+      readFrame(sock_, body);
+      auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - scheduled);
+      stats.latency.record(ns.count());
+      ++stats.received;
+      outstanding_.fetch_sub(1);
+    }
+  }
+
+// data members
+private:
+
+  const program_options& po_;
+  ip::tcp::socket sock_;
+  Clock::time_point deadline_;
+
+  /// scheduled send times of the outstanding requests, replies come in order
+  MPMCBoundedQueue<Clock::time_point> in_flight_;
+  std::atomic<size_t> outstanding_{0};
+  std::atomic<bool> done_{false};
+};
+
+void drainState(io_service& ios, const program_options& po,
+                Clock::time_point deadline, Stats& stats)
+{
+  ip::tcp::socket sock(ios);
+  sock.connect(ip::tcp::endpoint(ip::address::from_string(po.host), po.state_port));
+  std::vector<char> body;
+  while (Clock::now() < deadline)
+  {
+    readFrame(sock, body);
+    ++stats.status_frames;
+    stats.status_bytes += sizeof(rtp::PacketHeader) + body.size();
+  }
+}
+
+void report(const program_options& po, const Stats& total, double secs)
+{
+  auto us = [](uint64_t ns) { return ns / 1e3; };
+  const auto& h = total.latency;
+  std::cout << std::fixed << std::setprecision(1)
+            << "connections: " << po.connections << " rate: " << po.rate
+            << " window: " << po.window << " duration: " << secs << "s\n"
+            << "sent: " << total.sent << " received: " << total.received
+            << " (" << total.received / secs << " replies/s)\n"
+            << "latency us: min " << us(h.min())
+            << " p50 " << us(h.valueAt(50.))
+            << " p90 " << us(h.valueAt(90.))
+            << " p99 " << us(h.valueAt(99.))
+            << " p999 " << us(h.valueAt(99.9))
+            << " max " << us(h.max())
+            << " mean " << us(h.mean()) << "\n"
+            << "status: " << total.status_frames << " frames "
+            << total.status_frames / secs << " frames/s "
+            << total.status_bytes / secs / (1 << 20) << " MiB/s" << std::endl;
+}
+
+int main(int argc, char** argv)
+{
+  program_options po = parse_command_line(argc, argv);
+
+  io_service ios;
+  auto start = Clock::now();
+  auto deadline = start + std::chrono::duration_cast<Clock::duration>(
+                            std::chrono::duration<double>(po.duration));
+
+  std::vector<Stats> stats(po.connections + po.state_connections);
+  std::vector<std::thread> threads;
+  std::mutex err_mu;
+
+  auto guarded = [&err_mu](auto&& f) {
+    return [&err_mu, f] {
+      try
+      {
+        f();
+      }
+      catch (const std::exception& e)
+      {
+        std::lock_guard<std::mutex> locker(err_mu);
+        std::cerr << "connection failed: " << e.what() << std::endl;
+      }
+    };
+  };
+
+  // state connections first, the simulator hands trajectory commands over to them
+  for (size_t i = 0; i < po.state_connections; ++i)
+  {
+    Stats& s = stats[po.connections + i];
+    threads.emplace_back(guarded([&] { drainState(ios, po, deadline, s); }));
+  }
+  for (size_t i = 0; i < po.connections; ++i)
+  {
+    Stats& s = stats[i];
+    threads.emplace_back(guarded([&] { JointsClient(ios, po, deadline).run(s); }));
+  }
+
+  for (auto& t : threads)
+    t.join();
+
+  double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+  Stats total;
+  for (const auto& s : stats)
+  {
+    total.latency.merge(s.latency);
+    total.sent += s.sent;
+    total.received += s.received;
+    total.status_frames += s.status_frames;
+    total.status_bytes += s.status_bytes;
+  }
+  report(po, total, secs);
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,208 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+// replays a capture recorded by the simulator (`rtp_standalone --capture`)
+// through the framer and the request dispatch of `RobotService`, in process
+// and without sockets, so the parsing path can be benchmarked with a real mix
+// of packets:
+//
+//   rtp_replay session.cap --repeat 100
+//
+// by default the traffic is pushed as fast as possible, `--realtime` keeps
+// the captured timing; `--chunk` regroups the received bytes of a connection
+// into reads of that size, 0 feeds the frames one by one as captured.
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <thread>
+#include <boost/program_options.hpp>
+
+#include "CaptureLog.h"
+#include "RobotService.h"
+
+using Clock = std::chrono::steady_clock;
+
+struct program_options
+{
+  std::string capture;
+  size_t repeat = {1};
+  size_t chunk  = {0};
+  bool realtime = {false};
+  ServiceOptions service;
+};
+
+program_options parse_command_line(int argc, char** argv)
+{
+  namespace po = boost::program_options;
+  program_options popt;
+  rtp::MsgTypes& types = popt.service.msg_types;
+  po::options_description desc("allowed options");
+  desc.add_options()
+    ("help",                  "describe arguments")
+    ("capture",               po::value<std::string>(&popt.capture)->required(), "capture file")
+    ("repeat",                po::value<size_t>(&popt.repeat),              "replay the capture that many times")
+    ("chunk",                 po::value<size_t>(&popt.chunk),               "bytes per framer feed, 0 for one frame per feed")
+    ("realtime",              "keep the captured timing")
+    ("msg_joint_traj_pt",     po::value<int32_t>(&types.joint_traj_pt),     "JOINT_TRAJ_PT message id")
+    ("msg_task",              po::value<int32_t>(&types.task),              "TASK message id");
+  po::positional_options_description pos;
+  pos.add("capture", 1);
+  try
+  {
+    po::variables_map vm;
+    po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      std::exit(0);
+    }
+    po::notify(vm);
+    popt.realtime = vm.count("realtime");
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    std::exit(-1);
+  }
+  return popt;
+}
+
+/// one captured connection replayed against its own service
+struct Session
+{
+  Session(const ServiceOptions& options)
+    : commands(std::make_shared<CommandQueue>(128)),
+      service(RobotService::TRAJECTORY_STREAMING, options, commands)
+  {}
+
+  std::shared_ptr<CommandQueue> commands;
+  RobotService service;
+  Framer framer;
+  std::vector<char> stream;   // received bytes not fed yet, `--chunk` only
+  uint64_t replies = 0;
+};
+
+struct Totals
+{
+  uint64_t received_frames = 0, received_bytes = 0, sent_frames = 0;
+  uint64_t dispatched = 0, replies = 0;
+};
+
+void feed(Session& s, const char* data, size_t size, Totals& totals)
+{
+  totals.dispatched += s.framer.feed(data, size,
+    [&s](const rtp::PacketHeader& header, const char* body, size_t len)
+    {
+      s.service.onFrame(header, body, len);
+    });
+
+  // the replies would leave here, the commands would go to the state service
+  totals.replies += s.service.output().size();
+  s.service.output().clear();
+  RobotCommand cmd;
+  while (s.commands->tryPop(cmd)) {}
+}
+
+void replay(const rtp::CaptureReader& reader, const program_options& po, Totals& totals)
+{
+  std::map<uint32_t, std::unique_ptr<Session>> sessions;
+  Clock::time_point start = Clock::now();
+
+  reader.forEach([&](const rtp::CaptureEntry& entry, const char* bytes)
+  {
+    if (entry.direction == rtp::CAPTURE_SENT)
+    {
+      ++totals.sent_frames;
+      return;
+    }
+    if (entry.direction != rtp::CAPTURE_RECEIVED)
+      return;
+
+    auto& session = sessions[entry.connection];
+    if (!session)
+      session.reset(new Session(po.service));
+
+    if (po.realtime)
+      std::this_thread::sleep_until(start + std::chrono::nanoseconds(entry.time_ns));
+
+    ++totals.received_frames;
+    totals.received_bytes += entry.size;
+
+    if (po.chunk == 0)
+    {
+      feed(*session, bytes, entry.size, totals);
+      return;
+    }
+
+    auto& stream = session->stream;
+    stream.insert(stream.end(), bytes, bytes + entry.size);
+    size_t used = 0;
+    for (; stream.size() - used >= po.chunk; used += po.chunk)
+    {
+      feed(*session, stream.data() + used, po.chunk, totals);
+    }
+    stream.erase(stream.begin(), stream.begin() + used);
+  });
+
+  for (auto& s : sessions)
+  {
+    auto& stream = s.second->stream;
+    feed(*s.second, stream.data(), stream.size(), totals);
+  }
+}
+
+int main(int argc, char** argv)
+{
+  program_options po = parse_command_line(argc, argv);
+
+  try
+  {
+    rtp::CaptureReader reader(po.capture);
+
+    Totals totals;
+    Clock::time_point start = Clock::now();
+    for (size_t i = 0; i < po.repeat; ++i)
+    {
+      replay(reader, po, totals);
+    }
+    double secs = std::chrono::duration<double>(Clock::now() - start).count();
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "received frames: " << totals.received_frames
+              << " dispatched: " << totals.dispatched
+              << " replies: " << totals.replies
+              << " (captured: " << totals.sent_frames << " sent frames)\n"
+              << "elapsed: " << secs << "s "
+              << totals.dispatched / secs << " frames/s "
+              << totals.received_bytes / secs / (1 << 20) << " MiB/s" << std::endl;
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << "Error occured! Message: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,135 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+// the simulator without ROS: one robot, ports and message ids from the command line
+//
+//   rtp_standalone --joints_port 11000 --state_port 11002
+
+#include <iostream>
+#include <memory>
+#include <csignal>
+#include <boost/program_options.hpp>
+
+#include "RobotSimulatorServer.h"
+
+struct program_options
+{
+  uint16_t joints_port = {11000};
+  uint16_t state_port  = {11002};
+  std::string capture;
+  size_t capture_size  = {256};   // MiB
+  ServiceOptions service;
+};
+
+program_options parse_command_line(int argc, char** argv)
+{
+  namespace po = boost::program_options;
+  program_options popt;
+  rtp::MsgTypes& types = popt.service.msg_types;
+  po::options_description desc("allowed options");
+  desc.add_options()
+    ("help",                  "describe arguments")
+    ("verbose",               "dump received messages")
+    ("joints_port",           po::value<uint16_t>(&popt.joints_port),              "trajectory streaming port")
+    ("state_port",            po::value<uint16_t>(&popt.state_port),               "robot state port")
+    ("tcp_no_delay",          po::value<bool>(&popt.service.tcp_no_delay),         "set TCP_NODELAY on accepted sockets")
+    ("status_per_cycle",      po::value<size_t>(&popt.service.status_per_cycle),   "status messages per state cycle")
+    ("capture",               po::value<std::string>(&popt.capture),               "record all frames to this file, see rtp_replay")
+    ("capture_size",          po::value<size_t>(&popt.capture_size),               "capture file size, MiB")
+    ("status_rate",           po::value<double>(&popt.service.status_rate),        "state cycles per second per connection")
+    ("msg_joint_traj_pt",     po::value<int32_t>(&types.joint_traj_pt),            "JOINT_TRAJ_PT message id")
+    ("msg_status",            po::value<int32_t>(&types.status),                   "STATUS message id")
+    ("msg_task",              po::value<int32_t>(&types.task),                     "TASK message id")
+    ("msg_joint_responce",    po::value<int32_t>(&types.joint_responce),           "JOINT_RESPONCE message id")
+    ("msg_task_result",       po::value<int32_t>(&types.task_result),              "TASK_RESULT message id");
+  try
+  {
+    po::variables_map vm;
+    po::store(po::parse_command_line(argc, argv, desc), vm);
+    po::notify(vm);
+    if (vm.count("help"))
+    {
+      std::cout << desc << std::endl;
+      std::exit(0);
+    }
+    popt.service.verbose = vm.count("verbose");
+  }
+  catch (const std::exception& e)
+  {
+    std::cerr << e.what() << std::endl;
+    std::cout << desc << std::endl;
+    std::exit(-1);
+  }
+  return popt;
+}
+
+int main(int argc, char** argv)
+{
+  program_options po = parse_command_line(argc, argv);
+
+  // block the signals before the server threads inherit the mask
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, nullptr);
+
+  try
+  {
+    if (!po.capture.empty())
+    {
+      po.service.capture = std::make_shared<rtp::CaptureLog>(po.capture, po.capture_size << 20);
+    }
+
+    auto commands = std::make_shared<CommandQueue>(128);
+    RobotSimulatorServer joints(po.service), state(po.service);
+    joints.Start(po.joints_port, RobotService::TRAJECTORY_STREAMING, commands);
+    state.Start(po.state_port, RobotService::ROBOT_STATE, commands);
+    std::cout << "joints port: " << joints.port()
+              << " state port: " << state.port() << std::endl;
+
+    int sig;
+    sigwait(&signals, &sig);
+
+    joints.Stop();
+    state.Stop();
+
+    if (po.service.capture && po.service.capture->dropped())
+    {
+      std::cout << "capture full, " << po.service.capture->dropped()
+                << " frames dropped" << std::endl;
+    }
+  }
+  catch (boost::system::system_error &e)
+  {
+    std::cout << "Error occured! Error code = "
+              << e.code() << ". Message: "
+              << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+  catch (const std::exception &e)
+  {
+    std::cout << "Error occured! Message: " << e.what() << std::endl;
+    return EXIT_FAILURE;
+  }
+
+  return EXIT_SUCCESS;
+}
@@ -0,0 +1,369 @@
+// The MIT License (MIT)
+//
+// Copyright (c) 2019 Alexander Samoilov
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <thread>
+#include <vector>
+#include <numeric>
+#include <cstdio>
+#include <boost/asio.hpp>
+
+#include "RobotProtocol.h"
+#include "Framer.h"
+#include "OutputQueue.h"
+#include "BoundedQueue.h"
+#include "LatencyHistogram.h"
+#include "RobotService.h"
+#include "RobotSimulatorServer.h"
+#include "CaptureLog.h"
+
+using namespace boost::asio;
+
+namespace
+{
+
+template <typename Body>
+std::vector<char> makeFrame(int32_t msg_type, const Body& body)
+{
+  rtp::PacketHeader header { rtp::messageLength<Body>(), msg_type, rtp::SERVICE_REQUEST, 0 };
+  std::vector<char> frame(sizeof(header) + sizeof(body));
+  std::memcpy(frame.data(), &header, sizeof(header));
+  std::memcpy(frame.data() + sizeof(header), &body, sizeof(body));
+  return frame;
+}
+
+struct Collected
+{
+  std::vector<int32_t> types;
+  std::vector<size_t> sizes;
+
+  void operator()(const rtp::PacketHeader& header, const char*, size_t size)
+  {
+    types.push_back(header.msg_type);
+    sizes.push_back(size);
+  }
+};
+
+}
+
+TEST(framerSuite, test_whole_frames)
+{
+  auto a = makeFrame(11, rtp::JointTrajPtMessage(1));
+  auto b = makeFrame(1001, rtp::TaskMessage{7, 0, 1});
+  std::vector<char> stream(a);
+  stream.insert(stream.end(), b.begin(), b.end());
+
+  Framer framer;
+  Collected c;
+  EXPECT_EQ(framer.feed(stream.data(), stream.size(), std::ref(c)), 2);
+  EXPECT_EQ(framer.pending(), 0);
+  ASSERT_EQ(c.types.size(), 2);
+  EXPECT_EQ(c.types[0], 11);
+  EXPECT_EQ(c.sizes[0], sizeof(rtp::JointTrajPtMessage));
+  EXPECT_EQ(c.types[1], 1001);
+  EXPECT_EQ(c.sizes[1], sizeof(rtp::TaskMessage));
+}
+
+TEST(framerSuite, test_byte_by_byte)
+{
+  auto a = makeFrame(11, rtp::JointTrajPtMessage(42));
+
+  Framer framer;
+  int32_t sequence_id = -1;
+  auto handler = [&](const rtp::PacketHeader&, const char* body, size_t) {
+    rtp::JointTrajPtMessage msg;
+    std::memcpy(&msg, body, sizeof(msg));
+    sequence_id = msg.sequence_id;
+  };
+  for (size_t i = 0; i + 1 < a.size(); ++i)
+  {
+    EXPECT_EQ(framer.feed(&a[i], 1, handler), 0);
+  }
+  EXPECT_EQ(framer.feed(&a.back(), 1, handler), 1);
+  EXPECT_EQ(sequence_id, 42);
+  EXPECT_EQ(framer.pending(), 0);
+}
+
+TEST(framerSuite, test_malformed)
+{
+  rtp::PacketHeader header { -100, 11, rtp::SERVICE_REQUEST, 0 };
+  Framer framer;
+  Collected c;
+  EXPECT_THROW(framer.feed(reinterpret_cast<const char*>(&header), sizeof(header), std::ref(c)),
+               std::runtime_error);
+}
+
+TEST(outputQueueSuite, test_gather_write)
+{
+  io_service ios;
+  local::stream_protocol::socket s1(ios), s2(ios);
+  local::connect_pair(s1, s2);
+
+  OutputQueue<rtp::PacketHeader> out(4);
+  for (int32_t i = 0; i < 4; ++i)
+  {
+    out.enqueue(rtp::replyHeader<rtp::TaskResult>(1003), rtp::TaskResult{i, i, 0});
+  }
+  EXPECT_TRUE(out.full());
+
+  constexpr size_t frame_size = sizeof(rtp::PacketHeader) + sizeof(rtp::TaskResult);
+  EXPECT_EQ(out.flush(s1), 4 * frame_size);
+  EXPECT_TRUE(out.empty());
+
+  std::vector<char> stream(4 * frame_size);
+  read(s2, buffer(stream));
+
+  Framer framer;
+  std::vector<int32_t> task_ids;
+  framer.feed(stream.data(), stream.size(), [&](const rtp::PacketHeader&, const char* body, size_t) {
+    rtp::TaskResult result;
+    std::memcpy(&result, body, sizeof(result));
+    task_ids.push_back(result.task_id);
+  });
+  EXPECT_EQ(task_ids, (std::vector<int32_t>{0, 1, 2, 3}));
+}
+
+TEST(boundedQueueSuite, test_fifo)
+{
+  MPMCBoundedQueue<int> q(3);
+  EXPECT_EQ(q.capacity(), 4);
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_TRUE(q.tryPush(i));
+  }
+  EXPECT_FALSE(q.tryPush(4));
+  int v;
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_TRUE(q.tryPop(v));
+    EXPECT_EQ(v, i);
+  }
+  EXPECT_FALSE(q.tryPop(v));
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(boundedQueueSuite, test_move_only)
+{
+  MPMCBoundedQueue<std::unique_ptr<int>> q(2);
+  EXPECT_TRUE(q.tryPush(std::make_unique<int>(7)));
+  EXPECT_TRUE(q.tryPush(std::make_unique<int>(8)));
+  std::unique_ptr<int> p;
+  EXPECT_TRUE(q.tryPop(p));
+  EXPECT_EQ(*p, 7);
+  // the second one is released by the destructor
+}
+
+TEST(boundedQueueSuite, test_blocking_producers_consumers)
+{
+  constexpr size_t threads = 4, items = 10000;
+  BlockingQueue<size_t> q(16);
+  std::atomic<size_t> sum{0};
+  std::vector<std::thread> pool;
+  for (size_t t = 0; t < threads; ++t)
+  {
+    pool.emplace_back([&, t] { for (size_t i = 0; i < items; ++i) q.push(t * items + i + 1); });
+    pool.emplace_back([&] { for (size_t i = 0; i < items; ++i) sum += q.pop(); });
+  }
+  for (auto& th : pool)
+    th.join();
+  constexpr size_t n = threads * items;
+  EXPECT_EQ(sum.load(), n * (n + 1) / 2);
+  EXPECT_TRUE(q.empty());
+}
+
+TEST(latencyHistogramSuite, test_percentiles)
+{
+  rtp::LatencyHistogram h;
+  for (uint64_t v = 1; v <= 100000; ++v)
+  {
+    h.record(v);
+  }
+  EXPECT_EQ(h.count(), 100000);
+  EXPECT_EQ(h.min(), 1);
+  EXPECT_EQ(h.max(), 100000);
+  EXPECT_NEAR(h.valueAt(50.), 50000, 50000 * 0.01);
+  EXPECT_NEAR(h.valueAt(99.), 99000, 99000 * 0.01);
+  EXPECT_NEAR(h.valueAt(99.9), 99900, 99900 * 0.01);
+  EXPECT_EQ(h.valueAt(100.), 100000);
+  EXPECT_DOUBLE_EQ(h.mean(), 50000.5);
+}
+
+TEST(robotServiceSuite, test_trajectory_point)
+{
+  auto commands = std::make_shared<CommandQueue>(8);
+  ServiceOptions options;
+  RobotService service(RobotService::TRAJECTORY_STREAMING, options, commands);
+
+  auto task = makeFrame(options.msg_types.task, rtp::TaskMessage{5, 0, 1});
+  auto point = makeFrame(options.msg_types.joint_traj_pt, rtp::JointTrajPtMessage(3));
+  Framer framer;
+  auto handler = [&](const rtp::PacketHeader& header, const char* body, size_t size) {
+    service.onFrame(header, body, size);
+  };
+  framer.feed(task.data(), task.size(), handler);
+  framer.feed(point.data(), point.size(), handler);
+
+  // every request is answered
+  EXPECT_EQ(service.output().size(), 2);
+
+  RobotCommand cmd;
+  ASSERT_TRUE(commands->tryPop(cmd));
+  EXPECT_EQ(cmd.task_id, 5);
+  EXPECT_EQ(cmd.command_type, 0);
+  ASSERT_TRUE(commands->tryPop(cmd));
+  EXPECT_EQ(cmd.task_id, 5);
+  EXPECT_EQ(cmd.sequence_id, 3);
+  EXPECT_EQ(cmd.command_type, 1);
+}
+
+TEST(robotServiceSuite, test_status_cycle)
+{
+  auto commands = std::make_shared<CommandQueue>(8);
+  ServiceOptions options;
+  options.status_per_cycle = 3;
+  RobotService service(RobotService::ROBOT_STATE, options, commands);
+
+  service.stageStatus();
+  EXPECT_EQ(service.output().size(), 3);
+  service.output().clear();
+
+  commands->push(RobotCommand{1, 2, 1});
+  service.stageStatus();
+  EXPECT_EQ(service.output().size(), 4); // plus the task result
+}
+
+TEST(robotServiceSuite, test_pipelined_requests)
+{
+  auto commands = std::make_shared<CommandQueue>(128);
+  ServiceOptions options;
+  options.tcp_no_delay = true;
+  RobotSimulatorServer joints(options);
+  joints.Start(0, RobotService::TRAJECTORY_STREAMING, commands);
+
+  io_service ios;
+  ip::tcp::socket sock(ios);
+  sock.connect(ip::tcp::endpoint(ip::address_v4::loopback(), joints.port()));
+
+  // several requests in one segment, the server used to read only the first one
+  constexpr size_t requests = 5;
+  std::vector<char> stream;
+  for (size_t i = 0; i < requests; ++i)
+  {
+    auto frame = makeFrame(options.msg_types.joint_traj_pt, rtp::JointTrajPtMessage(i));
+    stream.insert(stream.end(), frame.begin(), frame.end());
+  }
+  write(sock, buffer(stream));
+
+  std::vector<char> replies(requests * (sizeof(rtp::PacketHeader) + sizeof(rtp::JointResponceMessage)));
+  read(sock, buffer(replies));
+
+  Collected c;
+  Framer framer;
+  EXPECT_EQ(framer.feed(replies.data(), replies.size(), std::ref(c)), requests);
+  for (int32_t type : c.types)
+  {
+    EXPECT_EQ(type, options.msg_types.joint_responce);
+  }
+
+  sock.close();
+  joints.Stop();
+}
+
+TEST(robotServiceSuite, test_status_rate)
+{
+  auto commands = std::make_shared<CommandQueue>(8);
+  ServiceOptions options;
+  options.status_rate = 50.;
+  RobotSimulatorServer state(options);
+  state.Start(0, RobotService::ROBOT_STATE, commands);
+
+  // both connections are served by the same timer thread
+  io_service ios;
+  ip::tcp::socket a(ios), b(ios);
+  a.connect(ip::tcp::endpoint(ip::address_v4::loopback(), state.port()));
+  b.connect(ip::tcp::endpoint(ip::address_v4::loopback(), state.port()));
+
+  std::this_thread::sleep_for(std::chrono::milliseconds(400));
+
+  for (ip::tcp::socket* sock : {&a, &b})
+  {
+    std::vector<char> rx(64 * 1024);
+    size_t n = sock->read_some(buffer(rx));
+    Collected c;
+    Framer framer;
+    size_t frames = framer.feed(rx.data(), n, std::ref(c));
+    // 20 cycles of one status each at 50 Hz, not a flood
+    EXPECT_GE(frames, 10);
+    EXPECT_LE(frames, 30);
+  }
+
+  a.close();
+  b.close();
+  state.Stop();
+}
+
+TEST(captureSuite, test_record_and_read)
+{
+  std::string path = testing::TempDir() + "rtp_capture_test.cap";
+  auto frame = makeFrame(rtp::MsgTypes().joint_traj_pt, rtp::JointTrajPtMessage(7));
+  {
+    rtp::CaptureLog log(path, 4096);
+    uint32_t conn = log.newConnection();
+    EXPECT_TRUE(log.record(rtp::CAPTURE_RECEIVED, conn,
+                           frame.data(), sizeof(rtp::PacketHeader),
+                           frame.data() + sizeof(rtp::PacketHeader), frame.size() - sizeof(rtp::PacketHeader)));
+    rtp::RobotStatus status;
+    EXPECT_TRUE(log.record(rtp::CAPTURE_SENT, conn, &status, sizeof(status)));
+  }
+
+  // the log is trimmed on close and reads back in order
+  rtp::CaptureReader reader(path);
+  std::vector<rtp::CaptureEntry> entries;
+  std::vector<char> bytes;
+  EXPECT_EQ(reader.forEach([&](const rtp::CaptureEntry& e, const char* data) {
+    entries.push_back(e);
+    if (e.direction == rtp::CAPTURE_RECEIVED)
+      bytes.assign(data, data + e.size);
+  }), 2);
+  ASSERT_EQ(entries.size(), 2);
+  EXPECT_EQ(entries[0].connection, 1);
+  EXPECT_EQ(entries[1].direction, rtp::CAPTURE_SENT);
+  EXPECT_EQ(entries[1].size, sizeof(rtp::RobotStatus));
+  EXPECT_LE(entries[0].time_ns, entries[1].time_ns);
+  EXPECT_EQ(bytes, frame);
+  std::remove(path.c_str());
+}
+
+TEST(captureSuite, test_full_log_drops)
+{
+  std::string path = testing::TempDir() + "rtp_capture_full.cap";
+  rtp::RobotStatus status;
+  size_t entry = rtp::captureAlign(sizeof(rtp::CaptureEntry) + sizeof(status));
+  rtp::CaptureLog log(path, sizeof(rtp::CaptureFileHeader) + 3 * entry);
+  for (int i = 0; i < 5; ++i)
+  {
+    log.record(rtp::CAPTURE_SENT, 1, &status, sizeof(status));
+  }
+  EXPECT_EQ(log.dropped(), 2);
+  EXPECT_EQ(log.size(), sizeof(rtp::CaptureFileHeader) + 3 * entry);
+  std::remove(path.c_str());
+}
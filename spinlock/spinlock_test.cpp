@@ -1,21 +1,41 @@
-#include <cassert>
 #include <cstdlib>
+#include <cstdio>
 #include <iostream>
 #include <vector>
 #include <thread>
+#include <atomic>
+#include <chrono>
 #include <cinttypes>
+#include <pthread.h>
+#include <sched.h>
+#include "../parallel_ds_and_algos/parallel_ds/perf_counters.hpp"
 
-// Number of total lock/unlock pair.
-constexpr size_t N_PAIR = 16'000'000;
+// Throughput of the plain test-and-set lock: every thread runs `pairs`
+// lock/unlock pairs around NCOUNTER increments of shared counters, one per
+// cache line. The lock family and more options are in
+// parallel_ds_and_algos/spinlock/spinlock_test2.cpp.
+
+// Lock/unlock pairs per thread by default.
+constexpr size_t N_PAIR = 1'000'000;
 
 constexpr size_t NCOUNTER = 1;
 constexpr size_t CACHE_LINE = 64;
 
-static __thread int8_t counter[CACHE_LINE*NCOUNTER];
+alignas(CACHE_LINE) static int64_t counter[CACHE_LINE/sizeof(int64_t)*NCOUNTER];
 
-static bool spinlock = false;
+alignas(CACHE_LINE) static bool spinlock = false;
 
 static size_t nthr = 0;
+static size_t npair = N_PAIR;
+
+struct alignas(CACHE_LINE) thread_stat {
+  double secs;
+  uint64_t cycles;
+  uint64_t misses;
+};
+
+static std::vector<thread_stat> stats;
+static std::atomic<bool> go {false};
 
 void spin_lock(bool *l)
 {
@@ -25,39 +45,90 @@ void spin_lock(bool *l)
 
 void spin_unlock(bool *l)
 {
-  *l = false;
+  __atomic_clear(l, __ATOMIC_RELEASE);
 }
 
 void inc_thread(size_t id)
 {
-  size_t n = N_PAIR / nthr;
-  assert(n * nthr == N_PAIR);
-  std::cout << "thread " << id << " launched" << std::endl;
-
-  spin_lock(&spinlock);
-  for (size_t j = 0; j < NCOUNTER; ++j)
-    ++counter[j*CACHE_LINE];
-  spin_unlock(&spinlock);
+  perf_counters pc;
+  while (!go.load(std::memory_order_acquire))
+    std::this_thread::yield();
+
+  pc.start();
+  auto t0 = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < npair; ++i) {
+    spin_lock(&spinlock);
+    for (size_t j = 0; j < NCOUNTER; ++j)
+      ++counter[j*CACHE_LINE/sizeof(int64_t)];
+    spin_unlock(&spinlock);
+  }
+  auto t1 = std::chrono::steady_clock::now();
+  pc.stop();
+
+  stats[id].secs = std::chrono::duration<double>(t1 - t0).count();
+  stats[id].cycles = pc.value(perf_counters::cycles);
+  stats[id].misses = pc.value(perf_counters::cache_misses);
 }
 
 int main(int argc, char **argv)
 {
   if (argc < 2) {
-    std::cout << "usage: " << argv[0] << " <num of threads>\n";
+    std::cout << "usage: " << argv[0] << " <num of threads> [pairs per thread] [pin]\n";
     return EXIT_FAILURE;
   }
 
   std::vector<std::thread> threads;
   nthr = std::atoi(argv[1]);
+  if (argc > 2)
+    npair = std::atoll(argv[2]);
+  bool pin = argc > 3 && std::atoi(argv[3]) != 0;
   threads.resize(nthr);
+  stats.resize(nthr);
 
+  unsigned ncpu = std::max(1u, std::thread::hardware_concurrency());
   for (size_t i = 0; i < nthr; ++i) {
     threads[i] = std::thread(inc_thread, i);
+    if (pin) {
+      cpu_set_t set;
+      CPU_ZERO(&set);
+      CPU_SET(i % ncpu, &set);
+      pthread_setaffinity_np(threads[i].native_handle(), sizeof(set), &set);
+    }
   }
 
+  auto start = std::chrono::steady_clock::now();
+  go.store(true, std::memory_order_release);
   for (size_t i = 0; i < nthr; ++i) {
     threads[i].join();
   }
+  double secs = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+  // a lost update means the lock let two threads in
+  for (size_t j = 0; j < NCOUNTER; ++j) {
+    int64_t got = counter[j*CACHE_LINE/sizeof(int64_t)];
+    if (got != int64_t(nthr * npair)) {
+      std::cerr << "counter " << j << " is " << got << ", expected " << nthr * npair << std::endl;
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Jain's index of the per-thread rates, 1 when the lock was fair
+  double total = double(nthr) * npair, sum = 0, sq = 0;
+  uint64_t cycles = 0, misses = 0;
+  bool counted = true;
+  for (auto &s : stats) {
+    sum += npair / s.secs;
+    sq += (npair / s.secs) * (npair / s.secs);
+    counted = counted && s.cycles != perf_counters::unavailable && s.misses != perf_counters::unavailable;
+    cycles += s.cycles;
+    misses += s.misses;
+  }
+
+  std::printf("%zu threads, %zu pairs each: %.2f ns/pair, fairness %.3f",
+              nthr, npair, secs * 1e9 / total, sum * sum / (nthr * sq));
+  if (counted)
+    std::printf(", %.1f cycles/pair, %.3f cache misses/pair", cycles / total, misses / total);
+  std::printf("\n");
 
   return EXIT_SUCCESS;
 }
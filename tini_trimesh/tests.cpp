@@ -155,6 +155,22 @@ TEST_F(TinyTriMeshTest, FindOppositeVertexFlatCover)
     ASSERT_EQ(opp_index, -1);
 }
 
+TEST_F(TinyTriMeshTest, FindOppositeVertexUnorderedFaces)
+{
+    TriMesh mesh;
+    std::vector<Point3> vertices{ {0., 0., 0.}, {1., 0., 0.}, {1., 1., 0.}, {0., 1., 0.}, };
+    std::vector<Face> faces{ Face({3,0,1}), Face({2,3,1}), };
+    mesh.addVertices(std::move(vertices));
+    mesh.addFaces(std::move(faces));
+
+    int opp_index = mesh.findOppositeVertexIndex(0, 1);
+    ASSERT_EQ(opp_index, 0);
+    opp_index = mesh.findOppositeVertexIndex(1, 0);
+    ASSERT_EQ(opp_index, 2);
+    opp_index = mesh.findOppositeVertexIndex(0, 0);
+    ASSERT_EQ(opp_index, -1);
+}
+
 TEST_F(TinyTriMeshTest, GetXYplaneBBFourFaces)
 {
     TriMesh mesh = getFourFaces();
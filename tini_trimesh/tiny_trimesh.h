@@ -75,18 +75,42 @@ private:
     std::map<Point3, size_t> vertexIndicesMap_;
     size_t vertexCounter_;
 
+    static void compareExchange(int& a, int& b)
+    {
+        int lo = std::min(a, b), hi = std::max(a, b);
+        a = lo;
+        b = hi;
+    }
+
+    // the sorted indices of A not in B, as `set_difference` of the sorted
+    // lists, on the stack: A is sorted by a three-comparator network and
+    // every index of A is compared with all of B, which stays unsorted
     template <typename AIterator, typename BIterator>
     std::pair<FaceIndexList,size_t> diffIndices(AIterator contAbegin, AIterator contAend,
                                                 BIterator contBbegin, BIterator contBend)
     {
-        using boost::sort, boost::range::set_difference;
-        FaceIndexList contAcopy, contBcopy, result{-1};
-        std::copy(contAbegin, contAend, contAcopy.begin());
-        std::copy(contBbegin, contBend, contBcopy.begin());
-        sort(contAcopy);
-        sort(contBcopy);
-        auto pos = set_difference(contAcopy, contBcopy, result.begin());
-        size_t dist = std::distance(result.begin(), pos);
+        FaceIndexList contA{}, contB{}, result{-1};
+        size_t na = std::distance(contAbegin, contAend);
+        size_t nb = std::distance(contBbegin, contBend);
+        std::copy(contAbegin, contAend, contA.begin());
+        std::copy(contBbegin, contBend, contB.begin());
+        int top = *std::max_element(contA.begin(), contA.begin() + std::max<size_t>(na, 1));
+        std::fill(contA.begin() + na, contA.end(), top);
+        compareExchange(contA[0], contA[1]);
+        compareExchange(contA[1], contA[2]);
+        compareExchange(contA[0], contA[1]);
+
+        size_t dist = 0;
+        unsigned rank = 0;
+        for (size_t i = 0; i < na; ++i)
+        {
+            unsigned inB = 0;
+            for (size_t j = 0; j < NUMBER_OF_SIDES; ++j)
+                inB += (j < nb) & (contB[j] == contA[i]);
+            rank = i > 0 && contA[i - 1] == contA[i] ? rank + 1 : 0;
+            if (rank >= inB)
+                result[dist++] = contA[i];
+        }
         return std::make_pair(std::move(result), dist);
     }
 